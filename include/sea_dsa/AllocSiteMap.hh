@@ -0,0 +1,193 @@
+#ifndef __DSA_ALLOC_SITE_MAP_HH_
+#define __DSA_ALLOC_SITE_MAP_HH_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+   Binary format of the mapping between allocation sites and Dsa
+   nodes written by -sea-dsa-info-to-binary-file.
+
+   The file can be mapped in memory and queried without parsing. All
+   fields are uint32_t in the byte order of the machine that wrote
+   the file:
+
+     header     AllocSiteMapHeader
+     sites      num_sites site ids, sorted
+     nodes      num_nodes node ids, sorted
+     site_off   num_sites + 1 offsets into site_adj
+     site_adj   num_edges node ids (nodes of each site, sorted)
+     node_off   num_nodes + 1 offsets into node_adj
+     node_adj   num_edges site ids (sites of each node, sorted)
+
+   Ids are the ones of DsaInfo::getAllocSiteId and
+   DsaInfo::getDsaNodeId.
+
+   This header does not depend on LLVM so that clients of the file
+   do not need to link with it.
+*/
+
+namespace sea_dsa {
+
+  struct AllocSiteMapHeader {
+    char m_magic [8];
+    uint32_t m_version;
+    uint32_t m_num_sites;
+    uint32_t m_num_nodes;
+    uint32_t m_num_edges;
+
+    static const char *magic () { return "SEADSAAS"; }
+    static uint32_t version () { return 1; }
+  };
+
+  // Read-only view of a mapping between allocation sites and nodes
+  class AllocSiteMap {
+  public:
+
+    // A range of ids
+    class IdRange {
+      const uint32_t *m_begin;
+      const uint32_t *m_end;
+    public:
+      IdRange (): m_begin (nullptr), m_end (nullptr) {}
+      IdRange (const uint32_t *b, const uint32_t *e): m_begin (b), m_end (e) {}
+      const uint32_t *begin () const { return m_begin; }
+      const uint32_t *end () const { return m_end; }
+      size_t size () const { return m_end - m_begin; }
+      bool empty () const { return m_begin == m_end; }
+    };
+
+  private:
+
+    const char *m_data;
+    size_t m_size;
+    // -- true if m_data was mapped by open
+    bool m_mapped;
+
+    const uint32_t *m_sites;
+    const uint32_t *m_nodes;
+    const uint32_t *m_site_off;
+    const uint32_t *m_site_adj;
+    const uint32_t *m_node_off;
+    const uint32_t *m_node_adj;
+
+    const AllocSiteMapHeader &header () const
+    { return *reinterpret_cast<const AllocSiteMapHeader*> (m_data); }
+
+    static IdRange find (const uint32_t *keys, uint32_t num_keys,
+			 const uint32_t *off, const uint32_t *adj, uint32_t key) {
+      const uint32_t *it = std::lower_bound (keys, keys + num_keys, key);
+      if (it == keys + num_keys || *it != key) return IdRange ();
+      size_t i = it - keys;
+      return IdRange (adj + off [i], adj + off [i + 1]);
+    }
+
+    // Check the header and set the tables. Return false if the data
+    // is not a valid mapping.
+    bool init () {
+      if (m_size < sizeof (AllocSiteMapHeader)) return false;
+      const AllocSiteMapHeader &h = header ();
+      if (std::memcmp (h.m_magic, AllocSiteMapHeader::magic (), sizeof (h.m_magic)) != 0 ||
+	  h.m_version != AllocSiteMapHeader::version ())
+	return false;
+
+      uint64_t words = 2 * (uint64_t) h.m_num_sites + 2 * (uint64_t) h.m_num_nodes +
+	2 * (uint64_t) h.m_num_edges + 2;
+      if (m_size != sizeof (AllocSiteMapHeader) + words * sizeof (uint32_t))
+	return false;
+
+      const uint32_t *p = reinterpret_cast<const uint32_t*> (m_data + sizeof (AllocSiteMapHeader));
+      m_sites = p;     p += h.m_num_sites;
+      m_nodes = p;     p += h.m_num_nodes;
+      m_site_off = p;  p += h.m_num_sites + 1;
+      m_site_adj = p;  p += h.m_num_edges;
+      m_node_off = p;  p += h.m_num_nodes + 1;
+      m_node_adj = p;
+      return checkOffsets (m_site_off, h.m_num_sites, h.m_num_edges) &&
+	checkOffsets (m_node_off, h.m_num_nodes, h.m_num_edges);
+    }
+
+    // The offsets of each site (or node) must delimit a range of the
+    // adjacency table: they start at 0, never decrease and end at
+    // num_edges.
+    static bool checkOffsets (const uint32_t *off, uint32_t num_keys, uint32_t num_edges) {
+      if (off [0] != 0 || off [num_keys] != num_edges) return false;
+      for (uint32_t i = 0; i < num_keys; ++i)
+	if (off [i] > off [i + 1]) return false;
+      return true;
+    }
+
+    void reset () {
+      if (m_mapped) munmap (const_cast<char*> (m_data), m_size);
+      m_data = nullptr;
+      m_size = 0;
+      m_mapped = false;
+    }
+
+  public:
+
+    AllocSiteMap (): m_data (nullptr), m_size (0), m_mapped (false) {}
+
+    AllocSiteMap (const AllocSiteMap&) = delete;
+    AllocSiteMap &operator= (const AllocSiteMap&) = delete;
+
+    ~AllocSiteMap () { reset (); }
+
+    // Use a mapping already in memory. The data must be 4-byte
+    // aligned and outlive this object.
+    bool load (const void *data, size_t size) {
+      reset ();
+      m_data = static_cast<const char*> (data);
+      m_size = size;
+      if (init ()) return true;
+      reset ();
+      return false;
+    }
+
+    // Map the file in memory
+    bool open (const std::string &filename) {
+      reset ();
+      int fd = ::open (filename.c_str (), O_RDONLY);
+      if (fd < 0) return false;
+      struct stat st;
+      void *data = MAP_FAILED;
+      if (fstat (fd, &st) == 0 && st.st_size > 0)
+	data = mmap (nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      ::close (fd);
+      if (data == MAP_FAILED) return false;
+
+      m_data = static_cast<const char*> (data);
+      m_size = st.st_size;
+      m_mapped = true;
+      if (init ()) return true;
+      reset ();
+      return false;
+    }
+
+    bool isValid () const { return m_data != nullptr; }
+
+    uint32_t numSites () const { return header ().m_num_sites; }
+    uint32_t numNodes () const { return header ().m_num_nodes; }
+
+    // All allocation sites and nodes, sorted
+    IdRange sites () const { return IdRange (m_sites, m_sites + numSites ()); }
+    IdRange nodes () const { return IdRange (m_nodes, m_nodes + numNodes ()); }
+
+    // Nodes of an allocation site (empty if unknown)
+    IdRange getNodes (uint32_t site) const
+    { return find (m_sites, numSites (), m_site_off, m_site_adj, site); }
+
+    // Allocation sites of a node (empty if unknown)
+    IdRange getSites (uint32_t node) const
+    { return find (m_nodes, numNodes (), m_node_off, m_node_adj, node); }
+  };
+}
+#endif
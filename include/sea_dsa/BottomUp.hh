@@ -15,11 +15,43 @@ namespace llvm
   class DataLayout;
   class TargetLibraryInfo;
   class CallGraph;
+  class CallGraphNode;
 }
 
 namespace sea_dsa
 {
 
+  // Graphs computed by a previous run of the analysis. A graph is
+  // only returned if the hash given by the caller is the same as the
+  // one recorded by the previous run.
+  class GraphCache
+  {
+  public:
+    
+    typedef std::shared_ptr<Graph> GraphRef;
+    
+    virtual ~GraphCache () {}
+    
+    // Return the bottom-up graph of fn or null. The hash covers the
+    // SCC of fn and all its callees.
+    virtual GraphRef getBottomUpGraph (const llvm::Function &fn, uint64_t hash) = 0;
+    
+    // Record the bottom-up graph of fn computed by this run
+    virtual void addBottomUpGraph (const llvm::Function &fn, uint64_t hash,
+				   const Graph &g) = 0;
+    
+    // Return the final graph of fn or null. The hash is the one of
+    // the bottom-up graph of fn.
+    virtual GraphRef getGraph (const llvm::Function &fn, uint64_t hash) = 0;
+    
+    // Return true if the IR of fn had the same fingerprint in the
+    // previous run
+    virtual bool hasFingerprint (const llvm::Function &fn, uint64_t fp) = 0;
+    
+    // Record the fingerprint of the IR of fn computed by this run
+    virtual void addFingerprint (const llvm::Function &fn, uint64_t fp) = 0;
+  };
+  
   class BottomUpAnalysis {
 
   public:
@@ -37,6 +69,20 @@ namespace sea_dsa
     const llvm::TargetLibraryInfo &m_tli;
     llvm::CallGraph &m_cg;
     CalleeCallerMapping m_callee_caller_map;
+    // previous results (optional)
+    GraphCache *m_cache;
+    // hash of the SCC of each function and its callees
+    llvm::DenseMap<const llvm::Function*, uint64_t> m_hashes;
+    // fingerprint of the module, part of the hash of every SCC
+    uint64_t m_module_hash;
+    // functions whose graph was not taken from m_cache
+    boost::container::flat_set<const llvm::Function*> m_recomputed;
+    // functions whose IR changed since the previous run
+    boost::container::flat_set<const llvm::Function*> m_edited;
+    
+    // hash of the functions of the scc and of the hashes of its
+    // callees. It also records which functions of the scc were edited.
+    uint64_t sccHash (const std::vector<llvm::CallGraphNode*> &scc);
     
     // sanity check
     bool checkAllNodesAreMapped (const llvm::Function &callee,
@@ -53,13 +99,41 @@ namespace sea_dsa
     static void cloneAndResolveArguments (const DsaCallSite &CS, 
 					  Graph& calleeG, Graph& callerG);
     
+    // Hash of the IR of a function
+    static uint64_t fingerprint (const llvm::Function &fn);
+    
+    // Hash of what the graph of any function also depends on: the
+    // data layout, the bodies of the named struct types and the
+    // global variables with their initializers
+    static uint64_t fingerprint (const llvm::Module &M);
+    
     BottomUpAnalysis (const llvm::DataLayout &dl,
 		      const llvm::TargetLibraryInfo &tli,
-		      llvm::CallGraph &cg) 
-      : m_dl(dl), m_tli(tli), m_cg(cg) {}
+		      llvm::CallGraph &cg, GraphCache *cache = nullptr) 
+      : m_dl(dl), m_tli(tli), m_cg(cg), m_cache (cache), m_module_hash (0) {}
     
+    // Compute the graphs of all SCCs whose functions have a graph
+    // allocated in graphs
     bool runOnModule (llvm::Module &M, GraphMap &graphs);
     
+    // Compute the graph shared by the functions of an SCC. The graph
+    // of each function of the SCC must be allocated in graphs and the
+    // graphs of its callees must be already computed.
+    void runOnSCC (const std::vector<llvm::CallGraphNode*> &scc, GraphMap &graphs);
+    
+    // Hash of the SCC of fn and all its callees
+    uint64_t getHash (const llvm::Function &fn) const
+    { return m_hashes.lookup (&fn); }
+    
+    // Return true if the graph of fn was computed rather than taken
+    // from the cache
+    bool isRecomputed (const llvm::Function &fn) const
+    { return m_recomputed.count (&fn) > 0; }
+    
+    // Return true if the IR of fn changed since the previous run
+    bool isEdited (const llvm::Function &fn) const
+    { return m_edited.count (&fn) > 0; }
+    
     typedef typename CalleeCallerMapping::const_iterator callee_caller_mapping_const_iterator;
     
     callee_caller_mapping_const_iterator callee_caller_mapping_begin () const 
@@ -67,6 +141,9 @@ namespace sea_dsa
     
     callee_caller_mapping_const_iterator callee_caller_mapping_end () const 
     { return m_callee_caller_map.end(); }
+    
+    // Bytes used by the callee-caller mappings (estimated)
+    uint64_t mappersMemoryUsage () const;
   };
   
   class BottomUp : public llvm::ModulePass
@@ -0,0 +1,117 @@
+#ifndef __DSA_COLLAPSE_PROFILE_HH_
+#define __DSA_COLLAPSE_PROFILE_HH_
+
+#include <map>
+#include <string>
+#include <tuple>
+#include <cstdint>
+
+/*
+   Record why, where and at which cost nodes are collapsed.
+
+   Enabled by -sea-dsa-collapse-profile or by
+   -sea-dsa-collapse-profile-to-file. Each collapse is attributed to
+   its reason and to the phase, function and instruction being
+   processed when it happened (see CollapseProfile::Scope). The
+   profile of the current thread is reported by -sea-dsa-stats and
+   written to the file (CSV, or JSON if the file name ends with
+   .json) at the end of DsaAnalysis.
+*/
+
+namespace llvm {
+  class Function;
+  class Instruction;
+  class raw_ostream;
+}
+
+namespace sea_dsa {
+
+  // Why a node lost its field sensitivity
+  enum CollapseReason {
+    COLLAPSE_ARRAY_GROW,        // an array node had to grow
+    COLLAPSE_MERGE_COLLAPSED,   // unified with a collapsed node
+    COLLAPSE_ARRAY_AT_OFFSET,   // an array unified at a non-zero offset of a non-array
+    COLLAPSE_ARRAY_SIZES,       // arrays of incompatible sizes unified
+    COLLAPSE_ARRAYS_AT_OFFSET,  // arrays unified at a non-zero offset
+    COLLAPSE_OUT_OF_ARRAY,      // a non-array unified past the end of an array
+    COLLAPSE_SELF_AT_OFFSET,    // a node unified with itself at another offset
+    NUM_COLLAPSE_REASONS
+  };
+
+  // Phase of the analysis that causes a collapse
+  enum CollapsePhase {
+    PHASE_UNKNOWN,
+    PHASE_LOCAL,
+    PHASE_BOTTOM_UP,
+    PHASE_TOP_DOWN,
+    PHASE_CONTEXT_INSENSITIVE,
+    NUM_COLLAPSE_PHASES
+  };
+
+  const char *collapseReasonName (CollapseReason r);
+  const char *collapsePhaseName (CollapsePhase p);
+
+  class CollapseProfile {
+  public:
+
+    struct Counters {
+      unsigned m_count;
+      // bytes and typed fields of the nodes before they collapsed
+      uint64_t m_lost_bytes;
+      uint64_t m_lost_fields;
+      Counters (): m_count (0), m_lost_bytes (0), m_lost_fields (0) {}
+    };
+
+    // Set the phase, function and instruction of the collapses
+    // happening during its lifetime
+    class Scope {
+      CollapsePhase m_phase;
+      const llvm::Function *m_fn;
+      const llvm::Instruction *m_inst;
+      bool m_active;
+    public:
+      Scope (CollapsePhase phase, const llvm::Function *fn,
+	     const llvm::Instruction *inst = nullptr);
+      ~Scope ();
+    };
+
+  private:
+
+    typedef std::tuple<CollapseReason, CollapsePhase,
+		       const llvm::Function*, const llvm::Instruction*> Key;
+
+    std::map<Key, Counters> m_events;
+    // -- the current context
+    CollapsePhase m_phase;
+    const llvm::Function *m_fn;
+    const llvm::Instruction *m_inst;
+
+    CollapseProfile (): m_phase (PHASE_UNKNOWN), m_fn (nullptr), m_inst (nullptr) {}
+
+  public:
+
+    static bool isEnabled ();
+
+    // The profile of the current thread
+    static CollapseProfile &get ();
+
+    void record (CollapseReason reason, unsigned size, unsigned fields);
+
+    void clear () { m_events.clear (); }
+
+    bool empty () const { return m_events.empty (); }
+
+    // Totals per reason and per phase, and the functions and
+    // instructions with more collapses
+    void printSummary (llvm::raw_ostream &o, unsigned top = 5) const;
+
+    // One line (object) per reason, phase, function and instruction
+    void writeCSV (llvm::raw_ostream &o) const;
+    void writeJSON (llvm::raw_ostream &o) const;
+
+    // Write the profile into the file given by
+    // -sea-dsa-collapse-profile-to-file, if any
+    void writeToFile () const;
+  };
+}
+#endif
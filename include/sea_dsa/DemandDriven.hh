@@ -0,0 +1,131 @@
+#ifndef __DSA_DEMAND_DRIVEN_HH_
+#define __DSA_DEMAND_DRIVEN_HH_
+
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Function.h"
+#include "llvm/Pass.h"
+#include "llvm/ADT/DenseMap.h"
+
+#include "sea_dsa/Graph.hh"
+#include "sea_dsa/BottomUp.hh"
+
+#include "boost/container/flat_set.hpp"
+
+#include <string>
+#include <vector>
+
+namespace llvm
+{
+  class DataLayout;
+  class TargetLibraryInfo;
+  class CallGraph;
+}
+
+namespace sea_dsa
+{
+
+  // Answer queries about a few values without analyzing the whole
+  // module.
+  //
+  // The first query about a function computes the bottom-up graphs
+  // of the function, its callers (transitively) and their callees.
+  // Then the graph of the function is refined top-down (and
+  // bottom-up) as in ContextSensitiveGlobalAnalysis but only along
+  // the call paths from its callers. Answers are memoized until a
+  // later query changes a graph that was already refined.
+  //
+  // Unlike ContextSensitiveGlobalAnalysis, unique scalars and
+  // allocation sites are not normalized across callsites.
+  class DemandDrivenAnalysis
+  {
+  public:
+
+    typedef typename Graph::SetFactory SetFactory;
+
+  private:
+
+    typedef BottomUpAnalysis::GraphRef GraphRef;
+    typedef BottomUpAnalysis::GraphMap GraphMap;
+    typedef boost::container::flat_set<const llvm::Function*> FunctionSet;
+    typedef std::vector<const llvm::Instruction*> CallSiteVector;
+
+    const llvm::DataLayout &m_dl;
+    llvm::CallGraph &m_cg;
+    SetFactory &m_setFactory;
+    BottomUpAnalysis m_bu;
+    // graphs computed so far
+    GraphMap m_graphs;
+    // callsites to each defined function
+    llvm::DenseMap<const llvm::Function*, CallSiteVector> m_uses;
+    bool m_uses_built;
+    // functions whose graph has been refined by all its callers
+    FunctionSet m_refined;
+    // memoized answers
+    llvm::DenseMap<std::pair<const llvm::Function*, const llvm::Value*>, Cell> m_cells;
+
+    void buildUses ();
+
+    // Compute the bottom-up graph of fn and all its callees
+    void computeBottomUp (const llvm::Function &fn);
+
+    // Propagate information from the callers of fn
+    void computeTopDown (const llvm::Function &fn);
+
+  public:
+
+    DemandDrivenAnalysis (const llvm::DataLayout &dl,
+			  const llvm::TargetLibraryInfo &tli,
+			  llvm::CallGraph &cg, SetFactory &setFactory)
+      : m_dl (dl), m_cg (cg), m_setFactory (setFactory),
+	m_bu (dl, tli, cg), m_uses_built (false) {}
+
+    // Return true if fn has a body
+    bool hasGraph (const llvm::Function &fn) const
+    { return !fn.isDeclaration () && !fn.empty (); }
+
+    // Return the graph of fn refined by all its callers. The graph
+    // can be modified by a later query about another function.
+    Graph &getGraph (const llvm::Function &fn);
+
+    // Return the cell of v in the graph of fn or a null cell if v
+    // has no cell.
+    Cell getCell (const llvm::Function &fn, const llvm::Value &v);
+
+    // Same as above but the function is the one that defines v.
+    // Return a null cell if v is not an argument or an instruction.
+    Cell getCell (const llvm::Value &v);
+
+    // number of functions with a graph
+    unsigned numGraphs () const { return m_graphs.size (); }
+  };
+
+  // Llvm pass that only creates a DemandDrivenAnalysis: graphs are
+  // computed by the queries of its clients.
+  class DemandDrivenDsa : public llvm::ModulePass
+  {
+    Graph::SetFactory m_setFactory;
+    std::unique_ptr<DemandDrivenAnalysis> m_dda;
+
+  public:
+
+    static char ID;
+
+    DemandDrivenDsa ();
+
+    void getAnalysisUsage (llvm::AnalysisUsage &AU) const override;
+
+    bool runOnModule (llvm::Module &M) override;
+
+    const char * getPassName() const override
+    { return "Demand-driven Dsa pass"; }
+
+    DemandDrivenAnalysis &getDemandDrivenAnalysis () { return *m_dda; }
+  };
+
+  // Print the demand-driven cell of each query FN:VALUE where VALUE
+  // is either %name (or name) in FN or @name. With compare, also
+  // print the cell of the same value in the graph of DsaAnalysis.
+  llvm::Pass *createDsaDemandQueryPass (const std::vector<std::string> &queries,
+					bool compare);
+}
+#endif
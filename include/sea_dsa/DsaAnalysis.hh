@@ -16,6 +16,7 @@ namespace llvm  {
     class TargetLibraryInfo;
     class CallGraph;
     class Value;
+    class raw_ostream;
 }
 
 namespace sea_dsa {
@@ -54,6 +55,16 @@ namespace sea_dsa {
   llvm::Pass *createDsaPrintStatsPass ();  
   llvm::Pass *createDsaPrinterPass ();
   llvm::Pass *createDsaViewerPass ();
+  llvm::Pass *createDsaAnnotatePass ();
+  // member of the llvm::AliasAnalysis group
+  llvm::Pass *createDsaAliasAnalysisPass ();
+  
+  // Same as above but the outputs go to the given file, stream or
+  // directory rather than the ones selected by the command line
+  // options. Used to analyze several modules in one process.
+  llvm::Pass *createDsaInfoPass (const std::string &infoFile);
+  llvm::Pass *createDsaPrintStatsPass (llvm::raw_ostream &o);
+  llvm::Pass *createDsaPrinterPass (const std::string &outDir);
 }
 
 #endif 
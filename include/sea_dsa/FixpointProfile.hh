@@ -0,0 +1,122 @@
+#ifndef __DSA_FIXPOINT_PROFILE_HH_
+#define __DSA_FIXPOINT_PROFILE_HH_
+
+#include "llvm/ADT/DenseMap.h"
+
+#include <chrono>
+#include <vector>
+#include <cstdint>
+
+/*
+   Record the cost of each callsite in the top-down/bottom-up fixpoint
+   of the context-sensitive analysis.
+
+   Enabled by -sea-dsa-fixpoint-profile or by
+   -sea-dsa-fixpoint-trace. For each callsite we record how many
+   times it is dequeued, the time spent deciding which propagation is
+   needed, the time spent cloning and resolving arguments and the
+   nodes created by the propagations. The callsites with the highest
+   cost are reported by -sea-dsa-stats. With -sea-dsa-fixpoint-trace
+   each decision and propagation is also written as an event of a
+   Chrome trace (chrome://tracing or ui.perfetto.dev) at the end of
+   DsaAnalysis.
+*/
+
+namespace llvm {
+  class Instruction;
+  class raw_ostream;
+}
+
+namespace sea_dsa {
+
+  enum FixpointEventKind {
+    FIXPOINT_DECIDE,
+    FIXPOINT_TOP_DOWN,
+    FIXPOINT_BOTTOM_UP
+  };
+
+  const char *fixpointEventName (FixpointEventKind k);
+
+  class FixpointProfile {
+  public:
+
+    typedef std::chrono::steady_clock clock;
+
+    struct Counters {
+      unsigned m_dequeues;
+      unsigned m_td_props;
+      unsigned m_bu_props;
+      // -- nanoseconds
+      uint64_t m_decide_time;
+      uint64_t m_clone_time;
+      uint64_t m_nodes_created;
+      Counters (): m_dequeues (0), m_td_props (0), m_bu_props (0),
+		   m_decide_time (0), m_clone_time (0), m_nodes_created (0) {}
+      uint64_t time () const { return m_decide_time + m_clone_time; }
+    };
+
+    // One decision or propagation of the fixpoint
+    struct Event {
+      FixpointEventKind m_kind;
+      const llvm::Instruction *m_cs;
+      // -- nanoseconds since the profile was cleared
+      uint64_t m_start;
+      uint64_t m_duration;
+      uint64_t m_nodes_created;
+    };
+
+    // Attribute the time and the nodes created during its lifetime to
+    // a callsite
+    class Scope {
+      friend class FixpointProfile;
+      FixpointEventKind m_kind;
+      const llvm::Instruction *m_cs;
+      clock::time_point m_start;
+      uint64_t m_last_id;
+      bool m_active;
+    public:
+      Scope (FixpointEventKind kind, const llvm::Instruction *cs);
+      ~Scope ();
+    };
+
+  private:
+
+    llvm::DenseMap<const llvm::Instruction*, Counters> m_callsites;
+    std::vector<Event> m_events;
+    clock::time_point m_start;
+
+    FixpointProfile (): m_start (clock::now ()) {}
+
+    void record (const Scope &s);
+
+  public:
+
+    static bool isEnabled ();
+
+    // The profile of the current thread
+    static FixpointProfile &get ();
+
+    void recordDequeue (const llvm::Instruction *cs)
+    { m_callsites [cs].m_dequeues++; }
+
+    void clear () {
+      m_callsites.clear ();
+      m_events.clear ();
+      m_start = clock::now ();
+    }
+
+    bool empty () const { return m_callsites.empty (); }
+
+    // Totals and the callsites with the highest cost (as many as
+    // -sea-dsa-fixpoint-profile-top)
+    void printSummary (llvm::raw_ostream &o) const;
+
+    // The events in the Chrome trace event format
+    void writeTrace (llvm::raw_ostream &o) const;
+
+    // Write the trace into the file given by -sea-dsa-fixpoint-trace,
+    // if any
+    void writeToFile () const;
+  };
+}
+#endif
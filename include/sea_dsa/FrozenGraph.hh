@@ -0,0 +1,169 @@
+#ifndef __DSA_FROZEN_GRAPH_HH_
+#define __DSA_FROZEN_GRAPH_HH_
+
+#include "llvm/ADT/ArrayRef.h"
+
+#include "sea_dsa/Graph.hh"
+
+#include <vector>
+#include <cstdint>
+
+/*
+   A compact, read-only snapshot of a finished Graph.
+
+   Nodes are numbered from 0 to numNodes () - 1 and their properties
+   are stored in parallel arrays. Links, types and allocation sites
+   are stored in CSR form (one offset array indexed by node plus one
+   array of entries sorted by field offset). Type sets are interned
+   and referred to by id. The cells of scalars, formals and returns
+   are kept in arrays in module order (the order of the functions in
+   the module, then of the arguments, instructions and constants of
+   each function) so that clients that iterate over them do the same
+   thing in every run. They are looked up by binary search in a
+   separate index sorted by key.
+
+   Offsets are stored already adjusted to their node (0 for collapsed
+   nodes, modulo the size for arrays) so following a link is a binary
+   search and nothing else. The snapshot does not refer to the graph
+   it was built from, which can be destroyed.
+
+   GlobalAnalysis::getFrozenGraph builds one snapshot per graph and
+   keeps it. The printer writes graphs from these snapshots and the
+   stats report their size. DsaInfo still works on Graph: its clients
+   get Node references from it.
+*/
+
+namespace llvm {
+  class Value;
+  class Type;
+  class Function;
+  class raw_ostream;
+}
+
+namespace sea_dsa {
+
+  class FrozenGraph {
+  public:
+
+    typedef uint32_t NodeId;
+    static const NodeId NO_NODE = ~0u;
+
+    // A field of a node
+    class Cell {
+      NodeId m_node;
+      uint32_t m_offset;
+    public:
+      Cell (): m_node (NO_NODE), m_offset (0) {}
+      Cell (NodeId n, uint32_t offset): m_node (n), m_offset (offset) {}
+      bool isNull () const { return m_node == NO_NODE; }
+      NodeId getNode () const { return m_node; }
+      uint32_t getOffset () const { return m_offset; }
+      bool operator== (const Cell &o) const
+      { return m_node == o.m_node && m_offset == o.m_offset; }
+      bool operator!= (const Cell &o) const { return !(*this == o); }
+    };
+
+    typedef std::pair<const llvm::Value*, Cell> ScalarEntry;
+    typedef std::pair<const llvm::Function*, Cell> ReturnEntry;
+
+  private:
+
+    // -- nodes (structure of arrays)
+    std::vector<Node::NodeType> m_flags;
+    std::vector<uint32_t> m_size;
+    std::vector<uint64_t> m_ids;
+    std::vector<const llvm::Value*> m_unique_scalar;
+
+    // -- links: m_link_off [n] .. m_link_off [n+1] in m_link_field
+    //    (sorted) and m_link_cell
+    std::vector<uint32_t> m_link_off;
+    std::vector<uint32_t> m_link_field;
+    std::vector<Cell> m_link_cell;
+
+    // -- types: m_type_off [n] .. m_type_off [n+1] in m_type_field
+    //    (sorted) and m_type_set
+    std::vector<uint32_t> m_type_off;
+    std::vector<uint32_t> m_type_field;
+    std::vector<uint32_t> m_type_set;
+    // -- interned type sets: set i is m_set_types [m_set_off [i] .. m_set_off [i+1]]
+    std::vector<uint32_t> m_set_off;
+    std::vector<const llvm::Type*> m_set_types;
+
+    // -- allocation sites
+    std::vector<uint32_t> m_site_off;
+    std::vector<const llvm::Value*> m_sites;
+
+    // -- in module order. Scalars include globals and formals.
+    std::vector<ScalarEntry> m_scalars;
+    std::vector<ReturnEntry> m_returns;
+    // -- positions in m_scalars and m_returns sorted by key
+    std::vector<uint32_t> m_scalar_index;
+    std::vector<uint32_t> m_return_index;
+
+    template <typename T>
+    static llvm::ArrayRef<T> slice (const std::vector<T> &v,
+				    const std::vector<uint32_t> &off, unsigned i)
+    { return llvm::ArrayRef<T> (v.data () + off [i], off [i + 1] - off [i]); }
+
+  public:
+
+    // Forwarding nodes of g are skipped
+    explicit FrozenGraph (const Graph &g);
+
+    unsigned numNodes () const { return m_flags.size (); }
+
+    const Node::NodeType &getNodeType (NodeId n) const { return m_flags [n]; }
+    bool isCollapsed (NodeId n) const { return m_flags [n].collapsed; }
+    bool isArray (NodeId n) const { return m_flags [n].array; }
+    bool isRead (NodeId n) const { return m_flags [n].read; }
+    bool isModified (NodeId n) const { return m_flags [n].modified; }
+    uint32_t size (NodeId n) const { return m_size [n]; }
+    // Node::getId of the original node
+    uint64_t getId (NodeId n) const { return m_ids [n]; }
+    const llvm::Value *getUniqueScalar (NodeId n) const { return m_unique_scalar [n]; }
+
+    llvm::ArrayRef<const llvm::Value*> getAllocSites (NodeId n) const
+    { return slice (m_sites, m_site_off, n); }
+
+    // Field offsets with a link and their destinations
+    llvm::ArrayRef<uint32_t> getLinkFields (NodeId n) const
+    { return slice (m_link_field, m_link_off, n); }
+    llvm::ArrayRef<Cell> getLinkCells (NodeId n) const
+    { return slice (m_link_cell, m_link_off, n); }
+
+    // Field offsets with a type and the ids of their type sets
+    llvm::ArrayRef<uint32_t> getTypeFields (NodeId n) const
+    { return slice (m_type_field, m_type_off, n); }
+    llvm::ArrayRef<uint32_t> getTypeSets (NodeId n) const
+    { return slice (m_type_set, m_type_off, n); }
+
+    unsigned numTypeSets () const { return m_set_off.size () - 1; }
+    llvm::ArrayRef<const llvm::Type*> getTypeSet (uint32_t id) const
+    { return slice (m_set_types, m_set_off, id); }
+
+    // Offset adjusted to the node
+    uint32_t adjustOffset (NodeId n, uint64_t offset) const;
+
+    // The link at the offset of c plus offset, or a null cell
+    Cell getLink (const Cell &c, uint32_t offset = 0) const;
+    bool hasLink (const Cell &c, uint32_t offset = 0) const
+    { return !getLink (c, offset).isNull (); }
+
+    // The cell of a scalar, formal or global, or a null cell. Pointer
+    // casts are stripped.
+    Cell getCell (const llvm::Value &v) const;
+    bool hasCell (const llvm::Value &v) const { return !getCell (v).isNull (); }
+
+    Cell getRetCell (const llvm::Function &fn) const;
+
+    llvm::ArrayRef<ScalarEntry> scalars () const { return m_scalars; }
+    llvm::ArrayRef<ReturnEntry> returns () const { return m_returns; }
+
+    // Bytes used by the snapshot
+    uint64_t memoryUsage () const;
+
+    // pretty-printer
+    void write (llvm::raw_ostream &o) const;
+  };
+}
+#endif
@@ -12,6 +12,9 @@
 
 #include "boost/container/flat_set.hpp"
 
+#include <memory>
+#include <mutex>
+
 namespace llvm
 {
   class DataLayout;
@@ -21,24 +24,97 @@ namespace llvm
 
 namespace sea_dsa {
   
+  class FrozenGraph;
+  
   enum GlobalAnalysisKind {
     CONTEXT_INSENSITIVE,
-    CONTEXT_SENSITIVE
+    CONTEXT_SENSITIVE,
+    HYBRID
+  };
+  
+  class GlobalAnalysis;
+  
+  // A graph of a global analysis that stays in memory for as long as
+  // the handle lives (see GlobalAnalysis::getGraphHandle). Handles
+  // can be moved but not copied.
+  class GraphHandle
+  {
+    const GlobalAnalysis *m_ga;
+    const Graph *m_graph;
+    const void *m_key;
+    
+  public:
+    
+    GraphHandle (): m_ga (nullptr), m_graph (nullptr), m_key (nullptr) {}
+    
+    // If ga is not null then ga->releaseGraph (key) is called when
+    // the handle is released
+    GraphHandle (const GlobalAnalysis *ga, const Graph &g, const void *key)
+      : m_ga (ga), m_graph (&g), m_key (key) {}
+    
+    GraphHandle (GraphHandle &&o)
+      : m_ga (o.m_ga), m_graph (o.m_graph), m_key (o.m_key)
+    { o.m_ga = nullptr; o.m_graph = nullptr; }
+    
+    GraphHandle &operator= (GraphHandle &&o);
+    
+    GraphHandle (const GraphHandle &o) = delete;
+    GraphHandle &operator= (const GraphHandle &o) = delete;
+    
+    ~GraphHandle () { reset (); }
+    
+    void reset ();
+    
+    const Graph *get () const { return m_graph; }
+    const Graph &operator* () const { return *m_graph; }
+    const Graph *operator-> () const { return m_graph; }
+    
+    // Identifies the graph among the graphs of the analysis, even if
+    // it is freed and loaded again. Functions with the same graph
+    // have the same key.
+    const void *getKey () const { return m_key; }
   };
   
   // Common API for global analyses
   class GlobalAnalysis 
   {
+    friend class GraphHandle;
+    
+    // Called when the last handle of the graph with the given key
+    // is released
+    virtual void releaseGraph (const void *key) const {}
+    
   protected:
     
     GlobalAnalysisKind _kind;
+    // functions reachable from the entry points (empty if all
+    // functions are analyzed)
+    boost::container::flat_set<const llvm::Function*> m_reachable;
+    // bytes of the simulation mappers at the end of the last run,
+    // just before they are freed
+    uint64_t m_mappers_memory;
+    // snapshots of the graphs by handle key (see getFrozenGraph)
+    mutable std::mutex m_frozen_mutex;
+    mutable llvm::DenseMap<const void*, std::shared_ptr<const FrozenGraph> > m_frozen;
+    
+    // Return true if the graph of fn must be computed
+    bool isReachable (const llvm::Function &fn) const
+    { return m_reachable.empty () || m_reachable.count (&fn) > 0; }
     
   public:
     
-    GlobalAnalysis (GlobalAnalysisKind kind): _kind (kind) { }
+    GlobalAnalysis (GlobalAnalysisKind kind): _kind (kind), m_mappers_memory (0) { }
+    
+    virtual ~GlobalAnalysis () {}
     
     GlobalAnalysisKind kind () const { return _kind;}
     
+    // Only analyze the functions reachable from entries in the call
+    // graph. The others have no graph. Must be called before
+    // runOnModule.
+    void setEntryPoints (llvm::CallGraph &cg,
+			 const std::vector<const llvm::Function*> &entries);
+    
     virtual bool runOnModule (llvm::Module &M) = 0;
     
     virtual const Graph& getGraph (const llvm::Function &F) const = 0;
@@ -46,6 +122,53 @@ namespace sea_dsa {
     virtual Graph& getGraph (const llvm::Function &F) = 0;
     
     virtual bool hasGraph (const llvm::Function &F) const = 0 ;
+    
+    // Graphs returned by getGraph stay in memory as long as the
+    // analysis. Some analyses (see SerializedGlobalAnalysis) can
+    // instead free a graph once all the handles returned for it by
+    // getGraphHandle are released, and load it again when asked
+    // for. Clients that only read the graphs one at a time should
+    // use handles.
+    virtual GraphHandle getGraphHandle (const llvm::Function &F) const
+    {
+      const Graph &g = getGraph (F);
+      return GraphHandle (nullptr, g, &g);
+    }
+    // Return true if graphs only reached through handles can be freed
+    virtual bool canEvictGraphs () const { return false; }
+    
+    // The snapshot of the graph of F (see FrozenGraph), built the
+    // first time it is asked for and shared by all the functions of
+    // the graph. The graph must not be modified afterwards. Snapshots
+    // of graphs that can be evicted are not kept since they would
+    // use as much memory as the graphs. Thread-safe if getGraphHandle
+    // is.
+    std::shared_ptr<const FrozenGraph> getFrozenGraph (const llvm::Function &F) const;
+    
+    // Bytes used by the graphs of M (each graph counted once)
+    Graph::MemoryUsage memoryUsage (const llvm::Module &M) const;
+    
+    // Bytes of the simulation mappers of the last run when they were
+    // freed. They are not part of memoryUsage since they do not
+    // outlive runOnModule.
+    uint64_t mappersMemoryUsage () const { return m_mappers_memory; }
+    
+    // Keep only the cells of the scalars queried by clients: pointer
+    // operands of memory accesses, callsites and their arguments,
+    // formals and globals, plus the results of the instructions whose
+    // opcode name (e.g., "phi") is in keep. Then dead nodes are
+    // removed (see Graph::pruneScalars).
+    void pruneScalars (const llvm::Module &M,
+		       const std::vector<std::string> &keep = std::vector<std::string> ());
+    
+    // Create in each graph of M the cells of the global values
+    // reached by the code of its functions (see Graph::mkGlobalCells)
+    // so that they exist whether or not the graphs are frozen.
+    void mkGlobalCells (const llvm::Module &M);
+    
+    // Freeze the graphs of M (see Graph::freeze). Afterwards the
+    // graphs can be queried concurrently through const references.
+    void freeze (const llvm::Module &M);
   };  
   
   // Context-insensitive dsa analysis
@@ -109,39 +232,74 @@ namespace sea_dsa {
     
     typedef typename Graph::SetFactory SetFactory;
     
-  private:
+  protected:
     
     typedef std::shared_ptr<Graph> GraphRef;
     typedef BottomUpAnalysis::GraphMap GraphMap;
-    enum PropagationKind {DOWN, UP, NONE};
     
     const llvm::DataLayout &m_dl;
     const llvm::TargetLibraryInfo &m_tli;
     llvm::CallGraph &m_cg;
     SetFactory &m_setFactory;
+    GraphCache *m_cache;
+    
+    ContextSensitiveGlobalAnalysis (GlobalAnalysisKind kind,
+				    const llvm::DataLayout &dl,
+				    const llvm::TargetLibraryInfo &tli,
+				    llvm::CallGraph &cg, SetFactory &setFactory) 
+      : GlobalAnalysis (kind), 
+	m_dl(dl), m_tli(tli), m_cg(cg), m_setFactory (setFactory),
+	m_cache (nullptr) {}
     
   public:
+    
+    enum PropagationKind {DOWN, UP, NONE};
+    
     GraphMap m_graphs;
     
-    void cloneAndResolveArguments (const DsaCallSite &cs, 
-				   Graph& callerG, Graph& calleeG);
+    static void cloneAndResolveArguments (const DsaCallSite &cs, 
+					  Graph& callerG, Graph& calleeG);
     
-    PropagationKind decidePropagation (const DsaCallSite& cs, 
-				       Graph &callerG, Graph& calleeG);
+    static PropagationKind decidePropagation (const DsaCallSite& cs, 
+					      Graph &calleeG, Graph& callerG);
     
-    void propagateTopDown(const DsaCallSite& cs, Graph &callerG, Graph& calleeG); 
+    static void propagateTopDown(const DsaCallSite& cs, Graph &callerG, Graph& calleeG); 
     
-    void propagateBottomUp(const DsaCallSite& cs, Graph &calleeG, Graph& callerG); 
+    static void propagateBottomUp(const DsaCallSite& cs, Graph &calleeG, Graph& callerG); 
     
     bool checkNoMorePropagation ();
     
+  protected:
+    
+    // Create a graph for each defined function 
+    virtual void allocateGraphs (llvm::Module &M);
+    
+    // Return true if cs must be ignored by the top-down/bottom-up
+    // fixpoint
+    virtual bool skipCallSite (const DsaCallSite &cs) const { return false; }
+    
+    // Enqueue all callsites that might need propagation after the
+    // graph of fn changed
+    virtual void enqueueCallSites (const llvm::Function &fn, DsaCallGraph &dsaCG,
+				   WorkList<const llvm::Instruction*> &w);
+    
+    // Replace the graph of each function by the one in m_cache if
+    // neither the function nor its callees changed
+    void reuseGraphs (llvm::Module &M, const BottomUpAnalysis &bu,
+		      boost::container::flat_set<const llvm::Function*> &reused);
+    
   public:
     
     ContextSensitiveGlobalAnalysis (const llvm::DataLayout &dl,
 				    const llvm::TargetLibraryInfo &tli,
 				    llvm::CallGraph &cg, SetFactory &setFactory) 
       : GlobalAnalysis (CONTEXT_SENSITIVE), 
-	m_dl(dl), m_tli(tli), m_cg(cg), m_setFactory (setFactory) {}
+	m_dl(dl), m_tli(tli), m_cg(cg), m_setFactory (setFactory),
+	m_cache (nullptr) {}
+    
+    // Reuse the graphs of a previous run if the IR did not
+    // change. Only used if the kind is CONTEXT_SENSITIVE.
+    void setCache (GraphCache *cache) { m_cache = cache; }
     
     bool runOnModule (llvm::Module &M) override;
     
@@ -152,6 +310,84 @@ namespace sea_dsa {
     bool hasGraph (const llvm::Function& fn) const override;
   };
 
+  // Size of an SCC of the call graph as seen by HybridPolicy
+  struct SccSummary 
+  {
+    // number of defined functions in the SCC
+    unsigned m_num_functions;
+    // number of callsites to defined functions made from the SCC
+    unsigned m_num_callsites;
+    // number of pointer-typed values in the SCC. It is an upper
+    // bound of the number of cells of the local graph and it is used
+    // to estimate the graph size before the graph is built.
+    unsigned m_graph_size;
+    
+    SccSummary (): m_num_functions (0), m_num_callsites (0), m_graph_size (0) {}
+  };
+  
+  // Decide which SCCs are analyzed context-insensitively by
+  // HybridGlobalAnalysis
+  class HybridPolicy
+  {
+    unsigned m_max_scc_size;
+    unsigned m_max_callsites;
+    unsigned m_max_graph_size;
+    
+  public:
+    
+    // An SCC is context-insensitive if it exceeds any of the
+    // thresholds. A threshold equal to 0 is ignored.
+    HybridPolicy (unsigned max_scc_size, unsigned max_callsites,
+		  unsigned max_graph_size)
+      : m_max_scc_size (max_scc_size), m_max_callsites (max_callsites),
+	m_max_graph_size (max_graph_size) {}
+    
+    virtual ~HybridPolicy () {}
+    
+    virtual bool isContextInsensitive (const SccSummary &scc) const;
+  };
+  
+  // Hybrid dsa analysis: context-sensitive except for the SCCs
+  // selected by a HybridPolicy. A selected SCC and the SCCs of its
+  // direct callers share a single graph so that the callsites
+  // between them are resolved by unification rather than by the
+  // top-down/bottom-up fixpoint.
+  class HybridGlobalAnalysis: public ContextSensitiveGlobalAnalysis
+  {
+    typedef std::unique_ptr<HybridPolicy> HybridPolicyRef;
+    typedef std::vector<const llvm::Function*> FunctionVector;
+    
+    HybridPolicyRef m_policy;
+    // functions analyzed context-insensitively
+    boost::container::flat_set<const llvm::Function*> m_ci_fns;
+    // map a shared graph to all the functions that use it
+    llvm::DenseMap<const Graph*, FunctionVector> m_groups;
+    
+  protected:
+    
+    // Functions in a context-insensitive group share one graph
+    void allocateGraphs (llvm::Module &M) override;
+    
+    // Callsites within a group are already resolved by unification
+    bool skipCallSite (const DsaCallSite &cs) const override;
+    
+    void enqueueCallSites (const llvm::Function &fn, DsaCallGraph &dsaCG,
+			   WorkList<const llvm::Instruction*> &w) override;
+    
+  public:
+    
+    HybridGlobalAnalysis (const llvm::DataLayout &dl,
+			  const llvm::TargetLibraryInfo &tli,
+			  llvm::CallGraph &cg, SetFactory &setFactory,
+			  HybridPolicyRef policy)
+      : ContextSensitiveGlobalAnalysis (HYBRID, dl, tli, cg, setFactory),
+	m_policy (std::move (policy)) {}
+    
+    // Return true if fn has been analyzed context-insensitively
+    bool isContextInsensitive (const llvm::Function &fn) const
+    { return m_ci_fns.count (&fn) > 0; }
+  };
+  
   // Llvm passes
   
   class DsaGlobalPass: public llvm::ModulePass 
@@ -213,6 +449,32 @@ namespace sea_dsa {
     
   };
   
+  class HybridGlobal : public DsaGlobalPass
+  {
+    Graph::SetFactory m_setFactory;
+    std::unique_ptr<HybridGlobalAnalysis> m_ga;      
+    
+  public:
+    
+    static char ID;
+    
+    HybridGlobal ();
+    
+    void getAnalysisUsage (llvm::AnalysisUsage &AU) const override;
+    
+    bool runOnModule (llvm::Module &M) override;
+    
+    const char * getPassName() const override 
+    { return "Hybrid global DSA pass"; }
+
+    GlobalAnalysis& getGlobalAnalysis ()  
+    { return *(static_cast<GlobalAnalysis*> (&*m_ga)); } 
+    
+  };
+  
+  // Build the HybridPolicy selected by the command line options
+  std::unique_ptr<HybridPolicy> createHybridPolicy ();
+  
   // Execute operation Op on each callsite until no more changes
   template<class GlobalAnalysis, class Op>
   class CallGraphClosure
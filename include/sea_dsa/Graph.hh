@@ -9,6 +9,9 @@
 
 #include "llvm/ADT/ImmutableSet.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+
+#include "sea_dsa/CollapseProfile.hh"
 
 #include <functional>
 
@@ -31,6 +34,7 @@ namespace sea_dsa {
   
   class FunctionalMapper;
   class DsaCallSite;
+  class GraphSerializer;
   
   // Data structure graph traversal iterator
   template<typename T>
@@ -39,6 +43,7 @@ namespace sea_dsa {
   class Graph
   {
     friend class Node;
+    friend class GraphSerializer;
   public:
     typedef llvm::ImmutableSet<llvm::Type*> Set;
     typedef typename Set::Factory SetFactory;
@@ -62,6 +67,9 @@ namespace sea_dsa {
     typedef llvm::DenseMap<const llvm::Function*, CellRef> ReturnMap;
     ReturnMap m_returns;
     
+    /// true if the graph is read-only (see freeze)
+    bool m_frozen;
+    
     SetFactory &getSetFactory () { return m_setFactory; }
     Set emptySet () { return m_setFactory.getEmptySet (); }
     /// return a new set that is the union of old and a set containing v
@@ -74,13 +82,35 @@ namespace sea_dsa {
     
   public:
     
-    Graph (const llvm::DataLayout &dl, SetFactory &sf) : m_dl (dl), m_setFactory (sf) {}
+    Graph (const llvm::DataLayout &dl, SetFactory &sf)
+      : m_dl (dl), m_setFactory (sf), m_frozen (false) {}
     /// remove all forwarding nodes
     void compress ();
     
+    /// Create a cell for every global value that the code of fns can
+    /// reach: through its operands, constant expressions and the
+    /// initializers of global variables. Direct callees are not
+    /// pointers used by the code and are skipped.
+    void mkGlobalCells (const std::vector<const llvm::Function*> &fns);
+    
+    /// Make the graph read-only: all forwarding is resolved and no
+    /// cell is created anymore. Afterwards, the const methods of the
+    /// graph and of its nodes and cells do not write to memory and
+    /// can be called concurrently without locks (as long as Sets of
+    /// types are not copied since their reference counts are not
+    /// atomic). The graph must not be modified.
+    void freeze ();
+    
+    bool isFrozen () const { return m_frozen; }
+    
     /// remove all dead nodes
     void remove_dead ();
     
+    /// Remove the cells of the scalars that are neither in keep nor
+    /// global values, and then the nodes that become dead. keep must
+    /// contain values without pointer casts (see stripPointerCasts).
+    void pruneScalars (const llvm::DenseSet<const llvm::Value*> &keep);
+    
     /// -- allocates a new node
     Node &mkNode ();
     
@@ -119,12 +149,27 @@ namespace sea_dsa {
     Cell &mkCell (const llvm::Value &v, const Cell &c);
     Cell &mkRetCell (const llvm::Function &fn, const Cell &c);
     
-    /// return a cell for the value
+    /// return a cell for the value. If the graph is not frozen, a
+    /// cell is created for a global value without one.
     const Cell &getCell (const llvm::Value &v);
     
-    /// return true iff the value has a cel
+    /// return the cell of the value or a null cell if it has none
+    /// (e.g., a global value not reached by the code of the graph)
+    const Cell &getCell (const llvm::Value &v) const;
+    
+    /// return the cell of the value or null
+    const Cell *findCell (const llvm::Value &v) const;
+    
+    /// return true iff the value has a cel. Global values are
+    /// implicitly present unless the graph is frozen.
     bool hasCell (const llvm::Value &v) const;
     
+    /// same as mkCell, getCell and hasCell for a value that is
+    /// already canonical (v == v.stripPointerCasts ())
+    Cell &mkCanonicalCell (const llvm::Value &v, const Cell &c);
+    const Cell &getCanonicalCell (const llvm::Value &v);
+    bool hasCanonicalCell (const llvm::Value &v) const;
+    
     bool hasRetCell (const llvm::Function &fn) const
     { return m_returns.count (&fn) > 0; }
     
@@ -141,10 +186,47 @@ namespace sea_dsa {
 					    SimulationMapper& simMap,
 					    const bool reportIfSanityCheckFailed = true);
     
+    /// same as above but the graphs are not modified (e.g., they
+    /// are frozen): values without a cell in either graph are
+    /// skipped
+    static bool computeCalleeCallerMapping (const DsaCallSite &cs, 
+					    const Graph& calleeG, const Graph& callerG,
+					    SimulationMapper& simMap,
+					    const bool reportIfSanityCheckFailed = true);
+    
     /// import the given graph into the current one
     /// copies all nodes from g and unifies all common scalars
     void import (const Graph &g, bool withFormals = false);
     
+    /// bytes used by the graph (estimated from the sizes and
+    /// capacities of its containers)
+    struct MemoryUsage
+    {
+      uint64_t m_nodes;        // Node objects and the node vector
+      uint64_t m_links;        // outgoing links of the nodes
+      uint64_t m_types;        // type maps of the nodes
+      uint64_t m_type_sets;    // ImmutableSet trees (may be shared with other graphs)
+      uint64_t m_alloc_sites;  // allocation site sets
+      uint64_t m_scalars;      // scalar map and its cells
+      uint64_t m_formals;      // formal map and its cells
+      uint64_t m_returns;      // return map and its cells
+      
+      MemoryUsage () : m_nodes (0), m_links (0), m_types (0), m_type_sets (0),
+		       m_alloc_sites (0), m_scalars (0), m_formals (0),
+		       m_returns (0) {}
+      
+      uint64_t total () const
+      { return m_nodes + m_links + m_types + m_type_sets + m_alloc_sites +
+	  m_scalars + m_formals + m_returns; }
+      
+      MemoryUsage &operator+= (const MemoryUsage &o);
+      
+      /// one line per category
+      void write (llvm::raw_ostream &o) const;
+    };
+    
+    MemoryUsage memoryUsage () const;
+    
     /// pretty-printer of a graph
       void write(llvm::raw_ostream&o) const;
   };
@@ -154,6 +236,8 @@ namespace sea_dsa {
   */
   class Cell
   {
+    friend class Graph;
+    
     /// memory object
     mutable Node *m_node;
     /// offset
@@ -229,6 +313,7 @@ namespace sea_dsa {
     
     friend class FunctionalMapper;
     friend class SimulationMapper;
+    friend class GraphSerializer;
     
   public:
     
@@ -361,7 +446,9 @@ namespace sea_dsa {
     typedef boost::container::flat_set<const llvm::Value*> AllocaSet;
     AllocaSet m_alloca_sites;
     
-    static uint64_t m_id_factory;
+    // thread-local so that several modules can be analyzed in
+    // parallel (node ids are only unique per thread)
+    static thread_local uint64_t m_id_factory;
     
     uint64_t m_id; // global id for the node
     
@@ -470,6 +557,9 @@ namespace sea_dsa {
     // global id for the node
     uint64_t getId () const { return m_id;}
     
+    // id of the last node created by the current thread
+    static uint64_t getLastId () { return m_id_factory; }
+    
     Graph *getGraph () { return m_graph; } 
     const Graph *getGraph () const { return m_graph; } 
       
@@ -510,8 +600,7 @@ namespace sea_dsa {
     void addType (unsigned offset, const llvm::Type *t);
     
     /// collapse the current node. Looses all field sensitivity
-    /// tag argument is used for debugging only
-    void collapse (int tag /*= -2*/);
+    void collapse (CollapseReason reason);
     
     /// Add a new allocation site
     void addAllocSite (const llvm::Value &v);
@@ -4,13 +4,16 @@
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Function.h"
 #include "llvm/Pass.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+
+#include "sea_dsa/Global.hh"
 
 #include "boost/container/flat_set.hpp"
-#include <boost/unordered_map.hpp>
-#include <boost/iterator/transform_iterator.hpp>
 #include <boost/range/iterator_range.hpp>
 #include <boost/iterator/filter_iterator.hpp>
-#include <boost/bimap.hpp>
+
+#include <vector>
 
 /* Gater information for dsa clients */
 
@@ -20,17 +23,10 @@ namespace llvm
     class TargetLibraryInfo;
     class Value;
     class Function;
+    class Instruction;
     class raw_ostream;
 }
 
-namespace sea_dsa 
-{
-  class Node;
-  class Graph; 
-  class GlobalAnalysis;
-}
-
-
 namespace sea_dsa {
   
   // Wrapper to extend a dsa node with extra information
@@ -39,14 +35,11 @@ namespace sea_dsa {
     const Node* m_node; 
     unsigned m_id;
     unsigned m_accesses;
-    // Name of one of the node's referrers.
-    // The node is chosen deterministically 
-    std::string m_rep_name;
     
   public:
     
-    NodeWrapper (const Node* node, unsigned id, std::string name)
-      : m_node(node), m_id(id), m_accesses(0), m_rep_name (name) {}
+    NodeWrapper (const Node* node, unsigned id)
+      : m_node(node), m_id(id), m_accesses(0) {}
     
     bool operator==(const NodeWrapper&o) const  {
       // XXX: we do not want to use pointer addresses here
@@ -70,43 +63,54 @@ namespace sea_dsa {
   
   class DsaInfo {
     
-    typedef boost::unordered_map<const Node*, NodeWrapper> NodeWrapperMap;
-    typedef boost::bimap<const llvm::Value*, unsigned int> AllocSiteBiMap;
+    typedef std::vector<NodeWrapper> NodeWrapperVector;
     typedef boost::container::flat_set<const llvm::Value*> ValueSet;
     typedef boost::container::flat_set<unsigned int> IdSet;
-    typedef boost::container::flat_set<NodeWrapper> NodeWrapperSet;
-    typedef boost::container::flat_set<Graph*> GraphSet;
-    typedef boost::unordered_map<const llvm::Value*, std::string> NamingMap;
+    typedef boost::container::flat_set<const Graph*> GraphSet;
     
     const llvm::DataLayout &m_dl;
     const llvm::TargetLibraryInfo &m_tli;
     GlobalAnalysis &m_dsa;
-    NodeWrapperMap m_nodes_map; // map Node to NodeWrapper
-    AllocSiteBiMap m_alloc_sites_bimap; // bimap allocation sites to id
+    // The graphs of all the functions. Nodes are kept by address so
+    // the graphs cannot be freed while DsaInfo is alive.
+    std::vector<GraphHandle> m_handles;
+    llvm::DenseMap<const llvm::Function*, const Graph*> m_graphs;
+    // Ids are dense and follow the order of the module (functions,
+    // arguments and instructions) so they are deterministic without
+    // sorting.
+    NodeWrapperVector m_nodes; // the node with id i is at i-1
+    // The ids are looked up by address: Node::getId is copied when a
+    // node is cloned into another graph so it does not identify a
+    // node of the module.
+    llvm::DenseMap<const Node*, unsigned> m_node_ids;
+    llvm::DenseMap<const llvm::Value*, unsigned> m_alloc_site_ids;
+    std::vector<const llvm::Value*> m_alloc_values; // the site with id i is at i-1
     IdSet m_alloc_sites_set;
-    NamingMap m_names; // map Value to string name
     GraphSet m_seen_graphs;
-
-    
-    typedef typename NodeWrapperMap::value_type binding_t;
-    struct get_second : public std::unary_function<binding_t, NodeWrapper> 
-    { const NodeWrapper& operator()(const binding_t &kv) const {
-	return kv.second;
-      }
+    // file where pairs of allocation site and node are written (if any)
+    std::string m_info_file;
+    
+    // nodes read and modified, indexed by the position of the node
+    // in its graph. The ids of getDsaNodeId span the whole module so
+    // sets indexed by them would be as large as all the nodes.
+    struct ModRef {
+      llvm::BitVector m_ref;
+      llvm::BitVector m_mod;
     };
+    // position of each node in its graph
+    llvm::DenseMap<const Node*, unsigned> m_node_index;
+    // mod/ref of the functions that share each graph
+    llvm::DenseMap<const Graph*, ModRef> m_graph_modref;
+    // mod/ref of each callsite over the nodes of the caller graph
+    llvm::DenseMap<const llvm::Instruction*, ModRef> m_cs_modref;
+
     
-    typedef boost::transform_iterator<get_second,
-				      typename NodeWrapperMap::const_iterator>
-    nodes_const_iterator;
+    typedef typename NodeWrapperVector::const_iterator nodes_const_iterator;
     typedef boost::iterator_range<nodes_const_iterator> nodes_const_range;
         
-    nodes_const_iterator nodes_begin () const {
-      return boost::make_transform_iterator(m_nodes_map.begin(), get_second());
-    }
+    nodes_const_iterator nodes_begin () const { return m_nodes.begin(); }
     
-    nodes_const_iterator nodes_end () const {
-      return boost::make_transform_iterator(m_nodes_map.end(), get_second());
-    }
+    nodes_const_iterator nodes_end () const { return m_nodes.end(); }
     
     nodes_const_range nodes () const {
       return boost::make_iterator_range(nodes_begin (), nodes_end());
@@ -132,17 +136,25 @@ namespace sea_dsa {
     }
     
     
-    std::string getName (const llvm::Function &fn, const llvm::Value& v);       
+    const Graph* getGraph (const llvm::Function &f) const;
     
-    void recordMemAccess (const llvm::Value* v, Graph& g, const llvm::Instruction &I); 
+    void recordMemAccess (const llvm::Value* v, const Graph& g, const llvm::Instruction &I); 
     
     void recordMemAccesses (const llvm::Function& f);
     
-    void assignNodeId (const llvm::Function &fn, Graph* g);
+    unsigned recordNode (const Node* n);
+    
+    void assignNodeId (const llvm::Function &fn, const Graph* g);
 
     bool recordAllocSite (const llvm::Value* v, unsigned &site_id);
     
-    void assignAllocSiteId ();
+    void assignAllocSiteId (const llvm::Module &M);
+    
+    void computeModRef (llvm::Module &M);
+    
+    const ModRef *getModRef (const llvm::Function &fn) const;
+    const ModRef *getModRef (const llvm::Instruction &cs) const;
+    bool test (const ModRef *mr, const Node &n, bool mod) const;
         
   public:
     
@@ -152,6 +164,10 @@ namespace sea_dsa {
 	     bool verbose = true)
       : m_dl (dl), m_tli (tli), m_dsa (dsa) {}
     
+    // Write the allocation sites into filename instead of the file
+    // given by sea-dsa-info-to-file
+    void setInfoFile (const std::string &filename) { m_info_file = filename; }
+    
     bool runOnModule (llvm::Module &M);
     bool runOnFunction (llvm::Function &fn);
 
@@ -170,8 +186,12 @@ namespace sea_dsa {
     /// API for Dsa clients
     ////////
     
+    // The graph of f (see GlobalAnalysis::getGraph: it stays in
+    // memory as long as the analysis)
     Graph* getDsaGraph (const llvm::Function& f) const;
     
+    const GlobalAnalysis &getGlobalAnalysis () const { return m_dsa; }
+    
     bool isAccessed (const Node&n) const; 
     
     // return unique numeric identifier for node n if found,
@@ -184,17 +204,50 @@ namespace sea_dsa {
     
     // the inverse of getAllocSiteID
     const llvm::Value* getAllocValue (unsigned int alloc_site_id) const;
+    
+    ////////
+    /// Mod/ref summaries
+    ////////
+    
+    // Return true if n is read (modified) by fn or by its callees. n
+    // must be a node of the graph of fn.
+    bool isRef (const llvm::Function &fn, const Node &n) const;
+    bool isMod (const llvm::Function &fn, const Node &n) const;
+    
+    // Return true if n is read (modified) by the callee of cs. n
+    // must be a node of the graph of the caller.
+    bool isRef (const llvm::Instruction &cs, const Node &n) const;
+    bool isMod (const llvm::Instruction &cs, const Node &n) const;
+    
+    // Position of n in its graph. The sets below are indexed by it,
+    // not by getDsaNodeId: a set only has one bit per node of the
+    // graph of fn (or of the caller of cs).
+    unsigned getNodeIndex (const Node &n) const;
+    
+    // Nodes read (modified) by fn or by the callee of cs. Return null
+    // if there is no summary.
+    const llvm::BitVector* getRefSet (const llvm::Function &fn) const;
+    const llvm::BitVector* getModSet (const llvm::Function &fn) const;
+    const llvm::BitVector* getRefSet (const llvm::Instruction &cs) const;
+    const llvm::BitVector* getModSet (const llvm::Instruction &cs) const;
+    
+    // Write the summaries using the ids of getDsaNodeId
+    void writeModRef (const llvm::Module &M, llvm::raw_ostream &o) const;
   };
 
 
   class DsaInfoPass: public llvm::ModulePass {
     std::unique_ptr<DsaInfo> m_dsa_info;
+    std::string m_info_file;
     
   public:
     
     static char ID;
     
     DsaInfoPass (): ModulePass (ID), m_dsa_info (nullptr) {}
+    
+    DsaInfoPass (const std::string &infoFile)
+      : ModulePass (ID), m_dsa_info (nullptr), m_info_file (infoFile) {}
 
     void getAnalysisUsage (llvm::AnalysisUsage &AU) const override;
     
@@ -8,6 +8,7 @@
 #include "llvm/ADT/DenseSet.h"
 
 #include "sea_dsa/Graph.hh"
+#include "sea_dsa/support/CanonicalValues.h"
 
 namespace llvm 
 {
@@ -21,6 +22,8 @@ namespace sea_dsa {
   {
     const llvm::DataLayout &m_dl;
     const llvm::TargetLibraryInfo &m_tli;
+    // -- stripPointerCasts of the values seen by this analysis
+    CanonicalValues m_canon;
     
   public:
     LocalAnalysis (const llvm::DataLayout &dl,
@@ -71,6 +71,9 @@ namespace sea_dsa
     // Return true if each node is simulated by at most one cell
     bool isFunction () const;
     
+    // Bytes used by the relation (estimated)
+    uint64_t memoryUsage () const;
+    
     void write (llvm::raw_ostream &o) const ;
   };
 }
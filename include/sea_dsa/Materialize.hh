@@ -0,0 +1,49 @@
+#ifndef __DSA_MATERIALIZE_HH_
+#define __DSA_MATERIALIZE_HH_
+
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Function.h"
+#include "llvm/Pass.h"
+
+#include <vector>
+
+/*
+   Support for modules loaded lazily (e.g., by getLazyIRFileModule).
+
+   The bodies of the functions of such a module are only parsed when
+   they are materialized. Since the call graph is built from the
+   function bodies, the functions reachable from the entry points
+   must be materialized before the call graph is built. The others
+   are never parsed and look like external functions to the
+   analysis.
+*/
+
+namespace sea_dsa {
+
+  // Materialize the functions of M reachable from roots by a call or
+  // by taking their address (directly or through global
+  // initializers). Return the number of materialized functions or -1
+  // if some function could not be materialized.
+  int materializeReachable (llvm::Module &M,
+			    const std::vector<llvm::GlobalValue*> &roots);
+
+  // Materialize the functions reachable from main (or, if there is
+  // no main, from any externally visible function) and from the
+  // externally visible global variables.
+  class MaterializeReachable : public llvm::ModulePass
+  {
+  public:
+
+    static char ID;
+
+    MaterializeReachable (): llvm::ModulePass (ID) {}
+
+    void getAnalysisUsage (llvm::AnalysisUsage &AU) const override;
+
+    bool runOnModule (llvm::Module &M) override;
+
+    const char * getPassName() const override
+    { return "Dsa materialization of reachable functions"; }
+  };
+}
+#endif
@@ -0,0 +1,96 @@
+#ifndef __DSA_PHASE_TIMERS_HH_
+#define __DSA_PHASE_TIMERS_HH_
+
+#include <chrono>
+#include <cstdint>
+
+/*
+   Time spent in each phase of the analysis and, optionally, the
+   hardware performance counters of the phase.
+
+   Enabled by -sea-dsa-phase-timers. With -sea-dsa-perf-counters the
+   cycles, instructions, last-level cache misses and branch misses of
+   each phase are also read with perf_event_open (Linux only). The
+   counters that the kernel or the hardware do not provide are not
+   reported. Phases can be nested (e.g., compress is called while
+   cloning) and their times are inclusive. The timers of the current
+   thread are reported by -sea-dsa-stats.
+*/
+
+namespace llvm {
+  class raw_ostream;
+}
+
+namespace sea_dsa {
+
+  enum TimedPhase {
+    TIMER_LOCAL,        // building a local graph
+    TIMER_BU_CLONE,     // bottom-up cloning and resolution of arguments
+    TIMER_TD_CLONE,     // top-down cloning and resolution of arguments
+    TIMER_CI_RESOLVE,   // context-insensitive resolution of arguments
+    TIMER_SIMULATION,   // computing a simulation between callee and caller
+    TIMER_COMPRESS,     // removing forwarding nodes
+    NUM_TIMERS
+  };
+
+  const char *timedPhaseName (TimedPhase p);
+
+  class PhaseTimers {
+  public:
+
+    enum PerfCounter {
+      PERF_CYCLES,
+      PERF_INSTRUCTIONS,
+      PERF_LLC_MISSES,
+      PERF_BRANCH_MISSES,
+      NUM_PERF_COUNTERS
+    };
+
+    struct Counters {
+      uint64_t m_calls;
+      // -- nanoseconds
+      uint64_t m_time;
+      uint64_t m_perf [NUM_PERF_COUNTERS];
+      Counters (): m_calls (0), m_time (0), m_perf () {}
+    };
+
+    // Attribute the time and the events during its lifetime to a
+    // phase
+    class Scope {
+      TimedPhase m_phase;
+      std::chrono::steady_clock::time_point m_start;
+      uint64_t m_perf [NUM_PERF_COUNTERS];
+      bool m_active;
+    public:
+      explicit Scope (TimedPhase phase);
+      ~Scope ();
+    };
+
+  private:
+
+    Counters m_phases [NUM_TIMERS];
+
+    PhaseTimers () {}
+
+  public:
+
+    static bool isEnabled ();
+
+    // The timers of the current thread
+    static PhaseTimers &get ();
+
+    // Return true if counter c can be read by the current thread
+    static bool hasPerfCounter (PerfCounter c);
+
+    const Counters &getCounters (TimedPhase p) const { return m_phases [p]; }
+
+    void clear () {
+      for (unsigned p = 0; p < NUM_TIMERS; ++p)
+	m_phases [p] = Counters ();
+    }
+
+    // One line per phase
+    void printSummary (llvm::raw_ostream &o) const;
+  };
+}
+#endif
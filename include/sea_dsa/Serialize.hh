@@ -0,0 +1,148 @@
+#ifndef __DSA_SERIALIZE_HH_
+#define __DSA_SERIALIZE_HH_
+
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Function.h"
+
+#include "llvm/ADT/DenseMap.h"
+
+#include "sea_dsa/Graph.hh"
+#include "sea_dsa/Global.hh"
+#include "sea_dsa/BottomUp.hh"
+
+#include <string>
+
+/*
+   Binary format for the graphs computed by a global analysis.
+
+   Values are referenced by stable keys: a global value by its
+   position in a symbol table of names and any other value by the
+   symbol of its function plus its position inside the function
+   (arguments, then instructions, then constant expressions used by
+   the instructions). Types are encoded structurally. Hence, the
+   graph of a function can only be loaded against a module where the
+   function and its callees have not changed.
+
+   The file is a sequence of little-endian 32-bit words: a header, a
+   table from functions to graphs, a table of graph offsets, the
+   hashes used by the incremental analysis, the graphs, the symbol
+   table and the type table. Each graph is self-contained so it can
+   be decoded independently of the others directly from the
+   memory-mapped file.
+*/
+
+namespace llvm
+{
+  class DataLayout;
+  class raw_ostream;
+}
+
+namespace sea_dsa
+{
+
+  // Write the graphs of all functions of M that have a graph in ga.
+  // Return false if something went wrong.
+  bool writeGraphs (const llvm::Module &M, GlobalAnalysis &ga, llvm::raw_ostream &o);
+  bool writeGraphs (const llvm::Module &M, GlobalAnalysis &ga,
+		    const std::string &filename);
+
+  class GraphStore;
+  class GraphFileWriter;
+
+  // Global analysis whose graphs are read from a file produced by
+  // writeGraphs. The graph of a function is only decoded the first
+  // time it is requested.
+  class SerializedGlobalAnalysis: public GlobalAnalysis
+  {
+  public:
+
+    typedef typename Graph::SetFactory SetFactory;
+
+  private:
+
+    std::unique_ptr<GraphStore> m_store;
+
+    void releaseGraph (const void *key) const override;
+
+    SerializedGlobalAnalysis (GlobalAnalysisKind kind,
+			      std::unique_ptr<GraphStore> store);
+
+  public:
+
+    // Open filename. Return null if the file cannot be read or it was
+    // not produced for M.
+    //
+    // If maxGraphs is not zero then the graphs only acquired through
+    // getGraphHandle are freed once their handles are released and
+    // more than maxGraphs graphs are loaded. Graphs returned by
+    // getGraph are never freed.
+    static std::unique_ptr<SerializedGlobalAnalysis>
+    load (const std::string &filename, llvm::Module &M,
+	  const llvm::DataLayout &dl, SetFactory &setFactory,
+	  unsigned maxGraphs = 0);
+
+    ~SerializedGlobalAnalysis ();
+
+    // The graphs are already computed: nothing to do
+    bool runOnModule (llvm::Module &M) override { return false; }
+
+    const Graph& getGraph (const llvm::Function& fn) const override;
+
+    Graph& getGraph (const llvm::Function& fn) override;
+
+    bool hasGraph (const llvm::Function& fn) const override;
+
+    GraphHandle getGraphHandle (const llvm::Function& fn) const override;
+
+    bool canEvictGraphs () const override;
+
+    // number of graphs currently in memory
+    unsigned numLoadedGraphs () const;
+  };
+
+  // Graphs of the previous run read from a file and graphs of the
+  // current run written to the same file by save. If the file does
+  // not exist then nothing is reused.
+  class IncrementalCache: public GraphCache
+  {
+  public:
+
+    typedef typename Graph::SetFactory SetFactory;
+
+  private:
+
+    std::string m_filename;
+    const llvm::Module &m_M;
+    std::unique_ptr<GraphStore> m_prev;
+    std::unique_ptr<GraphFileWriter> m_next;
+    // final graphs of the previous run already decoded
+    llvm::DenseMap<uint32_t, GraphRef> m_finals;
+    // bottom-up graphs of the current run
+    llvm::DenseMap<const Graph*, uint32_t> m_bu_ids;
+    llvm::DenseMap<const llvm::Function*, std::pair<uint64_t, uint32_t> > m_bu;
+    llvm::DenseMap<const llvm::Function*, uint64_t> m_fingerprints;
+
+  public:
+
+    IncrementalCache (const std::string &filename, llvm::Module &M,
+		      const llvm::DataLayout &dl, SetFactory &setFactory);
+
+    ~IncrementalCache ();
+
+    GraphRef getBottomUpGraph (const llvm::Function &fn, uint64_t hash) override;
+
+    void addBottomUpGraph (const llvm::Function &fn, uint64_t hash,
+			   const Graph &g) override;
+
+    GraphRef getGraph (const llvm::Function &fn, uint64_t hash) override;
+
+    bool hasFingerprint (const llvm::Function &fn, uint64_t fp) override;
+
+    void addFingerprint (const llvm::Function &fn, uint64_t fp) override;
+
+    // Write the final graphs of ga and everything recorded in this
+    // run so that the next run can reuse it
+    bool save (GlobalAnalysis &ga);
+  };
+}
+#endif
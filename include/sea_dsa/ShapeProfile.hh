@@ -0,0 +1,101 @@
+#ifndef __DSA_SHAPE_PROFILE_HH_
+#define __DSA_SHAPE_PROFILE_HH_
+
+#include <cstdint>
+#include <vector>
+
+/*
+   Distributions of the shape of the graphs.
+
+   Enabled by -sea-dsa-shape-stats-to-file. While the analysis runs we
+   record the length of the forwarding chains found by compress, the
+   nodes created by each callsite clone and the nodes added to the
+   graph of each SCC by the bottom-up analysis. At the end of
+   DsaAnalysis the final graphs are measured (nodes per graph, links,
+   offsets, type set sizes and allocation sites per node) and all
+   distributions are written to the file as JSON.
+*/
+
+namespace llvm {
+  class Module;
+  class raw_ostream;
+}
+
+namespace sea_dsa {
+
+  class Graph;
+  class GlobalAnalysis;
+
+  // Distribution of a non-negative quantity. Values are counted in
+  // power-of-two buckets: [0,0], [1,1], [2,3], [4,7], ...
+  class Histogram {
+    std::vector<uint64_t> m_buckets;
+    uint64_t m_count;
+    uint64_t m_sum;
+    uint64_t m_min;
+    uint64_t m_max;
+  public:
+    Histogram (): m_count (0), m_sum (0), m_min (0), m_max (0) {}
+    void add (uint64_t v);
+    uint64_t count () const { return m_count; }
+    void writeJSON (llvm::raw_ostream &o) const;
+  };
+
+  enum ShapeMetric {
+    SHAPE_NODES_PER_GRAPH,
+    SHAPE_LINKS_PER_NODE,
+    SHAPE_OFFSETS_PER_NODE,
+    SHAPE_TYPE_SET_SIZE,
+    SHAPE_ALLOC_SITES_PER_NODE,
+    SHAPE_FORWARDING_CHAIN,
+    SHAPE_CLONE_SIZE,
+    SHAPE_SCC_GROWTH,
+    NUM_SHAPE_METRICS
+  };
+
+  const char *shapeMetricName (ShapeMetric m);
+
+  class ShapeProfile {
+  public:
+
+    // Record the nodes created during its lifetime as the size of a
+    // callsite clone
+    class CloneScope {
+      uint64_t m_last_id;
+      bool m_active;
+    public:
+      CloneScope ();
+      ~CloneScope ();
+    };
+
+  private:
+
+    Histogram m_metrics [NUM_SHAPE_METRICS];
+
+    ShapeProfile () {}
+
+  public:
+
+    static bool isEnabled ();
+
+    // The profile of the current thread
+    static ShapeProfile &get ();
+
+    void record (ShapeMetric m, uint64_t v) { m_metrics [m].add (v); }
+
+    // Record the shape of a finished graph
+    void addGraph (const Graph &g);
+
+    void clear () {
+      for (unsigned m = 0; m < NUM_SHAPE_METRICS; ++m)
+	m_metrics [m] = Histogram ();
+    }
+
+    void writeJSON (llvm::raw_ostream &o) const;
+
+    // Add the shape of the graphs of M and write the profile into
+    // the file given by -sea-dsa-shape-stats-to-file, if any
+    void writeToFile (const llvm::Module &M, const GlobalAnalysis &ga);
+  };
+}
+#endif
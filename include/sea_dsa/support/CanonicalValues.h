@@ -0,0 +1,45 @@
+#ifndef __SEA_DSA_CANONICAL_VALUES__HPP_
+#define __SEA_DSA_CANONICAL_VALUES__HPP_
+
+#include "llvm/IR/Value.h"
+#include "llvm/IR/Operator.h"
+#include "llvm/IR/GlobalAlias.h"
+#include "llvm/IR/Instruction.h"
+#include "llvm/ADT/DenseMap.h"
+
+/*
+   Memo of Value::stripPointerCasts.
+
+   The canonical value of v is v.stripPointerCasts (), the key of its
+   cell in a Graph. Only bitcasts, address space casts, geps and
+   aliases can be stripped so other values are returned right away
+   and the rest are stripped once. Values must not be deleted while
+   the memo is alive.
+*/
+
+namespace sea_dsa {
+
+  class CanonicalValues {
+    llvm::DenseMap<const llvm::Value*, const llvm::Value*> m_memo;
+
+    static bool mayStrip (const llvm::Value &v) {
+      if (llvm::isa<llvm::GlobalAlias> (&v)) return true;
+      const llvm::Operator *op = llvm::dyn_cast<llvm::Operator> (&v);
+      return op && (llvm::isa<llvm::GEPOperator> (op) ||
+		    op->getOpcode () == llvm::Instruction::BitCast ||
+		    op->getOpcode () == llvm::Instruction::AddrSpaceCast);
+    }
+
+  public:
+
+    const llvm::Value &get (const llvm::Value &v) {
+      if (!mayStrip (v)) return v;
+      const llvm::Value *&res = m_memo [&v];
+      if (!res) res = v.stripPointerCasts ();
+      return *res;
+    }
+
+    void clear () { m_memo.clear (); }
+  };
+}
+#endif
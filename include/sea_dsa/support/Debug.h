@@ -1,8 +1,77 @@
 #ifndef __SEA_DSA_DEBUG__HPP_
 #define __SEA_DSA_DEBUG__HPP_
-// For now this is just a placeholder
 
-#define LOG(TAG,CODE) do { } while (0)
-//#define LOG(TAG,CODE) do {CODE;} while (0)
+#include "llvm/Support/raw_ostream.h"
 
-#endif 
+#include <string>
+
+/*
+   Tracing compiled into all builds.
+
+   LOG(TAG,CODE) runs CODE only if TAG is one of the tags given to
+   -sea-dsa-log (e.g., -sea-dsa-log=dsa-global,dsa-collapse). Whether
+   a tag is enabled is computed once per LOG statement so a disabled
+   statement costs one flag check.
+
+   Inside CODE, logs () is the stream of the current event: what is
+   written to it is recorded with the tag, a sequence number, the
+   thread and the time. Events go into a per-thread buffer, which is
+   written to stderr (or to -sea-dsa-log-file) when it is full, when
+   the thread exits or when the process is killed by a signal (e.g.,
+   a failed assertion). Events of different threads can thus appear
+   out of order: the sequence number gives their order.
+*/
+
+namespace sea_dsa {
+  namespace log {
+
+    // The tag of a LOG statement
+    class Tag {
+      const char *m_name;
+      bool m_enabled;
+    public:
+      explicit Tag (const char *name);
+      const char *name () const { return m_name; }
+      bool enabled () const { return m_enabled; }
+    };
+
+    // The output of one LOG statement. The event is recorded when it
+    // is destroyed.
+    class Event {
+      const Tag &m_tag;
+      std::string m_msg;
+      llvm::raw_string_ostream m_os;
+    public:
+      explicit Event (const Tag &tag);
+      ~Event ();
+      llvm::raw_ostream &operator() () { return m_os; }
+    };
+
+    // Write the events buffered by the current thread
+    void flush ();
+  }
+
+  // Stream of the warnings and errors of the analyses: errs () unless
+  // the current thread redirected it
+  llvm::raw_ostream &diags ();
+
+  // Redirect diags () of the current thread to o during its lifetime
+  // (e.g., a worker of the batch mode of seadsa that emits the
+  // messages of each input at once)
+  class DiagsRedirect {
+    llvm::raw_ostream *m_prev;
+  public:
+    explicit DiagsRedirect (llvm::raw_ostream &o);
+    ~DiagsRedirect ();
+  };
+}
+
+#define LOG(TAG,CODE) do {						\
+    static const ::sea_dsa::log::Tag __sea_dsa_log_tag (TAG);		\
+    if (__sea_dsa_log_tag.enabled ()) {					\
+      ::sea_dsa::log::Event logs (__sea_dsa_log_tag);			\
+      CODE;								\
+    }									\
+  } while (0)
+
+#endif
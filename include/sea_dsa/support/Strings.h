@@ -0,0 +1,58 @@
+#ifndef __SEA_DSA_STRINGS__HPP_
+#define __SEA_DSA_STRINGS__HPP_
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instruction.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <string>
+
+/*
+   Strings written by the profiles, the printer and the server.
+*/
+
+namespace sea_dsa {
+
+  // Escape s for a JSON string literal
+  inline std::string escapeJSON (llvm::StringRef s) {
+    std::string res;
+    for (char c : s) {
+      switch (c) {
+      case '"': res += "\\\""; break;
+      case '\\': res += "\\\\"; break;
+      case '\n': res += "\\n"; break;
+      case '\t': res += "\\t"; break;
+      default: res += c;
+      }
+    }
+    return res;
+  }
+
+  // Quote s as a CSV field
+  inline std::string quoteCSV (llvm::StringRef s) {
+    std::string res = "\"";
+    for (char c : s) {
+      if (c == '"') res += "\"\"";
+      else res += c;
+    }
+    return res + "\"";
+  }
+
+  // Name of fn or the empty string
+  inline std::string fnName (const llvm::Function *fn)
+  { return fn ? fn->getName ().str () : ""; }
+
+  // I printed without its indentation or the empty string
+  inline std::string instString (const llvm::Instruction *I) {
+    if (!I) return "";
+    std::string s;
+    llvm::raw_string_ostream o (s);
+    o << *I;
+    o.flush ();
+    s.erase (0, s.find_first_not_of (' '));
+    return s;
+  }
+}
+
+#endif
@@ -0,0 +1,203 @@
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "sea_dsa/DsaAnalysis.hh"
+#include "sea_dsa/Graph.hh"
+#include "sea_dsa/support/Debug.h"
+
+/*
+   LLVM alias analysis backed by the Dsa graphs.
+
+   Two pointers of the same function do not alias if their cells are
+   in different nodes, or in the same node at disjoint offsets if the
+   node is neither collapsed nor an array. Otherwise, the query is
+   passed to the next alias analysis.
+
+   Nodes that might be reached through integers (inttoptr) or by
+   external code are not trusted.
+
+   The graphs are not updated when the IR is transformed. A value
+   created after the analysis usually has no cell and its queries are
+   passed to the next alias analysis. However, it can be allocated at
+   the address of a deleted value, which still has a cell. Thus,
+   values reported by deleteValue are remembered and any query on
+   their address is answered MayAlias.
+*/
+
+using namespace llvm;
+
+namespace sea_dsa {
+
+  class DsaAliasAnalysis : public ModulePass, public AliasAnalysis {
+
+    // What the graph says about a pair of values. It does not
+    // depend on the size of the accesses.
+    struct PairInfo {
+      enum Kind {UNKNOWN, DIFFERENT_NODES, SAME_NODE, SAME_FIELD_SENSITIVE_NODE};
+      Kind m_kind;
+      // offsets of the first and second value if SAME_FIELD_SENSITIVE_NODE
+      unsigned m_off1;
+      unsigned m_off2;
+
+      PairInfo (): m_kind (UNKNOWN), m_off1 (0), m_off2 (0) {}
+    };
+
+    typedef std::pair<const Value*, const Value*> ValuePair;
+
+    DsaAnalysis *m_dsa;
+    DenseMap<ValuePair, PairInfo> m_cache;
+    // values paired with each value in m_cache
+    DenseMap<const Value*, SmallVector<const Value*, 4> > m_partners;
+    // addresses of the values deleted since the analysis
+    DenseSet<const Value*> m_deleted;
+
+    static const Function *getFunction (const Value *v) {
+      if (const Instruction *I = dyn_cast<Instruction> (v))
+	return I->getParent ()->getParent ();
+      if (const Argument *a = dyn_cast<Argument> (v))
+	return a->getParent ();
+      return nullptr;
+    }
+
+    static bool isTrusted (const Node &n)
+    { return !n.isIntToPtr () && !n.isExternal (); }
+
+    PairInfo computePairInfo (const Value *v1, const Value *v2) {
+      PairInfo res;
+
+      // -- a global has a cell in the graph of any function using it
+      const Function *fn = getFunction (v1);
+      const Function *fn2 = getFunction (v2);
+      if (!fn) fn = fn2;
+      if (!fn || (fn2 && fn2 != fn)) return res;
+
+      GlobalAnalysis &ga = m_dsa->getDsaAnalysis ();
+      if (!ga.hasGraph (*fn)) return res;
+      // -- hasCell is true for any global but the graph might not
+      //    have it: only look up existing cells
+      const Graph &g = ga.getGraph (*fn);
+      const Cell *c1 = g.findCell (*v1);
+      const Cell *c2 = g.findCell (*v2);
+      if (!c1 || !c2) return res;
+
+      const Node *n1 = c1->getNode ();
+      const Node *n2 = c2->getNode ();
+      if (!isTrusted (*n1) || !isTrusted (*n2)) return res;
+
+      if (n1 != n2)
+	res.m_kind = PairInfo::DIFFERENT_NODES;
+      else if (n1->isCollapsed () || n1->isArray ())
+	res.m_kind = PairInfo::SAME_NODE;
+      else {
+	res.m_kind = PairInfo::SAME_FIELD_SENSITIVE_NODE;
+	res.m_off1 = c1->getOffset ();
+	res.m_off2 = c2->getOffset ();
+      }
+      return res;
+    }
+
+    PairInfo getPairInfo (const Value *v1, const Value *v2) {
+      bool swapped = v2 < v1;
+      if (swapped) std::swap (v1, v2);
+
+      ValuePair key (v1, v2);
+      auto it = m_cache.find (key);
+      PairInfo res;
+      if (it != m_cache.end ())
+	res = it->second;
+      else {
+	res = computePairInfo (v1, v2);
+	m_cache [key] = res;
+	m_partners [v1].push_back (v2);
+	if (v1 != v2) m_partners [v2].push_back (v1);
+      }
+
+      if (swapped) std::swap (res.m_off1, res.m_off2);
+      return res;
+    }
+
+  public:
+
+    static char ID;
+
+    DsaAliasAnalysis () : ModulePass (ID), m_dsa (nullptr) {}
+
+    void getAnalysisUsage (AnalysisUsage &AU) const override {
+      AliasAnalysis::getAnalysisUsage (AU);
+      AU.addRequired<DsaAnalysis> ();
+      AU.setPreservesAll ();
+    }
+
+    bool runOnModule (Module &M) override {
+      m_dsa = &getAnalysis<DsaAnalysis> ();
+      InitializeAliasAnalysis (this, &m_dsa->getDataLayout ());
+      m_cache.clear ();
+      m_partners.clear ();
+      m_deleted.clear ();
+      return false;
+    }
+
+    void *getAdjustedAnalysisPointer (AnalysisID PI) override {
+      if (PI == &AliasAnalysis::ID)
+	return (AliasAnalysis*) this;
+      return this;
+    }
+
+    AliasResult alias (const Location &LocA, const Location &LocB) override {
+      const Value *v1 = LocA.Ptr->stripPointerCasts ();
+      const Value *v2 = LocB.Ptr->stripPointerCasts ();
+
+      // -- the cell of a deleted value might be found for a new
+      //    value at the same address
+      if (m_deleted.count (LocA.Ptr) || m_deleted.count (LocB.Ptr) ||
+	  m_deleted.count (v1) || m_deleted.count (v2))
+	return MayAlias;
+
+      PairInfo info = getPairInfo (v1, v2);
+      if (info.m_kind == PairInfo::DIFFERENT_NODES)
+	return NoAlias;
+
+      if (info.m_kind == PairInfo::SAME_FIELD_SENSITIVE_NODE &&
+	  LocA.Size != UnknownSize && LocB.Size != UnknownSize &&
+	  (info.m_off1 + LocA.Size <= info.m_off2 ||
+	   info.m_off2 + LocB.Size <= info.m_off1))
+	return NoAlias;
+
+      return AliasAnalysis::alias (LocA, LocB);
+    }
+
+    void deleteValue (Value *V) override {
+      auto it = m_partners.find (V);
+      if (it != m_partners.end ()) {
+	for (const Value *p : it->second) {
+	  m_cache.erase (V < p ? ValuePair (V, p) : ValuePair (p, V));
+	}
+	m_partners.erase (it);
+      }
+      m_deleted.insert (V);
+      AliasAnalysis::deleteValue (V);
+    }
+
+    const char * getPassName() const override
+    { return "SeaHorn Dsa alias analysis"; }
+  };
+
+  char DsaAliasAnalysis::ID = 0;
+
+  Pass *createDsaAliasAnalysisPass () {
+    return new DsaAliasAnalysis ();
+  }
+
+} // end namespace sea_dsa
+
+static llvm::RegisterPass<sea_dsa::DsaAliasAnalysis>
+X ("sea-dsa-aa", "Alias analysis based on SeaHorn Dsa", false, true);
+
+static llvm::RegisterAnalysisGroup<llvm::AliasAnalysis> Y (X);
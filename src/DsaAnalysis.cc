@@ -1,4 +1,6 @@
 #include "llvm/IR/DataLayout.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Instruction.h"
 #include "llvm/Target/TargetLibraryInfo.h"
 #include "llvm/Analysis/MemoryBuiltins.h"
 #include "llvm/Analysis/CallGraph.h"
@@ -8,6 +10,12 @@
 #include "sea_dsa/Info.hh"
 #include "sea_dsa/Global.hh"
 #include "sea_dsa/DsaAnalysis.hh"
+#include "sea_dsa/Serialize.hh"
+#include "sea_dsa/CollapseProfile.hh"
+#include "sea_dsa/FixpointProfile.hh"
+#include "sea_dsa/PhaseTimers.hh"
+#include "sea_dsa/ShapeProfile.hh"
+#include "sea_dsa/support/Debug.h"
 
 using namespace sea_dsa;
 using namespace llvm;
@@ -17,6 +25,51 @@ DsaCsGlobalAnalysis ("sea-dsa-cs-global",
        llvm::cl::desc ("DSA: context-sensitive analysis if enabled, else context-insensitive"),
        llvm::cl::init (true));
 
+static llvm::cl::opt<bool>
+DsaHybridGlobalAnalysis ("sea-dsa-hybrid",
+       llvm::cl::desc ("DSA: context-sensitive analysis except for large SCCs (overrides sea-dsa-cs-global)"),
+       llvm::cl::init (false));
+
+static llvm::cl::opt<std::string>
+DsaWriteGraphs ("sea-dsa-write-graphs",
+       llvm::cl::desc ("DSA: write all graphs into a binary file"),
+       llvm::cl::init (""), llvm::cl::value_desc ("filename"));
+
+static llvm::cl::opt<std::string>
+DsaReadGraphs ("sea-dsa-read-graphs",
+       llvm::cl::desc ("DSA: read graphs from a binary file instead of running the analysis"),
+       llvm::cl::init (""), llvm::cl::value_desc ("filename"));
+
+static llvm::cl::opt<std::string>
+DsaIncremental ("sea-dsa-incremental",
+       llvm::cl::desc ("DSA: reuse the graphs stored in a file by a previous run for unchanged functions and store the new ones"),
+       llvm::cl::init (""), llvm::cl::value_desc ("filename"));
+
+static llvm::cl::opt<unsigned>
+DsaMaxLoadedGraphs ("sea-dsa-max-loaded-graphs",
+       llvm::cl::desc ("DSA: maximum number of graphs read by sea-dsa-read-graphs kept in memory (0 = no limit)"),
+       llvm::cl::init (0));
+
+static llvm::cl::opt<bool>
+DsaPruneScalars ("sea-dsa-prune-scalars",
+       llvm::cl::desc ("DSA: after the analysis, drop the cells of scalars that are not pointer operands of memory accesses or callsite arguments"),
+       llvm::cl::init (false));
+
+static llvm::cl::list<std::string>
+DsaPruneScalarsKeep ("sea-dsa-prune-scalars-keep",
+       llvm::cl::desc ("DSA: keep also the cells of the instructions with these opcodes (e.g., phi,select,getelementptr)"),
+       llvm::cl::CommaSeparated,
+       llvm::cl::value_desc ("OPCODE,..."));
+
+static llvm::cl::opt<bool>
+DsaFreezeGraphs ("sea-dsa-freeze-graphs",
+       llvm::cl::desc ("DSA: make all graphs read-only after the analysis so that they can be queried concurrently"),
+       llvm::cl::init (false));
+
+static llvm::cl::list<std::string>
+DsaEntryPoints ("sea-dsa-entry",
+       llvm::cl::desc ("DSA: only analyze the functions reachable from these functions"),
+       llvm::cl::CommaSeparated, llvm::cl::value_desc ("fn1,fn2,..."));
 
 void DsaAnalysis::getAnalysisUsage (AnalysisUsage &AU) const {
   AU.addRequired<DataLayoutPass> ();
@@ -40,17 +93,113 @@ GlobalAnalysis& DsaAnalysis::getDsaAnalysis () {
   return *m_ga;
 }
 
+// Return true if v is used by an instruction, maybe through constant
+// expressions
+static bool isUsedByCode (const Value &v) {
+  for (const User *u : v.users ()) {
+    if (isa<Instruction> (u)) return true;
+    if (isa<ConstantExpr> (u) && isUsedByCode (*u)) return true;
+  }
+  return false;
+}
+
 bool DsaAnalysis::runOnModule (Module &M) {
   m_dl  = &getAnalysis<DataLayoutPass>().getDataLayout ();
   m_tli = &getAnalysis<TargetLibraryInfo> ();
   auto &cg = getAnalysis<CallGraphWrapperPass> ().getCallGraph ();
 
-  if (DsaCsGlobalAnalysis)
-    m_ga.reset (new ContextSensitiveGlobalAnalysis (*m_dl, *m_tli, cg, m_setFactory));
-  else 
-    m_ga.reset (new ContextInsensitiveGlobalAnalysis (*m_dl, *m_tli, cg, m_setFactory));
+  // -- functions of a lazily loaded module without a body are seen
+  //    as external functions. Only the ones used by the materialized
+  //    code matter: MaterializeReachable leaves the others on purpose.
+  unsigned lazy = 0;
+  for (auto &F : M) if (F.isMaterializable () && isUsedByCode (F)) lazy++;
+  if (lazy > 0)
+    diags () << "WARNING: " << lazy << " functions are not materialized and they "
+	    << "are considered external. Run MaterializeReachable before DsaAnalysis.\n";
+
+  if (DsaReadGraphs != "") {
+    m_ga = SerializedGlobalAnalysis::load (DsaReadGraphs, M, *m_dl, m_setFactory,
+					   DsaMaxLoadedGraphs);
+    if (!m_ga)
+      diags () << "WARNING: cannot load Dsa graphs from " << DsaReadGraphs
+	      << ". Running the analysis instead.\n";
+  }
+
+  // -- the profile of a previous module analyzed by this thread
+  CollapseProfile::get ().clear ();
+  FixpointProfile::get ().clear ();
+  PhaseTimers::get ().clear ();
+  ShapeProfile::get ().clear ();
+
+  std::unique_ptr<IncrementalCache> cache;
+  if (!m_ga && DsaIncremental != "") {
+    // -- the graphs of the other analyses can be shared by several
+    //    SCCs so they cannot be reused independently
+    if (DsaHybridGlobalAnalysis || !DsaCsGlobalAnalysis)
+      diags () << "WARNING: sea-dsa-incremental is only supported by the "
+	      << "context-sensitive analysis. Ignoring it.\n";
+    else
+      cache.reset (new IncrementalCache (DsaIncremental, M, *m_dl, m_setFactory));
+  }
+
+  if (!m_ga) {
+    if (DsaHybridGlobalAnalysis)
+      m_ga.reset (new HybridGlobalAnalysis (*m_dl, *m_tli, cg, m_setFactory,
+					    createHybridPolicy ()));
+    else if (DsaCsGlobalAnalysis) {
+      auto cs = new ContextSensitiveGlobalAnalysis (*m_dl, *m_tli, cg, m_setFactory);
+      cs->setCache (cache.get ());
+      m_ga.reset (cs);
+    }
+    else 
+      m_ga.reset (new ContextInsensitiveGlobalAnalysis (*m_dl, *m_tli, cg, m_setFactory));
+    
+    if (!DsaEntryPoints.empty ()) {
+      std::vector<const Function*> entries;
+      for (auto &name : DsaEntryPoints) {
+	if (const Function *fn = M.getFunction (name))
+	  entries.push_back (fn);
+	else
+	  diags () << "WARNING: entry point " << name << " not found\n";
+      }
+      if (entries.empty ())
+	diags () << "WARNING: no entry point found. Analyzing all functions.\n";
+      else
+	m_ga->setEntryPoints (cg, entries);
+    }
+    
+    m_ga->runOnModule (M);
+    // -- in every run so that freezing the graphs does not add
+    //    nodes (and shift the ids of DsaInfo)
+    m_ga->mkGlobalCells (M);
+  }
+
+  if (cache)
+    cache->save (*m_ga);
+
+  if (DsaWriteGraphs != "")
+    writeGraphs (M, *m_ga, DsaWriteGraphs);
+  
+  if (DsaPruneScalars) {
+    if (DsaReadGraphs != "" && DsaMaxLoadedGraphs > 0)
+      diags () << "WARNING: scalars are not pruned because it would load all the "
+	      << "graphs (sea-dsa-max-loaded-graphs)\n";
+    else
+      m_ga->pruneScalars (M, std::vector<std::string> (DsaPruneScalarsKeep.begin (),
+							  DsaPruneScalarsKeep.end ()));
+  }
+  
+  if (DsaFreezeGraphs) {
+    if (DsaReadGraphs != "" && DsaMaxLoadedGraphs > 0)
+      diags () << "WARNING: graphs are not frozen because it would load all the "
+	      << "graphs (sea-dsa-max-loaded-graphs)\n";
+    else
+      m_ga->freeze (M);
+  }
   
-  m_ga->runOnModule (M);
+  CollapseProfile::get ().writeToFile ();
+  FixpointProfile::get ().writeToFile ();
+  ShapeProfile::get ().writeToFile (M, *m_ga);
   return false;
 }
 
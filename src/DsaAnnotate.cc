@@ -0,0 +1,149 @@
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "sea_dsa/DsaAnalysis.hh"
+#include "sea_dsa/Info.hh"
+#include "sea_dsa/Graph.hh"
+#include "sea_dsa/support/Debug.h"
+
+/*
+   Attach the results of DsaInfo to the module so that clients can
+   read the memory partitions from the bitcode without running the
+   analysis.
+
+   - Loads, stores, memcpy/memmove/memset and calls get !sea.dsa
+     with one pair (node id, offset) per accessed pointer: the
+     pointer operand of loads and stores, the destination (and
+     source) of memory intrinsics and each pointer argument of a
+     call. Node id 0 means that the pointer has no cell.
+
+   - Instructions that are allocation sites get !sea.dsa.alloc with
+     their allocation site id. Other allocation sites (e.g., global
+     variables) are listed as pairs (value, id) in the named metadata
+     !sea.dsa.alloc.globals.
+
+   Ids are the ones returned by DsaInfo::getDsaNodeId and
+   DsaInfo::getAllocSiteId.
+*/
+
+using namespace llvm;
+
+namespace sea_dsa {
+
+  class DsaAnnotate : public ModulePass {
+
+    DsaInfo *m_info;
+    Type *m_int32Ty;
+    unsigned m_accessKind;
+    unsigned m_allocKind;
+
+    Metadata *mkInt (unsigned v) {
+      return ConstantAsMetadata::get (ConstantInt::get (m_int32Ty, v));
+    }
+
+    // add the node id and offset of ptr to md
+    void addCell (const Value *ptr, Graph &g, std::vector<Metadata*> &md) {
+      ptr = ptr->stripPointerCasts ();
+      unsigned id = 0, offset = 0;
+      if (g.hasCell (*ptr)) {
+	const Cell &c = g.getCell (*ptr);
+	id = m_info->getDsaNodeId (*c.getNode ());
+	offset = c.getOffset ();
+      }
+      md.push_back (mkInt (id));
+      md.push_back (mkInt (offset));
+    }
+
+    void annotateAccesses (Function &F) {
+      Graph *g = m_info->getDsaGraph (F);
+      if (!g) return;
+
+      for (inst_iterator it = inst_begin (F), et = inst_end (F); it != et; ++it) {
+	Instruction *I = &*it;
+	std::vector<Metadata*> md;
+	if (LoadInst *LI = dyn_cast<LoadInst> (I))
+	  addCell (LI->getPointerOperand (), *g, md);
+	else if (StoreInst *SI = dyn_cast<StoreInst> (I))
+	  addCell (SI->getPointerOperand (), *g, md);
+	else if (MemTransferInst *MTI = dyn_cast<MemTransferInst> (I)) {
+	  addCell (MTI->getDest (), *g, md);
+	  addCell (MTI->getSource (), *g, md);
+	} else if (MemSetInst *MSI = dyn_cast<MemSetInst> (I))
+	  addCell (MSI->getDest (), *g, md);
+	else if (isa<CallInst> (I) || isa<InvokeInst> (I)) {
+	  if (isa<IntrinsicInst> (I)) continue;
+	  ImmutableCallSite CS (I);
+	  for (auto ai = CS.arg_begin (), ae = CS.arg_end (); ai != ae; ++ai)
+	    if ((*ai)->getType ()->isPointerTy ())
+	      addCell (*ai, *g, md);
+	  if (md.empty ()) continue;
+	} else
+	  continue;
+
+	I->setMetadata (m_accessKind, MDNode::get (I->getContext (), md));
+      }
+    }
+
+  public:
+
+    static char ID;
+
+    DsaAnnotate () : ModulePass (ID), m_info (nullptr), m_int32Ty (nullptr),
+		     m_accessKind (0), m_allocKind (0) {}
+
+    bool runOnModule (Module &M) override {
+      m_info = &getAnalysis<DsaInfoPass> ().getDsaInfo ();
+      LLVMContext &ctx = M.getContext ();
+      m_int32Ty = Type::getInt32Ty (ctx);
+      m_accessKind = ctx.getMDKindID ("sea.dsa");
+      m_allocKind = ctx.getMDKindID ("sea.dsa.alloc");
+
+      for (auto &F : M) annotateAccesses (F);
+
+      NamedMDNode *globals = nullptr;
+      for (unsigned id : m_info->alloc_sites ()) {
+	const Value *v = m_info->getAllocValue (id);
+	if (!v) continue;
+	if (const Instruction *I = dyn_cast<Instruction> (v)) {
+	  const_cast<Instruction*> (I)->setMetadata
+	    (m_allocKind, MDNode::get (ctx, {mkInt (id)}));
+	} else if (const Constant *c = dyn_cast<Constant> (v)) {
+	  if (!globals) globals = M.getOrInsertNamedMetadata ("sea.dsa.alloc.globals");
+	  Metadata *md [] = {ConstantAsMetadata::get (const_cast<Constant*> (c)), mkInt (id)};
+	  globals->addOperand (MDNode::get (ctx, md));
+	}
+      }
+
+      LOG ("dsa-annotate",
+	   logs () << "Annotated " << m_info->alloc_sites ().size ()
+	           << " allocation sites\n";);
+      return true;
+    }
+
+    void getAnalysisUsage (AnalysisUsage &AU) const override {
+      AU.addRequired<DsaInfoPass> ();
+      AU.setPreservesAll ();
+    }
+
+    const char * getPassName() const override
+    { return "Annotate the module with SeaHorn Dsa metadata"; }
+  };
+
+  char DsaAnnotate::ID = 0;
+
+  Pass *createDsaAnnotatePass () {
+    return new DsaAnnotate ();
+  }
+
+} // end namespace sea_dsa
+
+static llvm::RegisterPass<sea_dsa::DsaAnnotate>
+X ("sea-dsa-annotate", "Annotate the module with Dsa node and allocation site ids");
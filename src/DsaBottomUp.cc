@@ -5,6 +5,10 @@
 #include "llvm/IR/CallSite.h"
 #include "llvm/IR/InstIterator.h"
 #include "llvm/IR/DataLayout.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/InlineAsm.h"
+#include "llvm/IR/Operator.h"
+#include "llvm/IR/TypeFinder.h"
 #include "llvm/Target/TargetLibraryInfo.h"
 #include "llvm/Pass.h"
 #include "llvm/PassManager.h"
@@ -18,10 +22,15 @@
 #include "sea_dsa/Local.hh"
 #include "sea_dsa/CallSite.hh"
 #include "sea_dsa/Cloner.hh"
+#include "sea_dsa/CollapseProfile.hh"
+#include "sea_dsa/PhaseTimers.hh"
+#include "sea_dsa/ShapeProfile.hh"
 #include "sea_dsa/support/Debug.h"
 
 #include "boost/range/iterator_range.hpp"
 
+#include <algorithm>
+
 using namespace llvm;
 
 namespace sea_dsa {
@@ -30,6 +39,9 @@ namespace sea_dsa {
   void BottomUpAnalysis::
   cloneAndResolveArguments (const DsaCallSite &CS, Graph& calleeG, Graph& callerG)
   {      
+    CollapseProfile::Scope scope (PHASE_BOTTOM_UP, CS.getCaller (), CS.getInstruction ());
+    PhaseTimers::Scope timer (TIMER_BU_CLONE);
+    ShapeProfile::CloneScope clone;
     Cloner C (callerG);
     
     // clone and unify globals 
@@ -119,18 +131,289 @@ namespace sea_dsa {
 	
 	Cell callerC = sm.get(Cell(const_cast<Node*> (n), 0));
 	if (callerC.isNull ()) {
-	  errs () << "ERROR: callee node " << *n << " not mapped to a caller node.\n";
+	  diags () << "ERROR: callee node " << *n << " not mapped to a caller node.\n";
 	  return false;
 	}
       }
     return true;
   }
   
-  bool BottomUpAnalysis::runOnModule(Module &M, GraphMap &graphs) 
+  static uint64_t hashCombine (uint64_t seed, uint64_t v)
+  { return seed ^ (v + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2)); }
+  
+  // FNV-1a hash of a string so that it is stable across runs
+  static uint64_t fnvHash (StringRef str)
+  {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (char c : str)
+      {
+	h ^= (unsigned char) c;
+	h *= 0x100000001b3ULL;
+      }
+    return h;
+  }
+  
+  namespace
   {
+    // Structural hash of the IR that is stable across runs. It does
+    // not depend on addresses, on the names of local values or on
+    // metadata since none of them change a graph. Local values are
+    // hashed by their position in their function and global values
+    // by their name.
+    class IRHasher
+    {
+      DenseMap<const Type*, uint64_t> m_types;
+      DenseMap<const Constant*, uint64_t> m_constants;
+      DenseMap<const Value*, uint64_t> m_locals;
+      
+      static uint64_t hashAPInt (uint64_t h, const APInt &v)
+      {
+	h = hashCombine (h, v.getBitWidth ());
+	for (unsigned i = 0, e = v.getNumWords (); i < e; ++i)
+	  h = hashCombine (h, v.getRawData () [i]);
+	return h;
+      }
+      
+    public:
+      
+      uint64_t hashType (const Type *t)
+      {
+	auto it = m_types.find (t);
+	if (it != m_types.end ()) return it->second;
+	
+	uint64_t h = t->getTypeID ();
+	switch (t->getTypeID ())
+	  {
+	  case Type::IntegerTyID:
+	    h = hashCombine (h, cast<IntegerType> (t)->getBitWidth ());
+	    break;
+	  case Type::PointerTyID:
+	    h = hashCombine (h, cast<PointerType> (t)->getAddressSpace ());
+	    h = hashCombine (h, hashType (cast<PointerType> (t)->getElementType ()));
+	    break;
+	  case Type::ArrayTyID:
+	    h = hashCombine (h, cast<ArrayType> (t)->getNumElements ());
+	    h = hashCombine (h, hashType (cast<ArrayType> (t)->getElementType ()));
+	    break;
+	  case Type::VectorTyID:
+	    h = hashCombine (h, cast<VectorType> (t)->getNumElements ());
+	    h = hashCombine (h, hashType (cast<VectorType> (t)->getElementType ()));
+	    break;
+	  case Type::StructTyID:
+	    {
+	      // -- the body of a named struct is hashed with the module
+	      //    since it can be recursive
+	      const StructType *st = cast<StructType> (t);
+	      if (st->hasName ())
+		h = hashCombine (h, fnvHash (st->getName ()));
+	      else
+		{
+		  h = hashCombine (h, st->isPacked ());
+		  for (auto it = st->element_begin (), et = st->element_end (); it != et; ++it)
+		    h = hashCombine (h, hashType (*it));
+		}
+	      break;
+	    }
+	  case Type::FunctionTyID:
+	    {
+	      const FunctionType *ft = cast<FunctionType> (t);
+	      h = hashCombine (h, ft->isVarArg ());
+	      h = hashCombine (h, hashType (ft->getReturnType ()));
+	      for (auto it = ft->param_begin (), et = ft->param_end (); it != et; ++it)
+		h = hashCombine (h, hashType (*it));
+	      break;
+	    }
+	  default:
+	    break;
+	  }
+	m_types [t] = h;
+	return h;
+      }
+      
+      uint64_t hashConstant (const Constant *c)
+      {
+	auto it = m_constants.find (c);
+	if (it != m_constants.end ()) return it->second;
+	
+	uint64_t h = hashCombine (c->getValueID (), hashType (c->getType ()));
+	if (const GlobalValue *gv = dyn_cast<GlobalValue> (c))
+	  h = hashCombine (h, fnvHash (gv->getName ()));
+	else if (const ConstantInt *ci = dyn_cast<ConstantInt> (c))
+	  h = hashAPInt (h, ci->getValue ());
+	else if (const ConstantFP *cfp = dyn_cast<ConstantFP> (c))
+	  h = hashAPInt (h, cfp->getValueAPF ().bitcastToAPInt ());
+	else if (const ConstantDataSequential *cds = dyn_cast<ConstantDataSequential> (c))
+	  h = hashCombine (h, fnvHash (cds->getRawDataValues ()));
+	else if (const BlockAddress *ba = dyn_cast<BlockAddress> (c))
+	  {
+	    const Function *fn = ba->getFunction ();
+	    h = hashCombine (h, fnvHash (fn->getName ()));
+	    unsigned pos = 0;
+	    for (auto &bb : *fn)
+	      {
+		if (&bb == ba->getBasicBlock ()) break;
+		++pos;
+	      }
+	    h = hashCombine (h, pos);
+	  }
+	else
+	  {
+	    if (const ConstantExpr *ce = dyn_cast<ConstantExpr> (c))
+	      {
+		h = hashCombine (h, ce->getOpcode ());
+		if (ce->isCompare ()) h = hashCombine (h, ce->getPredicate ());
+		if (ce->hasIndices ())
+		  for (unsigned idx : ce->getIndices ()) h = hashCombine (h, idx);
+		if (const GEPOperator *gep = dyn_cast<GEPOperator> (ce))
+		  h = hashCombine (h, gep->isInBounds ());
+	      }
+	    // -- aggregates and constant expressions
+	    for (const Use &u : c->operands ())
+	      h = hashCombine (h, hashConstant (cast<Constant> (u.get ())));
+	  }
+	m_constants [c] = h;
+	return h;
+      }
+      
+      uint64_t hashValue (const Value *v)
+      {
+	auto it = m_locals.find (v);
+	if (it != m_locals.end ()) return hashCombine (1, it->second);
+	if (const Constant *c = dyn_cast<Constant> (v))
+	  return hashCombine (2, hashConstant (c));
+	if (const InlineAsm *ia = dyn_cast<InlineAsm> (v))
+	  {
+	    uint64_t h = hashCombine (3, hashType (ia->getType ()));
+	    h = hashCombine (h, fnvHash (ia->getAsmString ()));
+	    h = hashCombine (h, fnvHash (ia->getConstraintString ()));
+	    return hashCombine (h, ia->hasSideEffects ());
+	  }
+	// -- metadata
+	return hashCombine (4, v->getValueID ());
+      }
+      
+      uint64_t hashFunction (const Function &fn)
+      {
+	m_locals.clear ();
+	uint64_t pos = 0;
+	for (auto it = fn.arg_begin (), et = fn.arg_end (); it != et; ++it)
+	  m_locals [&*it] = pos++;
+	for (auto &bb : fn)
+	  {
+	    m_locals [&bb] = pos++;
+	    for (auto &I : bb) m_locals [&I] = pos++;
+	  }
+	
+	uint64_t h = fnvHash (fn.getName ());
+	h = hashCombine (h, hashType (fn.getType ()));
+	for (auto &bb : fn)
+	  {
+	    h = hashCombine (h, bb.size ());
+	    for (auto &I : bb)
+	      {
+		h = hashCombine (h, I.getOpcode ());
+		h = hashCombine (h, hashType (I.getType ()));
+		h = hashCombine (h, I.getNumOperands ());
+		for (const Use &u : I.operands ())
+		  h = hashCombine (h, hashValue (u.get ()));
+		
+		if (const CmpInst *cmp = dyn_cast<CmpInst> (&I))
+		  h = hashCombine (h, cmp->getPredicate ());
+		else if (const AllocaInst *alloca = dyn_cast<AllocaInst> (&I))
+		  h = hashCombine (h, hashType (alloca->getAllocatedType ()));
+		else if (const GetElementPtrInst *gep = dyn_cast<GetElementPtrInst> (&I))
+		  h = hashCombine (h, gep->isInBounds ());
+		else if (const PHINode *phi = dyn_cast<PHINode> (&I))
+		  {
+		    for (unsigned i = 0, e = phi->getNumIncomingValues (); i < e; ++i)
+		      h = hashCombine (h, hashValue (phi->getIncomingBlock (i)));
+		  }
+		else if (const ExtractValueInst *ev = dyn_cast<ExtractValueInst> (&I))
+		  {
+		    for (unsigned idx : ev->getIndices ()) h = hashCombine (h, idx);
+		  }
+		else if (const InsertValueInst *iv = dyn_cast<InsertValueInst> (&I))
+		  {
+		    for (unsigned idx : iv->getIndices ()) h = hashCombine (h, idx);
+		  }
+	      }
+	  }
+	return h;
+      }
+    };
+  }
+  
+  uint64_t BottomUpAnalysis::fingerprint (const Function &fn)
+  {
+    IRHasher hasher;
+    return hasher.hashFunction (fn);
+  }
+  
+  uint64_t BottomUpAnalysis::fingerprint (const Module &M)
+  {
+    IRHasher hasher;
+    uint64_t h = fnvHash (M.getDataLayoutStr ());
     
-    LOG("dsa-bu", errs () << "Started bottom-up analysis ... \n");
+    // -- named structs are hashed by name inside other types so
+    //    their bodies are hashed here
+    TypeFinder structs;
+    structs.run (M, true);
+    for (StructType *st : structs)
+      {
+	h = hashCombine (h, fnvHash (st->getName ()));
+	h = hashCombine (h, st->isPacked ());
+	h = hashCombine (h, st->isOpaque ());
+	for (auto it = st->element_begin (), et = st->element_end (); it != et; ++it)
+	  h = hashCombine (h, hasher.hashType (*it));
+      }
     
+    for (auto it = M.global_begin (), et = M.global_end (); it != et; ++it)
+      {
+	h = hashCombine (h, hasher.hashConstant (&*it));
+	h = hashCombine (h, it->getLinkage ());
+	h = hashCombine (h, it->isConstant ());
+	if (it->hasInitializer ())
+	  h = hashCombine (h, hasher.hashConstant (it->getInitializer ()));
+      }
+    for (auto it = M.alias_begin (), et = M.alias_end (); it != et; ++it)
+      {
+	h = hashCombine (h, hasher.hashConstant (&*it));
+	h = hashCombine (h, hasher.hashConstant (it->getAliasee ()));
+      }
+    return h;
+  }
+  
+  uint64_t BottomUpAnalysis::sccHash (const std::vector<CallGraphNode*> &scc)
+  {
+    uint64_t h = m_module_hash;
+    std::vector<uint64_t> callees;
+    for (CallGraphNode *cgn : scc)
+      {
+	Function *fn = cgn->getFunction ();
+	if (!fn || fn->isDeclaration () || fn->empty ()) continue;
+	uint64_t fp = fingerprint (*fn);
+	h = hashCombine (h, fp);
+	if (!m_cache->hasFingerprint (*fn, fp)) m_edited.insert (fn);
+	m_cache->addFingerprint (*fn, fp);
+	
+	for (auto &callRecord : *cgn)
+	  {
+	    Function *callee = callRecord.second->getFunction ();
+	    // -- callees in the same scc do not have a hash yet
+	    if (callee && m_hashes.count (callee))
+	      callees.push_back (m_hashes [callee]);
+	  }
+      }
+    
+    // -- the order of the callsites does not matter
+    std::sort (callees.begin (), callees.end ());
+    for (uint64_t c : callees) h = hashCombine (h, c);
+    return h;
+  }
+  
+  void BottomUpAnalysis::runOnSCC (const std::vector<CallGraphNode*> &scc,
+				   GraphMap &graphs)
+  {
     // Keep it true until implementation is stable
     #ifndef SANITY_CHECKS
     const bool do_sanity_checks = false;
@@ -139,95 +422,159 @@ namespace sea_dsa {
     #endif 
     
     LocalAnalysis la (m_dl, m_tli);
-    for (auto it = scc_begin (&m_cg); !it.isAtEnd (); ++it)
+    
+    uint64_t hash = 0;
+    if (m_cache) hash = sccHash (scc);
+    
+    // -- reuse the graph of the previous run if the scc and its
+    //    callees did not change
+    GraphRef fGraph = nullptr;
+    bool reused = false;
+    if (m_cache)
+      for (CallGraphNode *cgn : scc)
+	{
+	  Function *fn = cgn->getFunction ();
+	  if (!fn || fn->isDeclaration () || fn->empty ()) continue;
+	  fGraph = m_cache->getBottomUpGraph (*fn, hash);
+	  reused = (fGraph != nullptr);
+	  break;
+	}
+    
+    // -- compute a local graph shared between all functions in the scc
+    for (CallGraphNode *cgn : scc)
+      {
+	Function *fn = cgn->getFunction ();
+	if (!fn || fn->isDeclaration () || fn->empty ()) continue;
+	
+	if (!fGraph) {
+	  assert (graphs.find(fn) != graphs.end());
+	  fGraph = graphs[fn];
+	  assert (fGraph);
+	}
+	
+	if (!reused) la.runOnFunction (*fn, *fGraph);
+	graphs[fn] = fGraph;
+      }
+    
+    // -- size of the local graph of the scc
+    uint64_t localNodes = 0;
+    if (fGraph && ShapeProfile::isEnabled ())
+      localNodes = std::distance (fGraph->begin (), fGraph->end ());
+    
+    for (CallGraphNode *cgn : scc)
       {
-        auto &scc = *it;
+	Function *fn = cgn->getFunction ();
+	if (!fn || fn->isDeclaration () || fn->empty ()) continue;
 	
-        // -- compute a local graph shared between all functions in the scc
-        GraphRef fGraph = nullptr;
-        for (CallGraphNode *cgn : scc)
+	// -- resolve all function calls in the SCC (already done
+	//    if the graph is reused)
+	for (auto &callRecord : *cgn)
 	  {
-	    Function *fn = cgn->getFunction ();
-	    if (!fn || fn->isDeclaration () || fn->empty ()) continue;
+	    if (reused) continue;
 	    
-	    if (!fGraph) {
-	      assert (graphs.find(fn) != graphs.end());
-	      fGraph = graphs[fn];
-	      assert (fGraph);
-	    }
+	    ImmutableCallSite CS (callRecord.first);
+	    DsaCallSite dsaCS (CS);
+	    const Function *callee = dsaCS.getCallee ();
+	    if (!callee || callee->isDeclaration () || callee->empty ()) continue;
+	    
+	    assert (graphs.count (dsaCS.getCaller ()) > 0);
+	    assert (graphs.count (dsaCS.getCallee ()) > 0);
 	    
-	    la.runOnFunction (*fn, *fGraph);
-	    graphs[fn] = fGraph;
+	    Graph &callerG = *(graphs.find (dsaCS.getCaller())->second);
+	    Graph &calleeG = *(graphs.find (dsaCS.getCallee())->second);
+	    
+	    cloneAndResolveArguments (dsaCS, calleeG, callerG);
 	  }
 	
-        for (CallGraphNode *cgn : scc)
+	// -- store the simulation maps from the SCC
+	for (auto &callRecord : *cgn)
 	  {
-	    Function *fn = cgn->getFunction ();
-	    if (!fn || fn->isDeclaration () || fn->empty ()) continue;
+	    ImmutableCallSite CS (callRecord.first);
+	    DsaCallSite dsaCS (CS);
+	    const Function *callee = dsaCS.getCallee ();
+	    if (!callee || callee->isDeclaration () || callee->empty ()) continue;
 	    
-	    // -- resolve all function calls in the SCC
-	    for (auto &callRecord : *cgn)
-	      {
-		ImmutableCallSite CS (callRecord.first);
-		DsaCallSite dsaCS (CS);
-		const Function *callee = dsaCS.getCallee ();
-		if (!callee || callee->isDeclaration () || callee->empty ()) continue;
-		
-		assert (graphs.count (dsaCS.getCaller ()) > 0);
-		assert (graphs.count (dsaCS.getCallee ()) > 0);
-		
-		Graph &callerG = *(graphs.find (dsaCS.getCaller())->second);
-		Graph &calleeG = *(graphs.find (dsaCS.getCallee())->second);
-		
-		cloneAndResolveArguments (dsaCS, calleeG, callerG);
-	      }
+	    assert (graphs.count (dsaCS.getCaller ()) > 0);
+	    assert (graphs.count (dsaCS.getCallee ()) > 0);
 	    
-	    // -- store the simulation maps from the SCC
-	    for (auto &callRecord : *cgn)
-	      {
-		ImmutableCallSite CS (callRecord.first);
-		DsaCallSite dsaCS (CS);
-		const Function *callee = dsaCS.getCallee ();
-		if (!callee || callee->isDeclaration () || callee->empty ()) continue;
-		
-		assert (graphs.count (dsaCS.getCaller ()) > 0);
-		assert (graphs.count (dsaCS.getCallee ()) > 0);
-		
-		Graph &callerG = *(graphs.find (dsaCS.getCaller())->second);
-		Graph &calleeG = *(graphs.find (dsaCS.getCallee())->second);
-		
-		SimulationMapperRef sm (new SimulationMapper());
-		bool res = Graph::computeCalleeCallerMapping(dsaCS, calleeG, callerG,
-							     *sm, do_sanity_checks);
-		assert (res); // the simulation map was successfully built.
-		m_callee_caller_map.insert(std::make_pair(dsaCS.getInstruction(), sm));
-		
-		if (do_sanity_checks) {
-		  // Check the simulation map is a function
-		  if (!sm->isFunction ())
-		    errs () << "ERROR: simulation map for "
-			    << *dsaCS.getInstruction ()
-			    << " is not a function!\n";
-		  // Check that all nodes in the callee are mapped to one
-		  // node in the caller graph
-		  checkAllNodesAreMapped (*callee, calleeG,  *sm);
-		}
-	      }
+	    Graph &callerG = *(graphs.find (dsaCS.getCaller())->second);
+	    Graph &calleeG = *(graphs.find (dsaCS.getCallee())->second);
 	    
+	    SimulationMapperRef sm (new SimulationMapper());
+	    bool res = Graph::computeCalleeCallerMapping(dsaCS, calleeG, callerG,
+							 *sm, do_sanity_checks);
+	    assert (res); // the simulation map was successfully built.
+	    m_callee_caller_map.insert(std::make_pair(dsaCS.getInstruction(), sm));
+	    
+	    if (do_sanity_checks) {
+	      // Check the simulation map is a function
+	      if (!sm->isFunction ())
+		diags () << "ERROR: simulation map for "
+			<< *dsaCS.getInstruction ()
+			<< " is not a function!\n";
+	      // Check that all nodes in the callee are mapped to one
+	      // node in the caller graph
+	      checkAllNodesAreMapped (*callee, calleeG,  *sm);
+	    }
 	  }
 	
-        if (fGraph) fGraph->compress();        
       }
     
+    if (fGraph) fGraph->compress();        
+    
+    if (fGraph && !reused && ShapeProfile::isEnabled ())
+      {
+	uint64_t nodes = std::distance (fGraph->begin (), fGraph->end ());
+	ShapeProfile::get ().record (SHAPE_SCC_GROWTH,
+				     nodes > localNodes ? nodes - localNodes : 0);
+      }
+    
+    for (CallGraphNode *cgn : scc)
+      {
+	Function *fn = cgn->getFunction ();
+	if (!fn || fn->isDeclaration () || fn->empty ()) continue;
+	m_hashes [fn] = hash;
+	if (!reused) m_recomputed.insert (fn);
+	if (m_cache) m_cache->addBottomUpGraph (*fn, hash, *fGraph);
+      }
+  }
+  
+  bool BottomUpAnalysis::runOnModule(Module &M, GraphMap &graphs) 
+  {
+    
+    LOG("dsa-bu", logs () << "Started bottom-up analysis ... \n");
+    
+    if (m_cache) m_module_hash = fingerprint (M);
+    
+    for (auto it = scc_begin (&m_cg); !it.isAtEnd (); ++it)
+      {
+	// -- only SCCs whose graphs have been allocated are analyzed
+	//    (e.g., the ones reachable from the entry points)
+	bool allocated = false;
+	for (CallGraphNode *cgn : *it)
+	  {
+	    Function *fn = cgn->getFunction ();
+	    if (!fn || fn->isDeclaration () || fn->empty ()) continue;
+	    allocated = graphs.count (fn) > 0;
+	    break;
+	  }
+	if (allocated) runOnSCC (*it, graphs);
+      }
+    
+    LOG ("dsa-bu", 
+	 if (m_cache)
+	   logs () << "Recomputed " << m_recomputed.size () << " out of "
+		   << m_hashes.size () << " bottom-up graphs\n";);
+    
     LOG ("dsa-bu-graph", 
 	 for (auto &kv : graphs) 
            {
-             errs () << "### Bottom-up Dsa graph for " << kv.first->getName () << "\n";
-             kv.second->write (errs ());
-             errs () << "\n";
+             logs () << "### Bottom-up Dsa graph for " << kv.first->getName () << "\n";
+             kv.second->write (logs ());
+             logs () << "\n";
            });
     
-    LOG("dsa-bu", errs () << "Finished bottom-up analysis\n");
+    LOG("dsa-bu", logs () << "Finished bottom-up analysis\n");
     return false;
   }
   
@@ -243,6 +590,15 @@ namespace sea_dsa {
     AU.setPreservesAll ();
   }
   
+  uint64_t BottomUpAnalysis::mappersMemoryUsage () const
+  {
+    uint64_t res = m_callee_caller_map.capacity () *
+      sizeof (CalleeCallerMapping::value_type);
+    for (auto &kv : m_callee_caller_map)
+      res += kv.second->memoryUsage ();
+    return res;
+  }
+  
   bool BottomUp::runOnModule (Module &M)
   {
     m_dl = &getAnalysis<DataLayoutPass>().getDataLayout ();
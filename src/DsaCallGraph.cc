@@ -81,18 +81,18 @@ namespace sea_dsa {
     }
     
     LOG ("dsa-cg",
-	 errs () << "--- USES ---\n";
+	 logs () << "--- USES ---\n";
 	 for (auto kv: m_uses) {
-	   errs () << kv.first->getName () << " ---> \n";
+	   logs () << kv.first->getName () << " ---> \n";
 	   for (auto &CS: *(kv.second)) {
-	     errs () << "\t" << CS->getParent()->getParent()->getName () << ":" << *CS << "\n";
+	     logs () << "\t" << CS->getParent()->getParent()->getName () << ":" << *CS << "\n";
 	   }
 	 }
-	 errs () << "--- DEFS ---\n";
+	 logs () << "--- DEFS ---\n";
 	 for (auto kv: m_defs) {
-	   errs () << kv.first->getName () << " ---> \n";
+	   logs () << kv.first->getName () << " ---> \n";
 	   for (auto &CS: *(kv.second)) {
-	     errs () << "\t" << *CS << "\n";
+	     logs () << "\t" << *CS << "\n";
 	   }
 	 });
   }
@@ -0,0 +1,208 @@
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instruction.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "sea_dsa/CollapseProfile.hh"
+#include "sea_dsa/support/Strings.h"
+#include "sea_dsa/support/Debug.h"
+
+#include <algorithm>
+#include <vector>
+
+static llvm::cl::opt<bool>
+ProfileCollapses("sea-dsa-collapse-profile",
+		 llvm::cl::desc("DSA: record why and where nodes are collapsed"),
+		 llvm::cl::init(false));
+
+static llvm::cl::opt<std::string>
+ProfileCollapsesToFile("sea-dsa-collapse-profile-to-file",
+		       llvm::cl::desc("DSA: write the collapse profile into a CSV (or .json) file"),
+		       llvm::cl::init(""),
+		       llvm::cl::value_desc("FILE"));
+
+using namespace llvm;
+
+namespace sea_dsa {
+
+  const char *collapseReasonName (CollapseReason r) {
+    switch (r) {
+    case COLLAPSE_ARRAY_GROW:       return "array-grow";
+    case COLLAPSE_MERGE_COLLAPSED:  return "merge-collapsed";
+    case COLLAPSE_ARRAY_AT_OFFSET:  return "array-at-offset";
+    case COLLAPSE_ARRAY_SIZES:      return "array-sizes";
+    case COLLAPSE_ARRAYS_AT_OFFSET: return "arrays-at-offset";
+    case COLLAPSE_OUT_OF_ARRAY:     return "out-of-array";
+    case COLLAPSE_SELF_AT_OFFSET:   return "self-at-offset";
+    default:                        return "unknown";
+    }
+  }
+
+  const char *collapsePhaseName (CollapsePhase p) {
+    switch (p) {
+    case PHASE_LOCAL:               return "local";
+    case PHASE_BOTTOM_UP:           return "bottom-up";
+    case PHASE_TOP_DOWN:            return "top-down";
+    case PHASE_CONTEXT_INSENSITIVE: return "context-insensitive";
+    default:                        return "unknown";
+    }
+  }
+
+  CollapseProfile::Scope::Scope (CollapsePhase phase, const Function *fn,
+				 const Instruction *inst)
+    : m_phase (PHASE_UNKNOWN), m_fn (nullptr), m_inst (nullptr),
+      m_active (isEnabled ()) {
+    if (!m_active) return;
+    CollapseProfile &p = get ();
+    m_phase = p.m_phase;
+    m_fn = p.m_fn;
+    m_inst = p.m_inst;
+    p.m_phase = phase;
+    p.m_fn = fn;
+    p.m_inst = inst;
+  }
+
+  CollapseProfile::Scope::~Scope () {
+    if (!m_active) return;
+    CollapseProfile &p = get ();
+    p.m_phase = m_phase;
+    p.m_fn = m_fn;
+    p.m_inst = m_inst;
+  }
+
+  bool CollapseProfile::isEnabled ()
+  { return ProfileCollapses || !ProfileCollapsesToFile.empty (); }
+
+  CollapseProfile &CollapseProfile::get () {
+    static thread_local CollapseProfile profile;
+    return profile;
+  }
+
+  void CollapseProfile::record (CollapseReason reason, unsigned size, unsigned fields) {
+    Counters &c = m_events [Key (reason, m_phase, m_fn, m_inst)];
+    c.m_count++;
+    c.m_lost_bytes += size;
+    c.m_lost_fields += fields;
+  }
+
+  // Print the n entries of m with more collapses
+  template <typename Map>
+  static void printTop (const char *title, const Map &m, unsigned n, raw_ostream &o) {
+    typedef std::pair<typename Map::key_type, typename Map::mapped_type> entry_t;
+    std::vector<entry_t> entries (m.begin (), m.end ());
+    std::stable_sort (entries.begin (), entries.end (),
+		      [] (const entry_t &e1, const entry_t &e2)
+		      { return e1.second.m_count > e2.second.m_count; });
+    o << "\t " << title << ":\n";
+    for (unsigned i = 0; i < entries.size () && i < n; ++i)
+      o << "\t   " << entries [i].second.m_count << " collapses, "
+	<< entries [i].second.m_lost_bytes << " bytes and "
+	<< entries [i].second.m_lost_fields << " fields lost: "
+	<< entries [i].first << "\n";
+  }
+
+  void CollapseProfile::printSummary (raw_ostream &o, unsigned top) const {
+    // -- aggregate by reason, phase, function and instruction. Maps
+    //    are keyed by name so that the output is deterministic.
+    std::map<std::string, Counters> byReason, byPhase, byFn, byInst;
+    Counters total;
+    auto add = [] (Counters &c, const Counters &d) {
+      c.m_count += d.m_count;
+      c.m_lost_bytes += d.m_lost_bytes;
+      c.m_lost_fields += d.m_lost_fields;
+    };
+    for (auto &kv : m_events) {
+      const Counters &c = kv.second;
+      add (total, c);
+      add (byReason [collapseReasonName (std::get<0> (kv.first))], c);
+      add (byPhase [collapsePhaseName (std::get<1> (kv.first))], c);
+      if (const Function *fn = std::get<2> (kv.first)) add (byFn [fnName (fn)], c);
+      if (const Instruction *I = std::get<3> (kv.first))
+	add (byInst [fnName (I->getParent ()->getParent ()) + ": " + instString (I)], c);
+    }
+
+    o << " --- Collapse information\n";
+    o << "\t" << total.m_count << " number of collapses.\n";
+    o << "\t" << total.m_lost_bytes << " number of bytes of collapsed nodes.\n";
+    o << "\t" << total.m_lost_fields << " number of typed fields of collapsed nodes.\n";
+    if (total.m_count == 0) return;
+    printTop ("By reason", byReason, NUM_COLLAPSE_REASONS, o);
+    printTop ("By phase", byPhase, NUM_COLLAPSE_PHASES, o);
+    printTop ("Functions with more collapses", byFn, top, o);
+    printTop ("Instructions with more collapses", byInst, top, o);
+  }
+
+  namespace {
+    struct Row {
+      const char *m_reason;
+      const char *m_phase;
+      std::string m_fn;
+      std::string m_inst;
+      CollapseProfile::Counters m_counters;
+    };
+  }
+
+  // The events with names, most frequent first. Ties are broken by
+  // name so that the order does not depend on addresses.
+  template <typename Map>
+  static std::vector<Row> getRows (const Map &events) {
+    std::vector<Row> rows;
+    for (auto &kv : events)
+      rows.push_back (Row {collapseReasonName (std::get<0> (kv.first)),
+			   collapsePhaseName (std::get<1> (kv.first)),
+			   fnName (std::get<2> (kv.first)),
+			   instString (std::get<3> (kv.first)),
+			   kv.second});
+    std::sort (rows.begin (), rows.end (), [] (const Row &r1, const Row &r2) {
+	if (r1.m_counters.m_count != r2.m_counters.m_count)
+	  return r1.m_counters.m_count > r2.m_counters.m_count;
+	return std::make_tuple (std::string (r1.m_reason), std::string (r1.m_phase),
+				r1.m_fn, r1.m_inst) <
+	  std::make_tuple (std::string (r2.m_reason), std::string (r2.m_phase),
+			   r2.m_fn, r2.m_inst);
+      });
+    return rows;
+  }
+
+  void CollapseProfile::writeCSV (raw_ostream &o) const {
+    o << "reason,phase,function,instruction,count,lost_bytes,lost_fields\n";
+    for (const Row &r : getRows (m_events))
+      o << r.m_reason << "," << r.m_phase << ","
+	<< quoteCSV (r.m_fn) << "," << quoteCSV (r.m_inst) << ","
+	<< r.m_counters.m_count << "," << r.m_counters.m_lost_bytes << ","
+	<< r.m_counters.m_lost_fields << "\n";
+  }
+
+  void CollapseProfile::writeJSON (raw_ostream &o) const {
+    o << "[";
+    bool first = true;
+    for (const Row &r : getRows (m_events)) {
+      if (!first) o << ",";
+      first = false;
+      o << "\n {\"reason\":\"" << r.m_reason
+	<< "\",\"phase\":\"" << r.m_phase
+	<< "\",\"function\":\"" << escapeJSON (r.m_fn)
+	<< "\",\"instruction\":\"" << escapeJSON (r.m_inst)
+	<< "\",\"count\":" << r.m_counters.m_count
+	<< ",\"lost_bytes\":" << r.m_counters.m_lost_bytes
+	<< ",\"lost_fields\":" << r.m_counters.m_lost_fields << "}";
+    }
+    o << "\n]\n";
+  }
+
+  void CollapseProfile::writeToFile () const {
+    if (ProfileCollapsesToFile.empty ()) return;
+    std::error_code EC;
+    raw_fd_ostream file (ProfileCollapsesToFile, EC, sys::fs::F_Text);
+    if (EC) {
+      diags () << "WARNING: cannot open " << ProfileCollapsesToFile << "\n";
+      return;
+    }
+    StringRef name (ProfileCollapsesToFile);
+    if (name.endswith (".json"))
+      writeJSON (file);
+    else
+      writeCSV (file);
+  }
+}
@@ -0,0 +1,338 @@
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/ValueSymbolTable.h"
+#include "llvm/Target/TargetLibraryInfo.h"
+#include "llvm/Pass.h"
+#include "llvm/Analysis/CallGraph.h"
+#include "llvm/ADT/SCCIterator.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "sea_dsa/config.h"
+#include "sea_dsa/DemandDriven.hh"
+#include "sea_dsa/Global.hh"
+#include "sea_dsa/DsaAnalysis.hh"
+#include "sea_dsa/CallSite.hh"
+#include "sea_dsa/support/Debug.h"
+
+#include <algorithm>
+#include <queue>
+
+using namespace llvm;
+
+namespace sea_dsa {
+
+  static bool hasBody (const Function *fn)
+  { return fn && !fn->isDeclaration () && !fn->empty (); }
+
+  void DemandDrivenAnalysis::buildUses ()
+  {
+    if (m_uses_built) return;
+    m_uses_built = true;
+
+    for (auto &kv : m_cg)
+      {
+	CallGraphNode *cgn = kv.second;
+	if (!hasBody (cgn->getFunction ())) continue;
+
+	for (auto &callRecord : *cgn)
+	  {
+	    ImmutableCallSite CS (callRecord.first);
+	    if (!CS) continue;
+	    DsaCallSite dsaCS (CS);
+	    const Function *callee = dsaCS.getCallee ();
+	    if (!hasBody (callee)) continue;
+	    m_uses [callee].push_back (CS.getInstruction ());
+	  }
+      }
+  }
+
+  void DemandDrivenAnalysis::computeBottomUp (const Function &fn)
+  {
+    if (m_graphs.count (&fn) > 0) return;
+
+    // -- SCCs reachable from fn in post-order: callees come first
+    for (auto it = scc_begin (m_cg [&fn]); !it.isAtEnd (); ++it)
+      {
+	const std::vector<CallGraphNode*> &scc = *it;
+
+	bool done = false;
+	bool empty = true;
+	for (CallGraphNode *cgn : scc)
+	  {
+	    const Function *f = cgn->getFunction ();
+	    if (!hasBody (f)) continue;
+	    empty = false;
+	    done = m_graphs.count (f) > 0;
+	    break;
+	  }
+	if (empty || done) continue;
+
+	for (CallGraphNode *cgn : scc)
+	  {
+	    const Function *f = cgn->getFunction ();
+	    if (!hasBody (f)) continue;
+	    m_graphs [f] = std::make_shared<Graph> (m_dl, m_setFactory);
+	  }
+
+	m_bu.runOnSCC (scc, m_graphs);
+      }
+  }
+
+  void DemandDrivenAnalysis::computeTopDown (const Function &fn)
+  {
+    typedef ContextSensitiveGlobalAnalysis CSA;
+
+    if (m_refined.count (&fn) > 0) return;
+
+    buildUses ();
+
+    // -- fn and all its transitive callers
+    FunctionSet ancestors;
+    std::vector<const Function*> stack;
+    ancestors.insert (&fn);
+    stack.push_back (&fn);
+    while (!stack.empty ())
+      {
+	const Function *f = stack.back ();
+	stack.pop_back ();
+	for (const Instruction *I : m_uses.lookup (f))
+	  {
+	    const Function *caller = I->getParent ()->getParent ();
+	    if (ancestors.insert (caller).second)
+	      stack.push_back (caller);
+	  }
+      }
+
+    for (const Function *f : ancestors)
+      computeBottomUp (*f);
+
+    // -- top-down/bottom-up propagation restricted to the callsites
+    //    between ancestors
+    std::queue<const Instruction*> w;
+    DenseSet<const Instruction*> pending;
+    auto enqueue = [&] (const Function &f)
+      {
+	// callsites where f is the callee
+	for (const Instruction *I : m_uses.lookup (&f))
+	  if (ancestors.count (I->getParent ()->getParent ()) > 0 &&
+	      pending.insert (I).second)
+	    w.push (I);
+	// callsites where f is the caller
+	for (auto &callRecord : *m_cg [&f])
+	  {
+	    ImmutableCallSite CS (callRecord.first);
+	    if (!CS) continue;
+	    DsaCallSite dsaCS (CS);
+	    if (ancestors.count (dsaCS.getCallee ()) > 0 &&
+		pending.insert (CS.getInstruction ()).second)
+	      w.push (CS.getInstruction ());
+	  }
+      };
+
+    for (const Function *f : ancestors) enqueue (*f);
+
+    unsigned td_props = 0;
+    unsigned bu_props = 0;
+    while (!w.empty ())
+      {
+	const Instruction *I = w.front ();
+	w.pop ();
+	pending.erase (I);
+
+	if (const CallInst *CI = dyn_cast<CallInst> (I))
+	  if (CI->isInlineAsm ())
+	    continue;
+
+	ImmutableCallSite CS (I);
+	DsaCallSite dsaCS (CS);
+	const Function *callee = dsaCS.getCallee ();
+	if (!hasBody (callee)) continue;
+	const Function *caller = dsaCS.getCaller ();
+
+	Graph &callerG = *(m_graphs.find (caller)->second);
+	Graph &calleeG = *(m_graphs.find (callee)->second);
+
+	auto propKind = CSA::decidePropagation (dsaCS, calleeG, callerG);
+	if (propKind == CSA::DOWN) {
+	  CSA::propagateTopDown (dsaCS, callerG, calleeG);
+	  td_props++;
+	  enqueue (*callee);
+	} else if (propKind == CSA::UP) {
+	  CSA::propagateBottomUp (dsaCS, calleeG, callerG);
+	  bu_props++;
+	  enqueue (*caller);
+	}
+      }
+
+    LOG ("dsa-demand",
+	 logs () << "Refined " << fn.getName () << " along "
+	         << ancestors.size () << " functions: "
+	         << td_props << " top-down and "
+	         << bu_props << " bottom-up propagations\n";);
+
+    // -- graphs refined before might have changed
+    if (td_props + bu_props > 0)
+      {
+	m_refined.clear ();
+	m_cells.clear ();
+      }
+    m_refined.insert (&fn);
+  }
+
+  Graph &DemandDrivenAnalysis::getGraph (const Function &fn)
+  {
+    assert (hasGraph (fn));
+    computeBottomUp (fn);
+    computeTopDown (fn);
+    return *(m_graphs.find (&fn)->second);
+  }
+
+  Cell DemandDrivenAnalysis::getCell (const Function &fn, const Value &v)
+  {
+    if (!hasGraph (fn)) return Cell ();
+
+    auto key = std::make_pair (&fn, &v);
+    auto it = m_cells.find (key);
+    if (it != m_cells.end ()) return it->second;
+
+    Graph &g = getGraph (fn);
+    Cell c;
+    if (g.hasCell (v)) c = g.getCell (v);
+    // -- getGraph might have cleared m_cells
+    m_cells [key] = c;
+    return c;
+  }
+
+  Cell DemandDrivenAnalysis::getCell (const Value &v)
+  {
+    if (const Argument *arg = dyn_cast<Argument> (&v))
+      return getCell (*arg->getParent (), v);
+    if (const Instruction *I = dyn_cast<Instruction> (&v))
+      return getCell (*I->getParent ()->getParent (), v);
+    return Cell ();
+  }
+
+  /// LLVM pass
+
+  DemandDrivenDsa::DemandDrivenDsa ()
+    : ModulePass (ID), m_dda (nullptr) {}
+
+  void DemandDrivenDsa::getAnalysisUsage (AnalysisUsage &AU) const
+  {
+    AU.addRequired<DataLayoutPass> ();
+    AU.addRequired<TargetLibraryInfo> ();
+    AU.addRequired<CallGraphWrapperPass> ();
+    AU.setPreservesAll ();
+  }
+
+  bool DemandDrivenDsa::runOnModule (Module &M)
+  {
+    auto &dl = getAnalysis<DataLayoutPass>().getDataLayout ();
+    auto &tli = getAnalysis<TargetLibraryInfo> ();
+    auto &cg = getAnalysis<CallGraphWrapperPass> ().getCallGraph ();
+
+    m_dda.reset (new DemandDrivenAnalysis (dl, tli, cg, m_setFactory));
+    return false;
+  }
+
+  /// Queries from the command line
+
+  class DsaDemandQuery : public ModulePass
+  {
+    std::vector<std::string> m_queries;
+    bool m_compare;
+
+    static std::string describe (const Cell &c)
+    {
+      if (c.isNull ()) return "no cell";
+
+      const Node &n = *c.getNode ();
+      std::vector<std::string> sites;
+      for (const Value *v : n.getAllocSites ())
+	sites.push_back (v->hasName () ? v->getName ().str () : "<unnamed>");
+      std::sort (sites.begin (), sites.end ());
+
+      std::string res = "offset=" + std::to_string (c.getOffset ()) + " sites=";
+      for (unsigned i = 0; i < sites.size (); ++i)
+	res += (i > 0 ? "," : "") + sites [i];
+      return res + " flags=" + n.getNodeType ().toStr ();
+    }
+
+    static const Value *getValue (const Module &M, const Function &fn,
+				  const std::string &name)
+    {
+      if (!name.empty () && name [0] == '@')
+	return M.getNamedValue (name.substr (1));
+      std::string local = (!name.empty () && name [0] == '%') ? name.substr (1) : name;
+      return fn.getValueSymbolTable ().lookup (local);
+    }
+
+  public:
+
+    static char ID;
+
+    DsaDemandQuery (const std::vector<std::string> &queries, bool compare)
+      : ModulePass (ID), m_queries (queries), m_compare (compare) {}
+
+    void getAnalysisUsage (AnalysisUsage &AU) const override
+    {
+      AU.addRequired<DemandDrivenDsa> ();
+      if (m_compare) AU.addRequired<DsaAnalysis> ();
+      AU.setPreservesAll ();
+    }
+
+    bool runOnModule (Module &M) override
+    {
+      DemandDrivenAnalysis &dda =
+	getAnalysis<DemandDrivenDsa> ().getDemandDrivenAnalysis ();
+      GlobalAnalysis *ga = nullptr;
+      if (m_compare) ga = &getAnalysis<DsaAnalysis> ().getDsaAnalysis ();
+
+      for (const std::string &q : m_queries)
+	{
+	  size_t pos = q.find (':');
+	  const Function *fn =
+	    pos == std::string::npos ? nullptr : M.getFunction (q.substr (0, pos));
+	  if (!fn || !dda.hasGraph (*fn))
+	    {
+	      diags () << "WARNING: " << q << " does not name a defined function\n";
+	      continue;
+	    }
+	  const Value *v = getValue (M, *fn, q.substr (pos + 1));
+	  if (!v)
+	    {
+	      diags () << "WARNING: " << q << " does not name a value\n";
+	      continue;
+	    }
+
+	  errs () << "Demand-driven query " << q << "\n"
+		  << "  demand-driven: " << describe (dda.getCell (*fn, *v)) << "\n";
+	  if (ga && ga->hasGraph (*fn))
+	    {
+	      const Cell *c = ga->getGraph (*fn).findCell (*v);
+	      errs () << "  global: " << describe (c ? *c : Cell ()) << "\n";
+	    }
+	}
+      return false;
+    }
+
+    const char * getPassName() const override
+    { return "Demand-driven Dsa queries"; }
+  };
+
+  char DsaDemandQuery::ID = 0;
+
+  Pass *createDsaDemandQueryPass (const std::vector<std::string> &queries,
+				  bool compare)
+  { return new DsaDemandQuery (queries, compare); }
+
+} // end namespace
+
+char sea_dsa::DemandDrivenDsa::ID = 0;
+
+static llvm::RegisterPass<sea_dsa::DemandDrivenDsa>
+X ("sea-dsa-demand", "Demand-driven Dsa analysis");
@@ -0,0 +1,189 @@
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instruction.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "sea_dsa/FixpointProfile.hh"
+#include "sea_dsa/Graph.hh"
+#include "sea_dsa/support/Strings.h"
+#include "sea_dsa/support/Debug.h"
+
+#include <algorithm>
+#include <string>
+
+static llvm::cl::opt<bool>
+ProfileFixpoint("sea-dsa-fixpoint-profile",
+		llvm::cl::desc("DSA: record the cost of each callsite in the context-sensitive fixpoint"),
+		llvm::cl::init(false));
+
+static llvm::cl::opt<unsigned>
+ProfileFixpointTop("sea-dsa-fixpoint-profile-top",
+		   llvm::cl::desc("DSA: number of callsites reported by the fixpoint profile"),
+		   llvm::cl::init(10));
+
+static llvm::cl::opt<std::string>
+ProfileFixpointTrace("sea-dsa-fixpoint-trace",
+		     llvm::cl::desc("DSA: write the context-sensitive fixpoint as a Chrome trace (JSON)"),
+		     llvm::cl::init(""),
+		     llvm::cl::value_desc("FILE"));
+
+using namespace llvm;
+
+namespace sea_dsa {
+
+  const char *fixpointEventName (FixpointEventKind k) {
+    switch (k) {
+    case FIXPOINT_DECIDE:    return "decide";
+    case FIXPOINT_TOP_DOWN:  return "top-down";
+    case FIXPOINT_BOTTOM_UP: return "bottom-up";
+    default:                 return "unknown";
+    }
+  }
+
+  static std::string callerName (const Instruction *I)
+  { return fnName (I->getParent ()->getParent ()); }
+
+  static std::string calleeName (const Instruction *I) {
+    ImmutableCallSite CS (I);
+    return fnName (CS.getCalledFunction ());
+  }
+
+  static uint64_t nanoseconds (FixpointProfile::clock::duration d)
+  { return std::chrono::duration_cast<std::chrono::nanoseconds> (d).count (); }
+
+  // Print ns as milliseconds (report) or microseconds (trace)
+  static void printMs (raw_ostream &o, uint64_t ns)
+  { o << ns / 1000000 << "." << format ("%03u", (unsigned) (ns / 1000 % 1000)); }
+  static void printUs (raw_ostream &o, uint64_t ns)
+  { o << ns / 1000 << "." << format ("%03u", (unsigned) (ns % 1000)); }
+
+  FixpointProfile::Scope::Scope (FixpointEventKind kind, const Instruction *cs)
+    : m_kind (kind), m_cs (cs), m_last_id (0), m_active (isEnabled ()) {
+    if (!m_active) return;
+    m_last_id = Node::getLastId ();
+    m_start = clock::now ();
+  }
+
+  FixpointProfile::Scope::~Scope ()
+  { if (m_active) get ().record (*this); }
+
+  bool FixpointProfile::isEnabled ()
+  { return ProfileFixpoint || !ProfileFixpointTrace.empty (); }
+
+  FixpointProfile &FixpointProfile::get () {
+    static thread_local FixpointProfile profile;
+    return profile;
+  }
+
+  void FixpointProfile::record (const Scope &s) {
+    uint64_t duration = nanoseconds (clock::now () - s.m_start);
+    uint64_t nodes = Node::getLastId () - s.m_last_id;
+
+    Counters &c = m_callsites [s.m_cs];
+    switch (s.m_kind) {
+    case FIXPOINT_DECIDE:
+      c.m_decide_time += duration;
+      break;
+    case FIXPOINT_TOP_DOWN:
+      c.m_td_props++;
+      c.m_clone_time += duration;
+      break;
+    case FIXPOINT_BOTTOM_UP:
+      c.m_bu_props++;
+      c.m_clone_time += duration;
+      break;
+    }
+    c.m_nodes_created += nodes;
+
+    // -- the timeline is only kept if it is written
+    if (!ProfileFixpointTrace.empty ())
+      m_events.push_back (Event {s.m_kind, s.m_cs,
+				 nanoseconds (s.m_start - m_start), duration, nodes});
+  }
+
+  void FixpointProfile::printSummary (raw_ostream &o) const {
+    typedef std::pair<const Instruction*, Counters> entry_t;
+    std::vector<entry_t> entries (m_callsites.begin (), m_callsites.end ());
+
+    Counters total;
+    for (auto &e : entries) {
+      total.m_dequeues += e.second.m_dequeues;
+      total.m_td_props += e.second.m_td_props;
+      total.m_bu_props += e.second.m_bu_props;
+      total.m_decide_time += e.second.m_decide_time;
+      total.m_clone_time += e.second.m_clone_time;
+      total.m_nodes_created += e.second.m_nodes_created;
+    }
+
+    o << " --- Context-sensitive fixpoint information\n";
+    o << "\t" << entries.size () << " number of callsites dequeued.\n";
+    o << "\t" << total.m_dequeues << " number of dequeues.\n";
+    o << "\t" << total.m_td_props << " number of top-down propagations.\n";
+    o << "\t" << total.m_bu_props << " number of bottom-up propagations.\n";
+    o << "\t" << total.m_nodes_created << " number of nodes created by propagations.\n";
+    o << "\t"; printMs (o, total.m_decide_time); o << " ms deciding propagations.\n";
+    o << "\t"; printMs (o, total.m_clone_time); o << " ms cloning and resolving arguments.\n";
+    if (entries.empty ()) return;
+
+    // -- most expensive first. Ties are broken by name so that the
+    //    order does not depend on addresses.
+    unsigned n = std::min<size_t> (ProfileFixpointTop, entries.size ());
+    std::vector<std::pair<entry_t, std::string> > top;
+    for (auto &e : entries)
+      top.push_back (std::make_pair (e, callerName (e.first) + ": " + instString (e.first)));
+    std::sort (top.begin (), top.end (),
+	       [] (const std::pair<entry_t, std::string> &e1,
+		   const std::pair<entry_t, std::string> &e2) {
+		 if (e1.first.second.time () != e2.first.second.time ())
+		   return e1.first.second.time () > e2.first.second.time ();
+		 return e1.second < e2.second;
+	       });
+
+    o << "\t Callsites with the highest cost:\n";
+    for (unsigned i = 0; i < n; ++i) {
+      const Counters &c = top [i].first.second;
+      o << "\t   ";
+      printMs (o, c.time ());
+      o << " ms (decide ";
+      printMs (o, c.m_decide_time);
+      o << " ms, clone ";
+      printMs (o, c.m_clone_time);
+      o << " ms), " << c.m_dequeues << " dequeues, "
+	<< c.m_td_props << " top-down and " << c.m_bu_props << " bottom-up propagations, "
+	<< c.m_nodes_created << " nodes created: " << top [i].second << "\n";
+    }
+  }
+
+  void FixpointProfile::writeTrace (raw_ostream &o) const {
+    o << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (const Event &e : m_events) {
+      if (!first) o << ",";
+      first = false;
+      o << "\n {\"name\":\"" << fixpointEventName (e.m_kind)
+	<< "\",\"cat\":\"sea-dsa\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":";
+      printUs (o, e.m_start);
+      o << ",\"dur\":";
+      printUs (o, e.m_duration);
+      o << ",\"args\":{\"caller\":\"" << escapeJSON (callerName (e.m_cs))
+	<< "\",\"callee\":\"" << escapeJSON (calleeName (e.m_cs))
+	<< "\",\"callsite\":\"" << escapeJSON (instString (e.m_cs))
+	<< "\",\"nodes_created\":" << e.m_nodes_created << "}}";
+    }
+    o << "\n]}\n";
+  }
+
+  void FixpointProfile::writeToFile () const {
+    if (ProfileFixpointTrace.empty ()) return;
+    std::error_code EC;
+    raw_fd_ostream file (ProfileFixpointTrace, EC, sys::fs::F_Text);
+    if (EC) {
+      diags () << "WARNING: cannot open " << ProfileFixpointTrace << "\n";
+      return;
+    }
+    writeTrace (file);
+  }
+}
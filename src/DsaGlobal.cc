@@ -15,11 +15,16 @@
 #include "sea_dsa/config.h"
 #include "sea_dsa/Graph.hh"
 #include "sea_dsa/Global.hh"
+#include "sea_dsa/FrozenGraph.hh"
 #include "sea_dsa/Local.hh"
 #include "sea_dsa/Cloner.hh"
 #include "sea_dsa/BottomUp.hh"
 #include "sea_dsa/CallSite.hh"
 #include "sea_dsa/CallGraph.hh"
+#include "sea_dsa/CollapseProfile.hh"
+#include "sea_dsa/PhaseTimers.hh"
+#include "sea_dsa/ShapeProfile.hh"
+#include "sea_dsa/FixpointProfile.hh"
 
 // #include "ufo/Stats.hh"
 #include "sea_dsa/support/Debug.h"
@@ -27,6 +32,7 @@
 #include "boost/range/iterator_range.hpp"
 
 #include <queue>
+#include <set>
 
 static llvm::cl::opt<bool>
 normalizeUniqueScalars("sea-dsa-norm-unique-scalar",
@@ -40,6 +46,24 @@ normalizeAllocaSites("sea-dsa-norm-alloca-sites",
                      llvm::cl::init (true),
 		     llvm::cl::Hidden);
 
+static llvm::cl::opt<unsigned>
+HybridMaxSccSize("sea-dsa-hybrid-max-scc-size",
+                 llvm::cl::desc("DSA: hybrid analysis is context-insensitive for SCCs with more functions (0 = no limit)"),
+                 llvm::cl::init (20),
+                 llvm::cl::Hidden);
+
+static llvm::cl::opt<unsigned>
+HybridMaxCallSites("sea-dsa-hybrid-max-callsites",
+                   llvm::cl::desc("DSA: hybrid analysis is context-insensitive for SCCs with more callsites (0 = no limit)"),
+                   llvm::cl::init (200),
+                   llvm::cl::Hidden);
+
+static llvm::cl::opt<unsigned>
+HybridMaxGraphSize("sea-dsa-hybrid-max-graph-size",
+                   llvm::cl::desc("DSA: hybrid analysis is context-insensitive for SCCs with more pointers (0 = no limit)"),
+                   llvm::cl::init (0),
+                   llvm::cl::Hidden);
+
 using namespace llvm;
 
 
@@ -49,6 +73,9 @@ namespace sea_dsa {
   void ContextInsensitiveGlobalAnalysis::
   resolveArguments (DsaCallSite &cs, Graph& g)
   {
+    CollapseProfile::Scope scope (PHASE_CONTEXT_INSENSITIVE, cs.getCaller (),
+				  cs.getInstruction ());
+    PhaseTimers::Scope timer (TIMER_CI_RESOLVE);
     // unify return
     const Function &callee = *cs.getCallee ();
     if (g.hasRetCell(callee))
@@ -74,11 +101,163 @@ namespace sea_dsa {
       }
   }                                      
   
+  void GlobalAnalysis::setEntryPoints (CallGraph &cg,
+				       const std::vector<const Function*> &entries)
+  {
+    m_reachable.clear ();
+    std::vector<const Function*> stack;
+    for (const Function *fn : entries)
+      if (m_reachable.insert (fn).second) stack.push_back (fn);
+    
+    while (!stack.empty ())
+      {
+	const Function *fn = stack.back ();
+	stack.pop_back ();
+	for (auto &callRecord : *cg [fn])
+	  {
+	    const Function *callee = callRecord.second->getFunction ();
+	    if (callee && m_reachable.insert (callee).second)
+	      stack.push_back (callee);
+	  }
+      }
+    
+    LOG ("dsa-global",
+	 logs () << "Analyzing " << m_reachable.size ()
+	         << " functions reachable from the entry points\n";);
+  }
+  
+  GraphHandle &GraphHandle::operator= (GraphHandle &&o)
+  {
+    if (this != &o) {
+      reset ();
+      m_ga = o.m_ga;
+      m_graph = o.m_graph;
+      m_key = o.m_key;
+      o.m_ga = nullptr;
+      o.m_graph = nullptr;
+    }
+    return *this;
+  }
+  
+  void GraphHandle::reset ()
+  {
+    if (m_ga) m_ga->releaseGraph (m_key);
+    m_ga = nullptr;
+    m_graph = nullptr;
+    m_key = nullptr;
+  }
+  
+  Graph::MemoryUsage GlobalAnalysis::memoryUsage (const Module &M) const
+  {
+    Graph::MemoryUsage res;
+    // -- the key identifies the graph even if it is evicted and
+    //    loaded again at another address
+    boost::container::flat_set<const void*> seen;
+    for (auto &F : M) {
+      if (!hasGraph (F)) continue;
+      GraphHandle g = getGraphHandle (F);
+      if (seen.insert (g.getKey ()).second)
+	res += g->memoryUsage ();
+    }
+    return res;
+  }
+  
+  std::shared_ptr<const FrozenGraph>
+  GlobalAnalysis::getFrozenGraph (const Function &F) const
+  {
+    GraphHandle g = getGraphHandle (F);
+    if (canEvictGraphs ()) return std::make_shared<const FrozenGraph> (*g);
+    {
+      std::lock_guard<std::mutex> lock (m_frozen_mutex);
+      auto it = m_frozen.find (g.getKey ());
+      if (it != m_frozen.end ()) return it->second;
+    }
+    // -- built without the lock: another thread might build the
+    //    same snapshot, the first one is kept
+    auto res = std::make_shared<const FrozenGraph> (*g);
+    std::lock_guard<std::mutex> lock (m_frozen_mutex);
+    auto &slot = m_frozen [g.getKey ()];
+    if (!slot) slot = res;
+    return slot;
+  }
+  
+  void GlobalAnalysis::pruneScalars (const Module &M,
+				     const std::vector<std::string> &keep)
+  {
+    m_frozen.clear ();
+    DenseSet<unsigned> keepOpcodes;
+    for (auto &name : keep) {
+      bool found = false;
+      for (unsigned op = 1; op < Instruction::OtherOpsEnd; ++op)
+	if (name == Instruction::getOpcodeName (op)) {
+	  keepOpcodes.insert (op);
+	  found = true;
+	}
+      if (!found)
+	diags () << "WARNING: unknown opcode " << name << " ignored\n";
+    }
+    
+    // -- values to keep, per graph
+    std::vector<Graph*> graphs;
+    DenseMap<Graph*, DenseSet<const Value*> > kept;
+    for (auto &F : M) {
+      if (!hasGraph (F)) continue;
+      Graph *g = &getGraph (F);
+      if (!kept.count (g)) graphs.push_back (g);
+      auto &s = kept [g];
+      auto add = [&s] (const Value *v) { s.insert (v->stripPointerCasts ()); };
+      for (auto &bb : F)
+	for (auto &I : bb) {
+	  if (keepOpcodes.count (I.getOpcode ()))
+	    add (&I);
+	  if (const LoadInst *LI = dyn_cast<LoadInst> (&I))
+	    add (LI->getPointerOperand ());
+	  else if (const StoreInst *SI = dyn_cast<StoreInst> (&I))
+	    add (SI->getPointerOperand ());
+	  else if (const AtomicCmpXchgInst *CI = dyn_cast<AtomicCmpXchgInst> (&I))
+	    add (CI->getPointerOperand ());
+	  else if (const AtomicRMWInst *RI = dyn_cast<AtomicRMWInst> (&I))
+	    add (RI->getPointerOperand ());
+	  else if (isa<CallInst> (&I) || isa<InvokeInst> (&I)) {
+	    // -- the callsite (for its return) and its arguments,
+	    //    including the ones of memory intrinsics
+	    add (&I);
+	    ImmutableCallSite CS (&I);
+	    for (auto it = CS.arg_begin (), et = CS.arg_end (); it != et; ++it)
+	      add (it->get ());
+	  }
+	}
+    }
+    for (Graph *g : graphs) g->pruneScalars (kept [g]);
+  }
+  
+  void GlobalAnalysis::mkGlobalCells (const Module &M)
+  {
+    m_frozen.clear ();
+    // -- functions grouped by graph, in module order
+    std::vector<Graph*> graphs;
+    DenseMap<Graph*, std::vector<const Function*> > fns;
+    for (auto &F : M)
+      if (hasGraph (F)) {
+	Graph *g = &getGraph (F);
+	auto &v = fns [g];
+	if (v.empty ()) graphs.push_back (g);
+	v.push_back (&F);
+      }
+    for (Graph *g : graphs) g->mkGlobalCells (fns [g]);
+  }
+  
+  void GlobalAnalysis::freeze (const Module &M)
+  {
+    for (auto &F : M)
+      if (hasGraph (F)) getGraph (F).freeze ();
+  }
+  
   bool ContextInsensitiveGlobalAnalysis::runOnModule (Module &M)
   {
     
     LOG("dsa-global", 
-	errs () << "Started context-insensitive global analysis ... \n");
+	logs () << "Started context-insensitive global analysis ... \n");
     
     //ufo::Stats::resume ("CI-DsaAnalysis");
     
@@ -96,6 +275,7 @@ namespace sea_dsa {
 	  {
 	    Function *fn = cgn->getFunction ();
 	    if (!fn || fn->isDeclaration () || fn->empty ()) continue;
+	    if (!isReachable (*fn)) continue;
 	    
 	    // compute local graph
 	    Graph fGraph (m_dl, m_setFactory);
@@ -113,6 +293,7 @@ namespace sea_dsa {
 	    // XXX probably not needed since if the function is external
 	    // XXX it will have no call records
 	    if (!fn || fn->isDeclaration () || fn->empty ()) continue;
+	    if (!isReachable (*fn)) continue;
 	    
 	    // -- iterate over all call instructions of the current function fn
 	    // -- they are indexed in the CallGraphNode data structure
@@ -138,12 +319,12 @@ namespace sea_dsa {
     // ufo::Stats::stop ("CI-DsaAnalysis");
     
     LOG ("dsa-global-graph", 
-	 errs () << "### Global Dsa graph \n";
-	 m_graph->write (errs ());
-	 errs () << "\n");
+	 logs () << "### Global Dsa graph \n";
+	 m_graph->write (logs ());
+	 logs () << "\n");
     
     LOG ("dsa-global", 
-	 errs () << "Finished context-insensitive global analysis.\n");
+	 logs () << "Finished context-insensitive global analysis.\n");
     
     return false;
   }
@@ -212,6 +393,9 @@ namespace sea_dsa {
   cloneAndResolveArguments (const DsaCallSite &cs, 
 			    Graph& callerG, Graph& calleeG)      
   {
+    CollapseProfile::Scope scope (PHASE_TOP_DOWN, cs.getCallee (), cs.getInstruction ());
+    PhaseTimers::Scope timer (TIMER_TD_CLONE);
+    ShapeProfile::CloneScope clone;
     
     Cloner C (calleeG);
     
@@ -279,7 +463,7 @@ namespace sea_dsa {
     LOG("dsa-global",
 	if (decidePropagation (cs, calleeG, callerG) == DOWN)
           {
-            errs () << "Sanity check failed:"
+            logs () << "Sanity check failed:"
                     << " we should not need more top-down propagation\n";
           });
     //errs () << "Top-down propagation at " << *cs.getInstruction () << "\n";
@@ -294,7 +478,7 @@ namespace sea_dsa {
     LOG("dsa-global",
 	if (decidePropagation (cs, calleeG, callerG) == UP)
           {
-            errs () << "Sanity check failed:"
+            logs () << "Sanity check failed:"
                     << " we should not need more bottom-up propagation\n";
           });
     //errs () << "Bottom-up propagation at " << *cs.getInstruction () << "\n";      
@@ -302,27 +486,37 @@ namespace sea_dsa {
   }
   
 
+  static unsigned findGroup (std::vector<unsigned> &groups, unsigned i)
+  {
+    while (groups [i] != i)
+      {
+	groups [i] = groups [groups [i]];
+	i = groups [i];
+      }
+    return i;
+  }
+  
   bool ContextSensitiveGlobalAnalysis::runOnModule (Module &M) 
   {
     
-    LOG("dsa-global", errs () << "Started context-sensitive global analysis ... \n");
+    LOG("dsa-global", logs () << "Started context-sensitive global analysis ... \n");
     
     // ufo::Stats::resume ("CS-DsaAnalysis");
 
-    for (auto &F: M)
-      { 
-        if (F.isDeclaration() || F.empty())
-          continue;
-        
-        GraphRef fGraph = std::make_shared<Graph> (m_dl, m_setFactory);
-        m_graphs[&F] = fGraph;
-      }
+    allocateGraphs (M);
 
     // -- Run bottom up analysis on the whole call graph 
     //    and initialize worklist
-    BottomUpAnalysis bu (m_dl, m_tli, m_cg);
+    // XXX: the cache is ignored by subclasses because their graphs
+    // can be shared by several SCCs
+    GraphCache *cache = kind () == CONTEXT_SENSITIVE ? m_cache : nullptr;
+    BottomUpAnalysis bu (m_dl, m_tli, m_cg, cache);
     bu.runOnModule (M, m_graphs);
     
+    // -- graphs of the previous run that are still valid
+    boost::container::flat_set<const Function*> reused;
+    if (cache) reuseGraphs (M, bu, reused);
+    
     DsaCallGraph dsaCG (m_cg);
     dsaCG.buildDependencies ();
     
@@ -337,13 +531,39 @@ namespace sea_dsa {
 	assert (simMapper.isFunction ());
 	
         if (!simMapper.isInjective ()) 
-          w.enqueue (kv.first);  // they do need top-down
+	  {
+	    ImmutableCallSite CS (kv.first);
+	    DsaCallSite dsaCS (CS);
+	    if (!skipCallSite (dsaCS) && !reused.count (dsaCS.getCaller ()))
+	      w.enqueue (kv.first);  // they do need top-down
+	  }
       }
     
+    /// push in the worklist callsites between a reused graph and a
+    /// recomputed one. Callsites between reused graphs need no
+    /// propagation.
+    if (!reused.empty ())
+      for (auto &F: M)
+	{
+	  if (!m_graphs.count (&F)) continue;
+	  for (auto &callRecord : *m_cg [&F])
+	    {
+	      ImmutableCallSite CS (callRecord.first);
+	      DsaCallSite dsaCS (CS);
+	      const Function *callee = dsaCS.getCallee ();
+	      if (!callee || !m_graphs.count (callee) || skipCallSite (dsaCS))
+		continue;
+	      if (reused.count (&F) != reused.count (callee))
+		w.enqueue (CS.getInstruction ());
+	    }
+	}
+    
     /// -- top-down/bottom-up propagation until no change
     
     unsigned td_props = 0;
     unsigned bu_props = 0;
+    FixpointProfile *profile =
+      FixpointProfile::isEnabled () ? &FixpointProfile::get () : nullptr;
     while (!w.empty()) {
       const Instruction* I = w.dequeue();
       
@@ -360,34 +580,46 @@ namespace sea_dsa {
       
       auto caller = dsaCS.getCaller();
       
-      assert (m_graphs.count (caller) > 0);
+      if (skipCallSite (dsaCS))
+	continue;
+      
+      // -- caller not reachable from the entry points
+      if (m_graphs.count (caller) == 0)
+	continue;
+      
       assert (m_graphs.count (callee) > 0);
       
       Graph &callerG = *(m_graphs.find (caller)->second);
       Graph &calleeG = *(m_graphs.find (callee)->second);
       
+      if (profile) profile->recordDequeue (I);
+      
       // -- find out which propagation is needed if any
-      auto propKind = decidePropagation  (dsaCS, calleeG, callerG);
+      PropagationKind propKind;
+      {
+	FixpointProfile::Scope scope (FIXPOINT_DECIDE, I);
+	propKind = decidePropagation  (dsaCS, calleeG, callerG);
+      }
       if (propKind == DOWN) {
-	propagateTopDown (dsaCS, callerG, calleeG); 
-          td_props++;
-          auto &calleeU = dsaCG.getUses (*callee);
-          auto &calleeD = dsaCG.getDefs (*callee);
-          for (auto ci: calleeU) w.enqueue(ci); // they might need bottom-up
-          for (auto ci: calleeD) w.enqueue(ci); // they might need top-down
+	{
+	  FixpointProfile::Scope scope (FIXPOINT_TOP_DOWN, I);
+	  propagateTopDown (dsaCS, callerG, calleeG); 
+	}
+	td_props++;
+	enqueueCallSites (*callee, dsaCG, w);
       } else if (propKind == UP) { 
-	propagateBottomUp (dsaCS, calleeG, callerG);
+	{
+	  FixpointProfile::Scope scope (FIXPOINT_BOTTOM_UP, I);
+	  propagateBottomUp (dsaCS, calleeG, callerG);
+	}
 	bu_props++;
-	auto &callerU = dsaCG.getUses (*caller);
-	auto &callerD = dsaCG.getDefs (*caller);
-	for (auto ci: callerU) w.enqueue(ci); // they might need bottom-up
-	for (auto ci: callerD) w.enqueue(ci); // they might need top-down
+	enqueueCallSites (*caller, dsaCG, w);
       }
     }
     
     LOG("dsa-global", 
-	errs () << "-- Number of top-down propagations=" << td_props << "\n";
-	errs () << "-- Number of bottom-up propagations=" << bu_props << "\n";);
+	logs () << "-- Number of top-down propagations=" << td_props << "\n";
+	logs () << "-- Number of bottom-up propagations=" << bu_props << "\n";);
 
     
     #ifdef SANITY_CHECKS
@@ -414,18 +646,97 @@ namespace sea_dsa {
     LOG ("dsa-global-graph", 
 	 for (auto &kv : m_graphs) 
            {
-             errs () << "### Global Dsa graph for " << kv.first->getName () << "\n";
-             kv.second->write (errs ());
-             errs () << "\n";
+             logs () << "### Global Dsa graph for " << kv.first->getName () << "\n";
+             kv.second->write (logs ());
+             logs () << "\n";
            });
     
-    LOG("dsa-global", errs () << "Finished context-sensitive global analysis\n");
+    // -- the mappers are freed with bu
+    m_mappers_memory = bu.mappersMemoryUsage ();
+    
+    LOG("dsa-global", logs () << "Finished context-sensitive global analysis\n");
     
     // ufo::Stats::stop ("CS-DsaAnalysis");          
     
     return false;
   }
   
+  void ContextSensitiveGlobalAnalysis::allocateGraphs (Module &M)
+  {
+    for (auto &F: M)
+      { 
+        if (F.isDeclaration() || F.empty() || !isReachable (F))
+          continue;
+        
+        GraphRef fGraph = std::make_shared<Graph> (m_dl, m_setFactory);
+        m_graphs[&F] = fGraph;
+      }
+  }
+  
+  // Return true if g refers to a value of a function that was edited.
+  // The key of the value in the previous run might now denote another
+  // value of the function.
+  static bool refersToEdited (const Graph &g, const BottomUpAnalysis &bu)
+  {
+    auto edited = [&bu] (const Value *v) {
+      const Function *fn = nullptr;
+      if (const Argument *a = dyn_cast<Argument> (v))
+	fn = a->getParent ();
+      else if (const Instruction *I = dyn_cast<Instruction> (v))
+	fn = I->getParent ()->getParent ();
+      return fn && bu.isEdited (*fn);
+    };
+    
+    for (const Node &n : g)
+      {
+	if (n.getUniqueScalar () && edited (n.getUniqueScalar ()))
+	  return true;
+	for (const Value *v : n.getAllocSites ())
+	  if (edited (v)) return true;
+      }
+    return false;
+  }
+  
+  // A function whose bottom-up graph was not recomputed did not
+  // change and neither did its callees, transitively. Its previous
+  // final graph is reused and the fixpoint only propagates through
+  // its callsites that cross to recomputed functions. A reused graph
+  // keeps what the previous versions of its callers propagated to it
+  // so it can be less precise than after a full run.
+  void ContextSensitiveGlobalAnalysis::
+  reuseGraphs (Module &M, const BottomUpAnalysis &bu,
+	       boost::container::flat_set<const Function*> &reused)
+  {
+    assert (m_cache);
+    
+    unsigned numGraphs = 0;
+    for (auto &F: M)
+      {
+	if (!m_graphs.count (&F)) continue;
+	++numGraphs;
+	if (bu.isRecomputed (F)) continue;
+	
+	GraphRef g = m_cache->getGraph (F, bu.getHash (F));
+	if (!g || refersToEdited (*g, bu)) continue;
+	m_graphs [&F] = g;
+	reused.insert (&F);
+      }
+    
+    LOG ("dsa-global",
+	 logs () << "Reused " << reused.size () << " out of "
+	         << numGraphs << " graphs from the previous run\n";);
+  }
+  
+  void ContextSensitiveGlobalAnalysis::
+  enqueueCallSites (const Function &fn, DsaCallGraph &dsaCG,
+		    WorkList<const Instruction*> &w)
+  {
+    auto &uses = dsaCG.getUses (fn);
+    auto &defs = dsaCG.getDefs (fn);
+    for (auto ci: uses) w.enqueue(ci); // they might need bottom-up
+    for (auto ci: defs) w.enqueue(ci); // they might need top-down
+  }
+  
   // Perform some sanity checks:
   // 1) each callee node can be simulated by its corresponding caller node.
   // 2) no two callee nodes are mapped to the same caller node.
@@ -443,16 +754,19 @@ namespace sea_dsa {
 	  
 	  const Function *callee = cs.getCallee ();
 	  if (!callee || callee->isDeclaration () || callee->empty ()) continue;
+	  if (m_graphs.count (cs.getCaller ()) == 0) continue;
 	  
 	  assert (m_graphs.count (cs.getCaller ()) > 0);
 	  assert (m_graphs.count (cs.getCallee ()) > 0);
 	  
+	  if (skipCallSite (cs)) continue;
+	  
 	  Graph &callerG = *(m_graphs.find (cs.getCaller())->second);
 	  Graph &calleeG = *(m_graphs.find (cs.getCallee())->second);
 	  PropagationKind pkind = decidePropagation (cs, calleeG, callerG);
 	  if (pkind != NONE) {
 	    auto pkind_str = (pkind==UP)? "bottom-up": "top-down";
-	    errs () << "ERROR sanity check failed:" 
+	    diags () << "ERROR sanity check failed:" 
 		    << *(cs.getInstruction ()) << " requires " 
 		    << pkind_str << " propagation.\n";
 	    return false;
@@ -460,7 +774,7 @@ namespace sea_dsa {
 	}
       }
     }
-    errs () << "Sanity check succeed: global propagation completed!\n";
+    diags () << "Sanity check succeed: global propagation completed!\n";
     return true;
   }
   
@@ -499,6 +813,180 @@ namespace sea_dsa {
   }
 } // end namespace
 
+/// HYBRID DSA
+namespace sea_dsa {
+
+  bool HybridPolicy::isContextInsensitive (const SccSummary &scc) const
+  {
+    return ((m_max_scc_size > 0 && scc.m_num_functions > m_max_scc_size) ||
+	    (m_max_callsites > 0 && scc.m_num_callsites > m_max_callsites) ||
+	    (m_max_graph_size > 0 && scc.m_graph_size > m_max_graph_size));
+  }
+  
+  std::unique_ptr<HybridPolicy> createHybridPolicy ()
+  {
+    return std::unique_ptr<HybridPolicy> (new HybridPolicy (HybridMaxSccSize,
+							    HybridMaxCallSites,
+							    HybridMaxGraphSize));
+  }
+  
+  void HybridGlobalAnalysis::allocateGraphs (Module &M)
+  {
+    typedef std::vector<CallGraphNode*> CallGraphNodeVector;
+    
+    // -- collect the SCCs of the call graph
+    std::vector<CallGraphNodeVector> sccs;
+    DenseMap<const Function*, unsigned> sccOf;
+    for (auto it = scc_begin (&m_cg); !it.isAtEnd (); ++it)
+      {
+	CallGraphNodeVector scc;
+	for (CallGraphNode *cgn : *it)
+	  {
+	    Function *fn = cgn->getFunction ();
+	    if (!fn || fn->isDeclaration () || fn->empty ()) continue;
+	    if (!isReachable (*fn)) continue;
+	    sccOf [fn] = sccs.size ();
+	    scc.push_back (cgn);
+	  }
+	if (!scc.empty ()) sccs.push_back (scc);
+      }
+    
+    // -- summarize each SCC and collect the callers of each SCC
+    std::vector<SccSummary> summaries (sccs.size ());
+    std::vector<std::vector<unsigned> > callers (sccs.size ());
+    for (unsigned i = 0, e = sccs.size (); i < e; ++i)
+      {
+	SccSummary &sum = summaries [i];
+	for (CallGraphNode *cgn : sccs [i])
+	  {
+	    const Function &fn = *cgn->getFunction ();
+	    sum.m_num_functions++;
+	    
+	    for (const Argument &a : fn.args ())
+	      if (a.getType ()->isPointerTy ()) sum.m_graph_size++;
+	    for (const_inst_iterator I = inst_begin (fn), E = inst_end (fn); I != E; ++I)
+	      if (I->getType ()->isPointerTy ()) sum.m_graph_size++;
+	    
+	    for (auto &callRecord : *cgn)
+	      {
+		ImmutableCallSite CS (callRecord.first);
+		DsaCallSite dsaCS (CS);
+		const Function *callee = dsaCS.getCallee ();
+		if (!callee || callee->isDeclaration () || callee->empty ()) continue;
+		sum.m_num_callsites++;
+		
+		unsigned calleeScc = sccOf [callee];
+		if (calleeScc != i) callers [calleeScc].push_back (i);
+	      }
+	  }
+      }
+    
+    // -- a selected SCC is grouped together with its direct callers
+    std::vector<unsigned> groups (sccs.size ());
+    std::vector<bool> selected (sccs.size (), false);
+    for (unsigned i = 0, e = sccs.size (); i < e; ++i) groups [i] = i;
+    
+    for (unsigned i = 0, e = sccs.size (); i < e; ++i)
+      {
+	if (!m_policy->isContextInsensitive (summaries [i])) continue;
+	
+	LOG ("dsa-hybrid",
+	     logs () << "Context-insensitive SCC with "
+	             << summaries [i].m_num_functions << " functions, "
+	             << summaries [i].m_num_callsites << " callsites and "
+	             << summaries [i].m_graph_size << " pointers:";
+	     for (CallGraphNode *cgn : sccs [i])
+	       logs () << " " << cgn->getFunction ()->getName ();
+	     logs () << "\n";);
+	
+	selected [i] = true;
+	for (unsigned j : callers [i])
+	  groups [findGroup (groups, j)] = findGroup (groups, i);
+      }
+    
+    for (unsigned i = 0, e = sccs.size (); i < e; ++i)
+      if (selected [i]) selected [findGroup (groups, i)] = true;
+    
+    // -- allocate one graph per group and one graph per function
+    // -- elsewhere
+    DenseMap<unsigned, GraphRef> groupGraphs;
+    for (unsigned i = 0, e = sccs.size (); i < e; ++i)
+      {
+	unsigned g = findGroup (groups, i);
+	for (CallGraphNode *cgn : sccs [i])
+	  {
+	    const Function *fn = cgn->getFunction ();
+	    if (!selected [g])
+	      {
+		m_graphs [fn] = std::make_shared<Graph> (m_dl, m_setFactory);
+		continue;
+	      }
+	    
+	    GraphRef &gGraph = groupGraphs [g];
+	    if (!gGraph) gGraph = std::make_shared<Graph> (m_dl, m_setFactory);
+	    m_graphs [fn] = gGraph;
+	    m_groups [&*gGraph].push_back (fn);
+	    m_ci_fns.insert (fn);
+	  }
+      }
+  }
+  
+  bool HybridGlobalAnalysis::skipCallSite (const DsaCallSite &cs) const
+  {
+    const Function *caller = cs.getCaller ();
+    const Function *callee = cs.getCallee ();
+    if (!isContextInsensitive (*caller) || !isContextInsensitive (*callee))
+      return false;
+    
+    return &getGraph (*caller) == &getGraph (*callee);
+  }
+  
+  void HybridGlobalAnalysis::
+  enqueueCallSites (const Function &fn, DsaCallGraph &dsaCG,
+		    WorkList<const Instruction*> &w)
+  {
+    if (!isContextInsensitive (fn))
+      {
+	ContextSensitiveGlobalAnalysis::enqueueCallSites (fn, dsaCG, w);
+	return;
+      }
+    
+    // -- the graph is shared by the whole group 
+    auto it = m_groups.find (&getGraph (fn));
+    assert (it != m_groups.end ());
+    
+    // -- uses and defs are shared by the functions of the same SCC
+    std::set<const void*> seen;
+    for (const Function *member : it->second)
+      if (seen.insert (&dsaCG.getUses (*member)).second)
+	ContextSensitiveGlobalAnalysis::enqueueCallSites (*member, dsaCG, w);
+  }
+  
+  /// LLVM pass
+  
+  HybridGlobal::HybridGlobal () 
+    : DsaGlobalPass (ID), m_ga (nullptr) {}
+  
+  void HybridGlobal::getAnalysisUsage (AnalysisUsage &AU) const 
+  {
+    AU.addRequired<DataLayoutPass> ();
+    AU.addRequired<TargetLibraryInfo> ();
+    AU.addRequired<CallGraphWrapperPass> ();
+    AU.setPreservesAll ();
+  }
+  
+  bool HybridGlobal::runOnModule (Module &M)
+  {
+    auto &dl = getAnalysis<DataLayoutPass>().getDataLayout ();
+    auto &tli = getAnalysis<TargetLibraryInfo> ();
+    auto &cg = getAnalysis<CallGraphWrapperPass> ().getCallGraph ();
+    
+    m_ga.reset (new HybridGlobalAnalysis (dl, tli, cg, m_setFactory,
+					  createHybridPolicy ()));
+    return m_ga->runOnModule (M);
+  }
+} // end namespace
+
 namespace sea_dsa {
 
   // propagate unique scalars across callsites
@@ -643,9 +1131,13 @@ char sea_dsa::ContextInsensitiveGlobal::ID = 0;
 
 char sea_dsa::ContextSensitiveGlobal::ID = 0;
 
+char sea_dsa::HybridGlobal::ID = 0;
+
 static llvm::RegisterPass<sea_dsa::ContextInsensitiveGlobal> 
 X ("sea-dsa-ci-global", "Context-insensitive Dsa analysis");
 
 static llvm::RegisterPass<sea_dsa::ContextSensitiveGlobal> 
 Y ("sea-dsa-cs-global", "Context-sensitive Dsa analysis");
 
+static llvm::RegisterPass<sea_dsa::HybridGlobal> 
+Z ("sea-dsa-hybrid-global", "Hybrid context-sensitive/insensitive Dsa analysis");
@@ -1,27 +1,47 @@
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/InstIterator.h"
+#include "llvm/IR/CallSite.h"
 #include "llvm/Target/TargetLibraryInfo.h"
 #include "llvm/Analysis/MemoryBuiltins.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/DenseSet.h"
 
 #include "sea_dsa/Info.hh"
+#include "sea_dsa/AllocSiteMap.hh"
 #include "sea_dsa/Graph.hh"
 #include "sea_dsa/DsaAnalysis.hh"
+#include "sea_dsa/CallSite.hh"
+#include "sea_dsa/Mapper.hh"
 #include "sea_dsa/support/Debug.h"
 
 #include <boost/tokenizer.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 
+#include <algorithm>
+#include <functional>
+
 static llvm::cl::opt<std::string>
 DsaInfoToFile("sea-dsa-info-to-file",
     llvm::cl::desc ("DSA: dump some Dsa info into a file"),
     llvm::cl::init (""),
     llvm::cl::Hidden);
 
+static llvm::cl::opt<std::string>
+DsaInfoToBinaryFile("sea-dsa-info-to-binary-file",
+    llvm::cl::desc ("DSA: write the mapping between allocation sites and nodes into a binary file"),
+    llvm::cl::init (""),
+    llvm::cl::Hidden);
+
+static llvm::cl::opt<std::string>
+DsaModRefToFile("sea-dsa-modref-to-file",
+    llvm::cl::desc ("DSA: dump the mod/ref summaries of functions and callsites into a file"),
+    llvm::cl::init (""),
+    llvm::cl::Hidden);
+
 using namespace sea_dsa;
 using namespace llvm;
 
@@ -95,18 +115,53 @@ static bool isStaticallyKnown (const DataLayout* dl,
   return false; 
 }
 
-static bool compareValues (const Value* v1, const Value* v2) {
-  if (!v1->hasName ()) {
-    errs () << "DsaInfo requires " << *v1 << " to have a name\n";
-    assert (v1->hasName ());
+// Write the nodes of each allocation site in the format described in
+// AllocSiteMap.hh. alloc_to_nodes is indexed by allocation site id.
+static bool writeAllocSiteMap (const std::string &filename,
+                               const std::vector<std::vector<unsigned> > &alloc_to_nodes) {
+  std::vector<uint32_t> sites, site_off, site_adj;
+  std::vector<std::pair<uint32_t, uint32_t> > node_site;
+  site_off.push_back (0);
+  for (unsigned site_id = 1; site_id < alloc_to_nodes.size (); ++site_id) {
+    if (alloc_to_nodes [site_id].empty ()) continue;
+    sites.push_back (site_id);
+    for (unsigned node_id: alloc_to_nodes [site_id]) {
+      site_adj.push_back (node_id);
+      node_site.push_back (std::make_pair (node_id, site_id));
+    }
+    std::sort (site_adj.begin () + site_off.back (), site_adj.end ());
+    site_off.push_back (site_adj.size ());
   }
 
-  if (!v2->hasName ()) {
-    errs () << "DsaInfo requires " << *v2 << " to have a name\n";
-    assert (v2->hasName ());
+  // -- the transposed adjacency
+  std::sort (node_site.begin (), node_site.end ());
+  std::vector<uint32_t> nodes, node_off, node_adj;
+  for (auto &kv: node_site) {
+    if (nodes.empty () || nodes.back () != kv.first) {
+      nodes.push_back (kv.first);
+      node_off.push_back (node_adj.size ());
+    }
+    node_adj.push_back (kv.second);
+  }
+  node_off.push_back (node_adj.size ());
+
+  std::error_code EC;
+  raw_fd_ostream file (filename, EC, sys::fs::F_None);
+  if (EC) {
+    diags () << "WARNING: cannot open " << filename << "\n";
+    return false;
   }
   
-  return (v1->getName () < v2->getName ());
+  AllocSiteMapHeader h;
+  memcpy (h.m_magic, AllocSiteMapHeader::magic (), sizeof (h.m_magic));
+  h.m_version = AllocSiteMapHeader::version ();
+  h.m_num_sites = sites.size ();
+  h.m_num_nodes = nodes.size ();
+  h.m_num_edges = site_adj.size ();
+  file.write (reinterpret_cast<const char*> (&h), sizeof (h));
+  for (auto *v: {&sites, &nodes, &site_off, &site_adj, &node_off, &node_adj})
+    file.write (reinterpret_cast<const char*> (v->data ()), v->size () * sizeof (uint32_t));
+  return true;
 }
 
 // return null if there is no graph for f
@@ -116,11 +171,16 @@ Graph* DsaInfo::getDsaGraph(const Function&f) const {
   return g;
 }
 
+// the graph of f held by m_handles or null
+const Graph* DsaInfo::getGraph (const Function &f) const {
+  return m_graphs.lookup (&f);
+}
+
 bool DsaInfo::is_alive_node::operator()(const NodeWrapper& n) {
   return n.getNode()->isRead() || n.getNode()->isModified();
 }
 
-void DsaInfo::recordMemAccess (const Value* v, Graph& g, const Instruction &I) {
+void DsaInfo::recordMemAccess (const Value* v, const Graph& g, const Instruction &I) {
   v = v->stripPointerCasts();
 
   if (isStaticallyKnown (&m_dl, &m_tli, v)) return;
@@ -128,7 +188,7 @@ void DsaInfo::recordMemAccess (const Value* v, Graph& g, const Instruction &I) {
   if (!g.hasCell(*v)) {
     // sanity check
     if (v->getType()->isPointerTy())
-      errs () << "WARNING DsaInfo: pointer value " << *v << " has not cell\n";
+      diags () << "WARNING DsaInfo: pointer value " << *v << " has not cell\n";
     return;
   }
 
@@ -140,12 +200,11 @@ void DsaInfo::recordMemAccess (const Value* v, Graph& g, const Instruction &I) {
   
   const Cell &c = g.getCell (*v);
   Node *n = c.getNode();
-  auto it = m_nodes_map.find (n);
-  if (it != m_nodes_map.end ()) {
-    ++(it->second);
+  if (unsigned id = getDsaNodeId (*n)) {
+    ++(m_nodes [id - 1]);
     #if 0
     if (c.getNode()->getAllocSites ().size () == 0) {
-      errs () << "WARNING: " << I.getParent ()->getParent ()->getName () << ":"
+      diags () << "WARNING: " << I.getParent ()->getParent ()->getName () << ":"
 	      << I << " has no allocation site\n";
     }
     #endif 
@@ -158,7 +217,7 @@ void DsaInfo::recordMemAccesses (const Function&F) {
   // 
   // Here we just count the number of **non-trivial** memory accesses
   // because it is useful for passes that will instrument them.
-  auto g = getDsaGraph(F);
+  auto g = getGraph (F);
   if (!g) return;
 
   for (const_inst_iterator i = inst_begin(F), e = inst_end(F); i != e; ++i)  
@@ -178,307 +237,402 @@ void DsaInfo::recordMemAccesses (const Function&F) {
 }
       
 bool DsaInfo::recordAllocSite (const Value* v, unsigned &site_id) {
-  auto it = m_alloc_sites_bimap.left.find (v);
-  if (it == m_alloc_sites_bimap.left.end ()) {
-    site_id = m_alloc_sites_bimap.size () + 1;
-    m_alloc_sites_bimap.insert (typename AllocSiteBiMap::value_type (v, site_id));
-    m_alloc_sites_set.insert (site_id);
-    return true;
-  } else {
-    site_id = it->second;
-    return false;
+  auto res = m_alloc_site_ids.insert (std::make_pair (v, m_alloc_values.size () + 1));
+  site_id = res.first->second;
+  if (res.second) {
+    m_alloc_values.push_back (v);
+    // -- ids are increasing so this is an append
+    m_alloc_sites_set.insert (m_alloc_sites_set.end (), site_id);
   }
+  return res.second;
 }
 
-void DsaInfo::assignAllocSiteId () {
-  auto nodes = live_nodes ();
+void DsaInfo::assignAllocSiteId (const Module &M) {
+  // -- allocation sites of the live nodes
+  DenseSet<const Value*> sites;
+  for (const NodeWrapper &n: live_nodes ())
+    for (const Value *v: n.getNode ()->getAllocSites ())
+      sites.insert (v);
   
-  /// XXX: sort nodes by id's to achieve determinism across different
-  /// executions.
-  std::vector<NodeWrapper> nodes_sorted;
-  for (auto n: nodes) { nodes_sorted.push_back (n);} 
-  std::sort (nodes_sorted.begin(), nodes_sorted.end());
-
-
-  // map each allocation site to a set of nodes
-  DenseMap<const llvm::Value*, std::pair<unsigned, NodeWrapperSet> > alloc_to_nodes_map;
-  
-  // iterate over all sorted nodes
-  for (const auto &n: nodes_sorted) {
-    /// XXX: sort alloca sites by name to achieve determinism across
-    /// different executions.
-    
-    // iterate over all allocation sites
-    auto &n_alloca_sites = n.getNode ()->getAllocSites ();
-    std::vector<const llvm::Value*> n_alloca_sites_sorted (n_alloca_sites.begin(),
-							   n_alloca_sites.end());
-    std::sort (n_alloca_sites_sorted.begin(),
-	       n_alloca_sites_sorted.end(), compareValues);
-    
-    for (const llvm::Value*v : n_alloca_sites_sorted) {
-      // assign a unique id to the allocation site for Dsa clients
-      unsigned site_id;
-      recordAllocSite (v, site_id);
-
-      auto it = alloc_to_nodes_map.find (v);
-      if (it != alloc_to_nodes_map.end())
-        it->second.second.insert(n);
-      else 
-      {
-        NodeWrapperSet s;
-        s.insert(n);
-        alloc_to_nodes_map.insert(std::make_pair(v, 
-                                                 std::make_pair(site_id, s)));
+  // -- assign ids following the order of the module: global
+  //    variables, functions, aliases, and then the arguments and
+  //    instructions of each function
+  auto visit = [&] (const Value &v) {
+    unsigned site_id;
+    if (sites.erase (&v)) recordAllocSite (&v, site_id);
+  };
+  for (auto it = M.global_begin (), et = M.global_end (); it != et; ++it)
+    visit (*it);
+  for (auto &f: M) visit (f);
+  for (auto it = M.alias_begin (), et = M.alias_end (); it != et; ++it)
+    visit (*it);
+  for (auto &f: M) {
+    for (auto it = f.arg_begin (), et = f.arg_end (); it != et; ++it)
+      visit (*it);
+    for (const_inst_iterator it = inst_begin (f), et = inst_end (f); it != et; ++it)
+      visit (*it);
+  }
+  // -- any other allocation site is a constant expression: visit the
+  //    constants reachable from the initializers and the operands in
+  //    the same order
+  if (!sites.empty ()) {
+    DenseSet<const Constant*> seen;
+    std::function<void (const Value&)> visitConstants = [&] (const Value &v) {
+      for (const Use &u: cast<User> (v).operands ()) {
+        const Constant *c = dyn_cast<Constant> (u.get ());
+        if (!c || isa<GlobalValue> (c) || !seen.insert (c).second) continue;
+        visit (*c);
+        visitConstants (*c);
       }
-      
-    }
+    };
+    for (auto it = M.global_begin (), et = M.global_end (); it != et; ++it)
+      visitConstants (*it);
+    for (auto it = M.alias_begin (), et = M.alias_end (); it != et; ++it)
+      visitConstants (*it);
+    for (auto &f: M)
+      for (const_inst_iterator it = inst_begin (f), et = inst_end (f);
+           it != et && !sites.empty (); ++it)
+        visitConstants (*it);
   }
+  // -- sites not used by the module (if any) in the order of the
+  //    live nodes
+  for (const NodeWrapper &n: live_nodes ())
+    for (const Value *v: n.getNode ()->getAllocSites ())
+      visit (*v);
+  
+  // map each allocation site id to its nodes
+  std::vector<std::vector<unsigned> > alloc_to_nodes (m_alloc_values.size () + 1);
+  for (const NodeWrapper &n: live_nodes ())
+    for (const Value *v: n.getNode ()->getAllocSites ())
+      alloc_to_nodes [getAllocSiteId (v)].push_back (n.getId ());
   
   // --- write to a file all pairs (alloc site, node id)
-  if (DsaInfoToFile != "") {
-    std::string filename (DsaInfoToFile);
+  std::string filename (m_info_file);
+  if (filename.empty ()) filename = DsaInfoToFile;
+  if (filename != "") {
     std::error_code EC;
     raw_fd_ostream file (filename, EC, sys::fs::F_Text);
     file << "alloc_site,ds_node\n";
-    for (auto &kv: alloc_to_nodes_map)
-      for (const auto &nodeInfo: kv.second.second)
-        file <<  kv.second.first << "," << nodeInfo.getId () << "\n";
+    for (unsigned site_id = 1; site_id < alloc_to_nodes.size (); ++site_id)
+      for (unsigned node_id: alloc_to_nodes [site_id])
+        file <<  site_id << "," << node_id << "\n";
     file.close();
   }
+  
+  if (DsaInfoToBinaryFile != "")
+    writeAllocSiteMap (DsaInfoToBinaryFile, alloc_to_nodes);
 
   // --- print for each allocation site the set of nodes
   LOG("sea-dsa-info-alloc-sites",
-       for (auto &kv: alloc_to_nodes_map) {
-         errs () << "\t  [Alloc site Id " << kv.second.first << " DSNode Ids {";
+       for (unsigned site_id = 1; site_id < alloc_to_nodes.size (); ++site_id) {
+         logs () << "\t  [Alloc site Id " << site_id << " DSNode Ids {";
          bool first = true;
-         for (typename NodeWrapperSet::iterator it = kv.second.second.begin(),
-                  et = kv.second.second.end(); it != et; ) {
-           if (!first) errs() << ",";
+         for (unsigned node_id: alloc_to_nodes [site_id]) {
+           if (!first) logs() << ",";
            else first = false;
-           errs () << it->getId ();
-           ++it;
+           logs () << node_id;
          }
-         errs () << "}]  " << *(kv.first) << "\n";
+         logs () << "}]  " << *getAllocValue (site_id) << "\n";
        });
-
-  // // --- print for each node the types of its allocation sites
-  // LOG("sea-dsa-info-alloc-types",
-  //     for (const auto &n: nodes)  {
-  // 	SmallPtrSet<Type*, 32> allocTypes;
-  // 	for (const llvm::Value*v : n.getNode ()->getAllocSites ())
-  // 	  allocTypes.insert(v->getType());
-  // 	if (allocTypes.size () > 1) {
-  // 	  n.getNode()->write(o);
-  // 	  errs() << "\nTypes of the node's allocation sites\n";
-  // 	  for (auto ty : allocTypes) 
-  // 	    errs() << "\t" << *ty << "\n";
-  // 	}
-  //     });
 }
  
-template <typename PairRange, typename SetMap>
-inline void InsertReferrer (PairRange r, SetMap &m) {
-  for (auto &kv: r)
-  {
-    const Node *n = kv.second->getNode ();
-    if (!(n->isRead () || n->isModified ())) continue;
-    
-    auto it = m.find (n);
-    if (it != m.end ())
-      it->second.insert (kv.first);
-    else
-    {
-      typename SetMap::mapped_type s;
-      s.insert (kv.first);
-      m.insert(std::make_pair (n, s));
-    }
+// Return the id of n, assigning the next id if n has none yet
+unsigned DsaInfo::recordNode (const Node* n) {
+  unsigned &id = m_node_ids [n];
+  if (id == 0) {
+    m_nodes.push_back (NodeWrapper (n, m_nodes.size () + 1));
+    id = m_nodes.size ();
   }
+  return id;
 }
 
-// Assign a unique name to a value for the whole module
-std::string DsaInfo::getName (const Function&fn, const Value& v) {
-  assert (v.hasName ());
-  const Value * V = v.stripPointerCasts();
-  
-  auto it = m_names.find (V);
-  if (it != m_names.end ()) return it->second;
-
-  std::string name = fn.getName ().str() + "." + v.getName ().str();
-  auto res = m_names.insert (std::make_pair (V, name));
-  return res.first->second;
-
-  // if (V->hasName ()) return V->getName().str();
-  // auto it = m_names.find (V);
-  // if (it != m_names.end ()) return it->second;
-  // // FIXME: this can be really slow!
-  // // XXX: I don't know a better way to obtain a string-like
-  // // representation from a value.
-  // std::string str("");
-  // raw_string_ostream str_os (str);
-  // V->print (str_os); 
-  // auto res = m_names.insert (std::make_pair (V, str_os.str ()));
-  // return res.first->second;
-}
-
-
 // Assign to each node a **deterministic** id that is preserved across
-// different executions
-void DsaInfo::assignNodeId (const Function& fn, Graph* g) {
-  #if 1
-  /// XXX: Assume class Node already assigns a global id to each node
-
-  for (auto &kv: boost::make_iterator_range (g->scalar_begin(), 
-                                             g->scalar_end())) 
-  {
-    const Node *n = kv.second->getNode ();
-    m_nodes_map.insert(std::make_pair(n,NodeWrapper(n, n->getId(), "")));
-  }                                   
-                                      
-  for (auto &kv: boost::make_iterator_range (g->formal_begin(), 
-                                             g->formal_end())) 
-  {
-    const Node *n = kv.second->getNode ();
-    m_nodes_map.insert(std::make_pair(n,NodeWrapper(n, n->getId(), "")));
-  }                                   
-
-  for (auto &kv: boost::make_iterator_range (g->return_begin(), 
-                                             g->return_end())) 
-  {
-    const Node *n = kv.second->getNode ();
-    m_nodes_map.insert(std::make_pair(n,NodeWrapper(n, n->getId(), "")));
-  }                                   
-                                               
-  #else
-  /// XXX: Try to build a global id from the name of a node's
-  /// representative. The representative is chosen deterministically.
-
-  typedef boost::unordered_map<const Node*, ValueSet  > ReferrerMap;
-  typedef std::vector<std::pair<const Node*, std::string> > ReferrerRepVector;
-
-  ReferrerMap ref_map;
-  ReferrerRepVector sorted_ref_vector;
-
-  // Build referrers for each node
-  InsertReferrer (boost::make_iterator_range (g->scalar_begin(), 
-                                              g->scalar_end()), ref_map);
-  InsertReferrer (boost::make_iterator_range (g->formal_begin(), 
-                                              g->formal_end()), ref_map);
-  InsertReferrer (boost::make_iterator_range (g->return_begin(), 
-                                              g->return_end()), ref_map);
-
-  // Find *deterministically* a representative for each node from its
-  // set of referrers
-  for (auto &kv: ref_map)
-  {
-    const Node * n = kv.first;
-    const ValueSet& refs = kv.second;
-
-    // Transform addresses to strings 
-    // XXX: StringRef does not own the string data so we cannot use here
-    std::vector<std::string> named_refs;
-    named_refs.reserve (refs.size ());
-    for (auto v: refs) 
-      if (v->hasName ()) 
-      {
-        /// XXX: constant expressions won't have names
-        named_refs.push_back (getName (fn, *v));
-      }
-      
-    // Sort strings
-    std::sort (named_refs.begin (), named_refs.end ());
-
-    // Choose the first one
-    if (!named_refs.empty ()) 
-      sorted_ref_vector.push_back(std::make_pair(n, named_refs [0]));
-    else
-      errs () << "WARNING DsaInfo: not found representative for node\n";
+// different executions. Nodes are numbered in the order in which
+// they are first pointed to by the global variables, the arguments,
+// the instructions and the return of fn. Nodes only reachable
+// through other nodes are numbered by runOnModule.
+void DsaInfo::assignNodeId (const Function& fn, const Graph* g) {
+  // -- global variables, once per graph. Cells of globals are looked
+  //    up in the graph since getCell would create them.
+  if (m_seen_graphs.insert (g).second) {
+    DenseMap<const Value*, const Cell*> globals;
+    for (auto &kv: boost::make_iterator_range (g->globals_begin(), 
+                                               g->globals_end()))
+      globals [kv.first] = &*kv.second;
+    
+    const Module &M = *fn.getParent ();
+    for (auto it = M.global_begin (), et = M.global_end (); it != et; ++it) {
+      auto git = globals.find (&*it);
+      if (git != globals.end ()) recordNode (git->second->getNode ());
+    }
   }
 
-  if (sorted_ref_vector.empty()) return;
-
-  // Sort nodes 
-  unsigned num_ref = sorted_ref_vector.size ();
-  std::sort (sorted_ref_vector.begin (), sorted_ref_vector.end (),
-             [](std::pair<const Node*, std::string> p1, 
-                std::pair<const Node*, std::string> p2){
-               return (p1.second < p2.second);
-             });
-
-  if (sorted_ref_vector.size () != num_ref)
-    errs () << "WARNING DsaInfo: node representatives should be unique\n";
+  for (auto it = fn.arg_begin (), et = fn.arg_end (); it != et; ++it)
+    if (g->hasCell (*it)) recordNode (g->getCell (*it).getNode ());
+  
+  for (const_inst_iterator it = inst_begin (fn), et = inst_end (fn); it != et; ++it)
+    if (!isa<GlobalValue> (it->stripPointerCasts ()) && g->hasCell (*it))
+      recordNode (g->getCell (*it).getNode ());
   
-  // -- Finally, assign a unique (deterministic) id to each node
-  //    The id 0 is reserved in case some query goes wrong.
-  for (auto &kv: sorted_ref_vector)
-    m_nodes_map.insert(std::make_pair(kv.first, 
-                                      NodeWrapper(kv.first, 
-						  m_nodes_map.size()+1,
-						  kv.second)));
-  #endif 
+  if (g->hasRetCell (fn)) recordNode (g->getRetCell (fn).getNode ());
 }
 
 bool DsaInfo::runOnFunction (Function &f) {
   if (f.isDeclaration ()) return false;
   
-  if (Graph* g = getDsaGraph(f)) {
+  if (const Graph* g = getGraph (f)) {
     LOG ("dsa-info",
-         errs () << f.getName () 
+         logs () << f.getName () 
                  << " has " << std::distance (g->begin(), g->end()) << " nodes\n");
 
-    // XXX: If the analysis is context-insensitive all functions have
-    // the same graph so we just need to compute the id's for the
-    // first graph.
-    if (m_seen_graphs.count (g) <= 0)
-      assignNodeId (f, g); 
+    assignNodeId (f, g); 
 
     recordMemAccesses (f);
-  } else {
-    errs () << "WARNING: " << f.getName () << " has not Dsa graph\n";
   }
   return false;
 }
 
 bool DsaInfo::runOnModule (Module &M) {
-
+  // -- nodes and graphs are kept by address: their graphs stay in
+  //    memory as long as DsaInfo
+  for (auto &f: M)
+    if (!f.isDeclaration () && m_dsa.hasGraph (f)) {
+      m_handles.push_back (m_dsa.getGraphHandle (f));
+      m_graphs [&f] = m_handles.back ().get ();
+    }
+  
+  // -- functions without a graph (e.g., not reachable from the
+  //    entry point) are skipped
+  unsigned noGraph = 0;
   for (auto &f: M) {
+    if (!f.isDeclaration () && !m_dsa.hasGraph (f)) ++noGraph;
     runOnFunction (f); 
   }
-  assignAllocSiteId();
+  LOG ("dsa-info",
+       if (noGraph > 0)
+         logs () << noGraph << " functions have no Dsa graph\n");
+  // -- nodes only reachable through other nodes (e.g., modified by
+  //    a callee) in the order of their graph
+  for (auto &f: M)
+    if (const Graph *g = getGraph (f))
+      for (const Node &n: *g) recordNode (&n);
+  
+  assignAllocSiteId(M);
+  computeModRef (M);
+  
+  if (DsaModRefToFile != "") {
+    std::error_code EC;
+    raw_fd_ostream file (DsaModRefToFile, EC, sys::fs::F_Text);
+    if (EC)
+      diags () << "WARNING: cannot open " << DsaModRefToFile << "\n";
+    else
+      writeModRef (M, file);
+  }
   return false;
 }
 
+// Compute once the nodes read and modified by each function and
+// callsite so that clients do not need to map callee nodes to caller
+// nodes themselves.
+void DsaInfo::computeModRef (Module &M) {
+  // -- functions: the flags of a node already include the accesses
+  //    made by the callees
+  for (auto &f: M) {
+    const Graph *g = getGraph (f);
+    if (!g || m_graph_modref.count (g) > 0) continue;
+    
+    ModRef mr;
+    unsigned size = 0;
+    for (const Node &n : *g) m_node_index [&n] = size++;
+    mr.m_ref.resize (size);
+    mr.m_mod.resize (size);
+    for (const Node &n : *g) {
+      unsigned i = m_node_index [&n];
+      if (n.isRead ()) mr.m_ref.set (i);
+      if (n.isModified ()) mr.m_mod.set (i);
+    }
+    m_graph_modref [g] = mr;
+  }
+  
+  // -- callsites: the accessed nodes of the callee mapped to the
+  //    caller graph
+  for (auto &f: M) {
+    const Graph *callerG = getGraph (f);
+    if (!callerG) continue;
+    
+    for (const_inst_iterator it = inst_begin (f), et = inst_end (f); it != et; ++it) {
+      const Instruction *I = &*it;
+      if (!isa<CallInst> (I) && !isa<InvokeInst> (I)) continue;
+      if (const CallInst *CI = dyn_cast<CallInst> (I))
+	if (CI->isInlineAsm ()) continue;
+      
+      ImmutableCallSite CS (I);
+      DsaCallSite dsaCS (CS);
+      const Function *callee = dsaCS.getCallee ();
+      if (!callee) continue;
+      const Graph *calleeG = getGraph (*callee);
+      if (!calleeG) continue;
+      
+      const ModRef &calleeMR = m_graph_modref.find (calleeG)->second;
+      // -- same graph (context-insensitive or same SCC)
+      if (calleeG == callerG) {
+	m_cs_modref [I] = calleeMR;
+	continue;
+      }
+      
+      // -- the graphs might be frozen: the mapping must not add cells
+      SimulationMapper sm;
+      if (!Graph::computeCalleeCallerMapping (dsaCS, *calleeG, *callerG, sm, false))
+	continue;
+      
+      ModRef mr;
+      unsigned size = m_graph_modref.find (callerG)->second.m_ref.size ();
+      mr.m_ref.resize (size);
+      mr.m_mod.resize (size);
+      for (const Node &n : *calleeG) {
+	unsigned i = m_node_index [&n];
+	bool ref = calleeMR.m_ref.test (i);
+	bool mod = calleeMR.m_mod.test (i);
+	if (!ref && !mod) continue;
+	
+	// -- nodes not mapped are local to the callee
+	Cell c = sm.get (n);
+	if (c.isNull ()) continue;
+	auto ci = m_node_index.find (c.getNode ());
+	if (ci == m_node_index.end ()) continue;
+	if (ref) mr.m_ref.set (ci->second);
+	if (mod) mr.m_mod.set (ci->second);
+      }
+      m_cs_modref [I] = mr;
+    }
+  }
+}
+
+void DsaInfo::writeModRef (const Module &M, raw_ostream &o) const {
+  auto writeSet = [&] (const Graph &g, const BitVector &bv) {
+    bool first = true;
+    for (const Node &n : g) {
+      auto it = m_node_index.find (&n);
+      if (it == m_node_index.end () || !bv.test (it->second)) continue;
+      if (!first) o << " ";
+      first = false;
+      o << getDsaNodeId (n);
+    }
+  };
+  
+  o << "kind,name,ref,mod\n";
+  for (auto &f: M) {
+    const Graph *g = getGraph (f);
+    const ModRef *mr = getModRef (f);
+    if (!g || !mr) continue;
+    
+    o << "function," << f.getName () << ",";
+    writeSet (*g, mr->m_ref);
+    o << ",";
+    writeSet (*g, mr->m_mod);
+    o << "\n";
+    
+    // -- callsites are named by their position in the function
+    unsigned pos = 0;
+    for (const_inst_iterator it = inst_begin (f), et = inst_end (f); it != et; ++it) {
+      if (!isa<CallInst> (&*it) && !isa<InvokeInst> (&*it)) continue;
+      pos++;
+      const ModRef *cmr = getModRef (*it);
+      if (!cmr) continue;
+      o << "callsite," << f.getName () << ":" << pos << ",";
+      writeSet (*g, cmr->m_ref);
+      o << ",";
+      writeSet (*g, cmr->m_mod);
+      o << "\n";
+    }
+  }
+}
+
 ///////////////////////////////////////////////////////////
 // External API for Dsa clients
 ///////////////////////////////////////////////////////////
 
 bool DsaInfo::isAccessed (const Node&n) const {
-  auto it = m_nodes_map.find (&n);
-  if (it != m_nodes_map.end ())
-    return (it->second.getAccesses () > 0);
+  if (unsigned id = getDsaNodeId (n))
+    return (m_nodes [id - 1].getAccesses () > 0);
   else
     return false; // not found
 }
 
+const DsaInfo::ModRef *DsaInfo::getModRef (const Function &fn) const {
+  const Graph *g = getGraph (fn);
+  if (!g) return nullptr;
+  auto it = m_graph_modref.find (g);
+  return it != m_graph_modref.end () ? &it->second : nullptr;
+}
+
+const DsaInfo::ModRef *DsaInfo::getModRef (const Instruction &cs) const {
+  auto it = m_cs_modref.find (&cs);
+  return it != m_cs_modref.end () ? &it->second : nullptr;
+}
+
+bool DsaInfo::test (const ModRef *mr, const Node &n, bool mod) const {
+  if (!mr) return false;
+  auto it = m_node_index.find (&n);
+  if (it == m_node_index.end ()) return false;
+  const BitVector &bv = mod ? mr->m_mod : mr->m_ref;
+  return it->second < bv.size () && bv.test (it->second);
+}
+
+bool DsaInfo::isRef (const Function &fn, const Node &n) const
+{ return test (getModRef (fn), n, false); }
+
+bool DsaInfo::isMod (const Function &fn, const Node &n) const
+{ return test (getModRef (fn), n, true); }
+
+bool DsaInfo::isRef (const Instruction &cs, const Node &n) const
+{ return test (getModRef (cs), n, false); }
+
+bool DsaInfo::isMod (const Instruction &cs, const Node &n) const
+{ return test (getModRef (cs), n, true); }
+
+unsigned DsaInfo::getNodeIndex (const Node &n) const
+{ return m_node_index.lookup (&n); }
+
+const BitVector *DsaInfo::getRefSet (const Function &fn) const {
+  const ModRef *mr = getModRef (fn);
+  return mr ? &mr->m_ref : nullptr;
+}
+
+const BitVector *DsaInfo::getModSet (const Function &fn) const {
+  const ModRef *mr = getModRef (fn);
+  return mr ? &mr->m_mod : nullptr;
+}
+
+const BitVector *DsaInfo::getRefSet (const Instruction &cs) const {
+  const ModRef *mr = getModRef (cs);
+  return mr ? &mr->m_ref : nullptr;
+}
+
+const BitVector *DsaInfo::getModSet (const Instruction &cs) const {
+  const ModRef *mr = getModRef (cs);
+  return mr ? &mr->m_mod : nullptr;
+}
+
 unsigned int DsaInfo::getDsaNodeId (const Node&n) const {
-  auto it = m_nodes_map.find (&n);
-  if (it != m_nodes_map.end ())
-    return it->second.getId ();
+  auto it = m_node_ids.find (&n);
+  if (it != m_node_ids.end ())
+    return it->second;
   else
     return 0; // not found
 }
 
 unsigned int DsaInfo::getAllocSiteId (const Value* V) const {
-  auto it = m_alloc_sites_bimap.left.find (V);
-  if (it != m_alloc_sites_bimap.left.end ())
+  auto it = m_alloc_site_ids.find (V);
+  if (it != m_alloc_site_ids.end ())
     return it->second;
   else
     return 0; // not found
 }
 
 const Value* DsaInfo::getAllocValue (unsigned int alloc_site_id) const {
-  auto it = m_alloc_sites_bimap.right.find (alloc_site_id);
-  if (it != m_alloc_sites_bimap.right.end ())
-    return it->second;
+  if (alloc_site_id > 0 && alloc_site_id <= m_alloc_values.size ())
+    return m_alloc_values [alloc_site_id - 1];
   else
     return nullptr; //not found
 }
@@ -496,6 +650,7 @@ bool DsaInfoPass::runOnModule (Module &M) {
   auto &dsa = getAnalysis<DsaAnalysis>();
   m_dsa_info.reset (new DsaInfo (dsa.getDataLayout (), dsa.getTLI(),
 				 dsa.getDsaAnalysis()));
+  if (!m_info_file.empty ()) m_dsa_info->setInfoFile (m_info_file);
   nameValues (M);
   m_dsa_info->runOnModule (M);
   return false;
@@ -507,10 +662,14 @@ DsaInfo& DsaInfoPass::getDsaInfo () {
 } 
 
 
-Pass *createDsaInfoPass () {
+Pass *sea_dsa::createDsaInfoPass () {
   return new sea_dsa::DsaInfoPass();
 }
 
+Pass *sea_dsa::createDsaInfoPass (const std::string &infoFile) {
+  return new sea_dsa::DsaInfoPass(infoFile);
+}
+
 char sea_dsa::DsaInfoPass::ID = 0;
 
 static llvm::RegisterPass<sea_dsa::DsaInfoPass> 
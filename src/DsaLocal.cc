@@ -16,6 +16,8 @@
 
 #include "sea_dsa/Graph.hh"
 #include "sea_dsa/Local.hh"
+#include "sea_dsa/CollapseProfile.hh"
+#include "sea_dsa/PhaseTimers.hh"
 #include "sea_dsa/support/Debug.h"
 
 #include "boost/range/algorithm/reverse.hpp"
@@ -107,7 +109,9 @@ namespace {
     sea_dsa::Graph &m_graph;
     const DataLayout &m_dl;
     const TargetLibraryInfo &m_tli;
+    sea_dsa::CanonicalValues &m_canon;
     
+    const Value &canonical (const Value &v) { return m_canon.get (v); }
     
     sea_dsa::Cell valueCell (const Value &v);
     void visitGep (const Value &gep, const Value &base, ArrayRef<Value *> indicies);
@@ -120,9 +124,9 @@ namespace {
       return false;
     }
 
-    static bool isNullConstant (const Value& v)
+    bool isNullConstant (const Value& v)
     {
-      const Value *V = v.stripPointerCasts ();
+      const Value *V = &canonical (v);
 
       if (isa<Constant> (V) && cast<Constant> (V)->isNullValue ())
         return true;
@@ -131,7 +135,7 @@ namespace {
       if (const GetElementPtrInst *Gep = dyn_cast<const GetElementPtrInst>(V))
       {
         const Value &base = *Gep->getPointerOperand ();
-        if (const Constant *c = dyn_cast<Constant>(base.stripPointerCasts ())) 
+        if (const Constant *c = dyn_cast<Constant>(&canonical (base))) 
           return c->isNullValue();
       }
       
@@ -140,8 +144,9 @@ namespace {
     
   public:
     BlockBuilderBase (Function &func, sea_dsa::Graph &graph,
-                      const DataLayout &dl, const TargetLibraryInfo &tli) :
-      m_func(func), m_graph(graph), m_dl(dl), m_tli (tli) {}
+                      const DataLayout &dl, const TargetLibraryInfo &tli,
+                      sea_dsa::CanonicalValues &canon) :
+      m_func(func), m_graph(graph), m_dl(dl), m_tli (tli), m_canon (canon) {}
   };
     
   class InterBlockBuilder : public InstVisitor<InterBlockBuilder>, BlockBuilderBase
@@ -151,8 +156,9 @@ namespace {
     void visitPHINode (PHINode &PHI);
   public:
     InterBlockBuilder (Function &func, sea_dsa::Graph &graph,
-                       const DataLayout &dl, const TargetLibraryInfo &tli) :
-      BlockBuilderBase (func, graph, dl, tli) {}
+                       const DataLayout &dl, const TargetLibraryInfo &tli,
+                       sea_dsa::CanonicalValues &canon) :
+      BlockBuilderBase (func, graph, dl, tli, canon) {}
   };
   
   void InterBlockBuilder::visitPHINode (PHINode &PHI)
@@ -205,8 +211,9 @@ namespace {
 
   public:
      IntraBlockBuilder (Function &func, sea_dsa::Graph &graph,
-                       const DataLayout &dl, const TargetLibraryInfo &tli) :
-       BlockBuilderBase (func, graph, dl, tli) {}
+                        const DataLayout &dl, const TargetLibraryInfo &tli,
+                        sea_dsa::CanonicalValues &canon) :
+       BlockBuilderBase (func, graph, dl, tli, canon) {}
   };
 
   
@@ -218,13 +225,14 @@ namespace {
     if (isNullConstant (v))
     {
       LOG ("dsa",
-           errs () << "WARNING: not handled constant: " << v << "\n";);
+           logs () << "WARNING: not handled constant: " << v << "\n";);
       return Cell();
     }
   
-    if (m_graph.hasCell (v))
+    const Value &cv = canonical (v);
+    if (m_graph.hasCanonicalCell (cv))
     {
-      Cell &c = m_graph.mkCell (v, Cell ());
+      Cell &c = m_graph.mkCanonicalCell (cv, Cell ());
       assert (!c.isNull ());
       return c;
     }
@@ -309,21 +317,23 @@ namespace {
   {
     using namespace sea_dsa;
 
+    const Value &ptr = canonical (*LI.getPointerOperand ());
+    
     // -- skip read from NULL
-    if (BlockBuilderBase::isNullConstant (*LI.getPointerOperand ()->stripPointerCasts ()))
+    if (BlockBuilderBase::isNullConstant (ptr))
       return;
 
-    if (!m_graph.hasCell (*LI.getPointerOperand ()->stripPointerCasts ()))
+    if (!m_graph.hasCanonicalCell (ptr))
     {
       /// XXX: this is very likely because the pointer operand is the
       /// result of applying one or several gep instructions starting
       /// from NULL. Note that this is undefined behavior but it
       /// occurs in ldv benchmarks.
-      if (!isa<ConstantExpr>(LI.getPointerOperand()->stripPointerCasts ()))
+      if (!isa<ConstantExpr>(&ptr))
 	return;
     }
     
-    Cell base = valueCell  (*LI.getPointerOperand ()->stripPointerCasts ());
+    Cell base = valueCell  (ptr);
     assert (!base.isNull ());
     base.addType (0, LI.getType ());
     base.setRead();
@@ -343,21 +353,23 @@ namespace {
   {
     using namespace sea_dsa;
     
+    const Value &ptr = canonical (*SI.getPointerOperand ());
+    
     // -- skip store into NULL
-    if (BlockBuilderBase::isNullConstant (*SI.getPointerOperand ()->stripPointerCasts ()))
+    if (BlockBuilderBase::isNullConstant (ptr))
       return;
 
-    if (!m_graph.hasCell (*SI.getPointerOperand ()->stripPointerCasts ()))
+    if (!m_graph.hasCanonicalCell (ptr))
     {
       /// XXX: this is very likely because the pointer operand is the
       /// result of applying one or several gep instructions starting
       /// from NULL. Note that this is undefined behavior but it
       /// occurs in ldv benchmarks.
-      if (!isa<ConstantExpr>(SI.getPointerOperand()->stripPointerCasts ()))
+      if (!isa<ConstantExpr>(&ptr))
 	return;
     }
 	      
-    Cell base = valueCell  (*SI.getPointerOperand ()->stripPointerCasts ());
+    Cell base = valueCell  (ptr);
     assert (!base.isNull ());
 
     base.setModified();
@@ -386,7 +398,7 @@ namespace {
   {
     if (isSkip (I)) return;
 
-    if (BlockBuilderBase::isNullConstant (*I.getOperand (0)->stripPointerCasts ()))
+    if (BlockBuilderBase::isNullConstant (*I.getOperand (0)))
       return;  // do nothing if null
 
     sea_dsa::Cell arg = valueCell  (*I.getOperand (0));
@@ -434,7 +446,7 @@ namespace {
           int64_t arrayIdx = ci->getSExtValue ();
           if (arrayIdx < 0)
           {
-            errs () << "WARNING: negative GEP index\n";
+            sea_dsa::diags () << "WARNING: negative GEP index\n";
             // XXX for now, give up as soon as a negative index is found
             // XXX can probably do better. Some negative indexes are positive offsets
             // XXX others are just moving between array cells
@@ -482,22 +494,23 @@ namespace {
     // -- skip NULL
     if (const LoadInst *LI = dyn_cast<LoadInst>(&ptr)) {
       /// XXX: this occurs in several ldv benchmarks
-      if (BlockBuilderBase::isNullConstant (*(LI->getPointerOperand ()->stripPointerCasts ())))
+      if (BlockBuilderBase::isNullConstant (*LI->getPointerOperand ()))
 	return;
     }
 
     assert (m_graph.hasCell (ptr) || isa<GlobalValue> (&ptr));
     
     // -- empty gep that points directly to the base
-    if (gep.stripPointerCasts () == &ptr) return;
+    const Value &cgep = canonical (gep);
+    if (&cgep == &ptr) return;
 
     sea_dsa::Cell base = valueCell (ptr);
     assert (!base.isNull ());
 
-    if (m_graph.hasCell (gep)) {
+    if (m_graph.hasCanonicalCell (cgep)) {
       // gep can have already a cell if it can be stripped to another
       // pointer different from the base.
-      if (gep.stripPointerCasts () != &gep) return;
+      if (&cgep != &gep) return;
     }
 
     assert (!m_graph.hasCell (gep));
@@ -703,13 +716,13 @@ namespace {
 
 
     if (!m_graph.hasCell (*I.getSource ())) {
-      errs () << "WARNING: source of memcopy/memmove has no cell: " 
+      sea_dsa::diags () << "WARNING: source of memcopy/memmove has no cell: " 
 	      << *I.getSource() << "\n";
       return;
     }
 
     if (!m_graph.hasCell (*I.getDest ())) {
-      errs () << "WARNING: destination of memcopy/memmove has no cell: " 
+      sea_dsa::diags () << "WARNING: destination of memcopy/memmove has no cell: " 
 	      << *I.getDest() << "\n";
       return;
     }
@@ -782,7 +795,7 @@ namespace {
     // -- mark node as an alloca node
     n.setAlloca();
     m_graph.mkCell (dest, sea_dsa::Cell (n, 0));
-    llvm::errs () << "WARNING: " << dest << " is allocating a new cell\n";
+    sea_dsa::diags () << "WARNING: " << dest << " is allocating a new cell\n";
   }
 
   void IntraBlockBuilder::visitIntToPtrInst (IntToPtrInst &I)
@@ -847,7 +860,7 @@ namespace {
     assert (m_graph.hasCell (*I.getOperand (0)));
     sea_dsa::Cell c = valueCell  (*I.getOperand (0));
     if (!c.isNull ()) {
-      llvm::errs () << "WARNING: " << I << " may be escaping.\n";
+      sea_dsa::diags () << "WARNING: " << I << " may be escaping.\n";
       c.getNode()->setPtrToInt ();
     }
   }
@@ -859,6 +872,8 @@ namespace sea_dsa {
   
   void LocalAnalysis::runOnFunction (Function &F, Graph &g)
   {
+    PhaseTimers::Scope timer (TIMER_LOCAL);
+    
     // create cells and nodes for formal arguments
     for (Argument &a : F.args ())
       if (a.getType ()->isPointerTy () && !g.hasCell (a)) {
@@ -875,12 +890,19 @@ namespace sea_dsa {
     revTopoSort (F, bbs);
     boost::reverse (bbs);
 
-    IntraBlockBuilder intraBuilder (F, g, m_dl, m_tli);
-    InterBlockBuilder interBuilder (F, g, m_dl, m_tli);
+    IntraBlockBuilder intraBuilder (F, g, m_dl, m_tli, m_canon);
+    InterBlockBuilder interBuilder (F, g, m_dl, m_tli, m_canon);
+    // -- visit instruction by instruction to attribute collapses
     for (const BasicBlock *bb : bbs)
-      intraBuilder.visit (*const_cast<BasicBlock*>(bb));
+      for (Instruction &I : *const_cast<BasicBlock*>(bb)) {
+	CollapseProfile::Scope scope (PHASE_LOCAL, &F, &I);
+	intraBuilder.visit (I);
+      }
     for (const BasicBlock *bb : bbs)
-      interBuilder.visit (*const_cast<BasicBlock*>(bb));
+      for (Instruction &I : *const_cast<BasicBlock*>(bb)) {
+	CollapseProfile::Scope scope (PHASE_LOCAL, &F, &I);
+	interBuilder.visit (I);
+      }
 
     g.compress ();
     
@@ -892,28 +914,28 @@ namespace sea_dsa {
 						   g.scalar_end())) 
 	   if (kv.second->isRead() || kv.second->isModified()) 
 	     if (kv.second->getNode ()->getAllocSites().empty ()) {
-	       errs () << "SCALAR " << *(kv.first) << "\n";
-	       errs () << "WARNING: a node has no allocation site\n";
+	       logs () << "SCALAR " << *(kv.first) << "\n";
+	       logs () << "WARNING: a node has no allocation site\n";
 	     }
 	 for (auto &kv: boost::make_iterator_range(g.formal_begin(),
 						   g.formal_end())) 
 	   if (kv.second->isRead() || kv.second->isModified()) 
 	     if (kv.second->getNode ()->getAllocSites ().empty ()) {
-	       errs () << "FORMAL " << *(kv.first) << "\n";
-	       errs () << "WARNING: a node has no allocation site\n";
+	       logs () << "FORMAL " << *(kv.first) << "\n";
+	       logs () << "WARNING: a node has no allocation site\n";
 	     }
 	 for (auto &kv: boost::make_iterator_range(g.return_begin(),
 						   g.return_end())) 
 	   if (kv.second->isRead() || kv.second->isModified()) 
 	     if (kv.second->getNode ()->getAllocSites ().empty ()) {
-	       errs () << "RETURN " << kv.first->getName() << "\n";
-	       errs () << "WARNING: a node has no allocation site\n";
+	       logs () << "RETURN " << kv.first->getName() << "\n";
+	       logs () << "WARNING: a node has no allocation site\n";
 	     }
 	 );
     
     LOG ("dsa-local-graph", 
-	 errs () << "### Local Dsa graph after " << F.getName () << "\n";
-	 g.write(errs()));
+	 logs () << "### Local Dsa graph after " << F.getName () << "\n";
+	 g.write(logs()));
     
   }
   
@@ -940,7 +962,7 @@ namespace sea_dsa {
   {
     if (F.isDeclaration () || F.empty ()) return false;
     
-    LOG("progress", errs () << "DSA: " << F.getName () << "\n";);
+    LOG("progress", logs () << "DSA: " << F.getName () << "\n";);
     
     LocalAnalysis la (*m_dl, *m_tli);
     GraphRef g = std::make_shared<Graph> (*m_dl, m_setFactory);
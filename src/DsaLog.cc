@@ -0,0 +1,189 @@
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "sea_dsa/support/Debug.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include <unistd.h>
+
+static llvm::cl::list<std::string>
+LogTags("sea-dsa-log",
+	llvm::cl::desc("DSA: enable the log of the given tags"),
+	llvm::cl::CommaSeparated,
+	llvm::cl::value_desc("TAG,..."));
+
+static llvm::cl::opt<std::string>
+LogFile("sea-dsa-log-file",
+	llvm::cl::desc("DSA: file where the log is written (default stderr)"),
+	llvm::cl::init(""),
+	llvm::cl::value_desc("FILE"));
+
+using namespace llvm;
+
+namespace sea_dsa {
+  namespace log {
+
+    namespace {
+
+      const size_t BUFFER_SIZE = 1 << 16;
+      // -- threads whose buffers are written on a signal
+      const unsigned MAX_THREADS = 256;
+
+      const std::chrono::steady_clock::time_point start =
+	std::chrono::steady_clock::now ();
+
+      std::atomic<unsigned> numThreads (0);
+      // -- order of the events across threads
+      std::atomic<uint64_t> numEvents (0);
+
+      // Events of one thread not written yet. m_size is only
+      // published once an event is fully copied so that the signal
+      // handler never reads a partial event.
+      struct ThreadBuffer {
+	unsigned m_thread;
+	std::atomic<size_t> m_size;
+	char m_data [BUFFER_SIZE];
+
+	ThreadBuffer ();
+	~ThreadBuffer ();
+	void append (const std::string &event);
+	void write ();
+      };
+
+      // -- buffers of the live threads, read by the signal handler
+      //    without locking
+      std::atomic<ThreadBuffer*> buffers [MAX_THREADS];
+
+      // -- file descriptor of the log: stderr or -sea-dsa-log-file
+      std::atomic<int> outputFd (-1);
+      // -- serializes the writes outside of the signal handler
+      std::mutex outputMutex;
+
+      // Only write(2): called from the signal handler
+      void writeFd (int fd, const char *data, size_t size) {
+	while (size > 0) {
+	  ssize_t n = ::write (fd, data, size);
+	  if (n < 0) {
+	    if (errno == EINTR) continue;
+	    return;
+	  }
+	  data += n;
+	  size -= n;
+	}
+      }
+
+      // Write the buffers of all threads before the process dies
+      void writeOnSignal (void*) {
+	int fd = outputFd.load ();
+	if (fd < 0) return;
+	for (unsigned i = 0; i < MAX_THREADS; ++i)
+	  if (ThreadBuffer *b = buffers [i].load ())
+	    writeFd (fd, b->m_data, b->m_size.load ());
+      }
+
+      int output () {
+	static std::once_flag init;
+	std::call_once (init, [] {
+	    int fd = 2;
+	    if (!LogFile.empty ()) {
+	      std::error_code EC =
+		sys::fs::openFileForWrite (LogFile, fd, sys::fs::F_Text);
+	      if (EC) {
+		errs () << "WARNING: cannot open " << LogFile << ". Logging to stderr\n";
+		fd = 2;
+	      }
+	    }
+	    outputFd.store (fd);
+	    sys::AddSignalHandler (writeOnSignal, nullptr);
+	  });
+	return outputFd.load ();
+      }
+
+      ThreadBuffer::ThreadBuffer () : m_thread (numThreads++), m_size (0) {
+	for (unsigned i = 0; i < MAX_THREADS; ++i) {
+	  ThreadBuffer *empty = nullptr;
+	  if (buffers [i].compare_exchange_strong (empty, this)) break;
+	}
+      }
+
+      ThreadBuffer::~ThreadBuffer () {
+	write ();
+	for (unsigned i = 0; i < MAX_THREADS; ++i) {
+	  ThreadBuffer *self = this;
+	  if (buffers [i].compare_exchange_strong (self, nullptr)) break;
+	}
+      }
+
+      void ThreadBuffer::append (const std::string &event) {
+	size_t size = m_size.load ();
+	if (size + event.size () > BUFFER_SIZE) {
+	  write ();
+	  size = 0;
+	}
+	if (event.size () > BUFFER_SIZE) {
+	  int fd = output ();
+	  std::lock_guard<std::mutex> lock (outputMutex);
+	  writeFd (fd, event.data (), event.size ());
+	  return;
+	}
+	std::copy (event.begin (), event.end (), m_data + size);
+	m_size.store (size + event.size ());
+      }
+
+      void ThreadBuffer::write () {
+	size_t size = m_size.load ();
+	if (size == 0) return;
+	int fd = output ();
+	{
+	  std::lock_guard<std::mutex> lock (outputMutex);
+	  writeFd (fd, m_data, size);
+	}
+	m_size.store (0);
+      }
+
+      thread_local ThreadBuffer buffer;
+    }
+
+    Tag::Tag (const char *name) : m_name (name), m_enabled (false) {
+      m_enabled = std::find (LogTags.begin (), LogTags.end (), name) != LogTags.end ();
+    }
+
+    Event::Event (const Tag &tag) : m_tag (tag), m_os (m_msg) {}
+
+    Event::~Event () {
+      auto usecs = std::chrono::duration_cast<std::chrono::microseconds>
+	(std::chrono::steady_clock::now () - start).count ();
+
+      // -- one header line per event: [tag] sequence thread time
+      std::string event;
+      raw_string_ostream o (event);
+      o << "[" << m_tag.name () << "] seq=" << numEvents++
+	<< " thread=" << buffer.m_thread
+	<< " t=" << usecs << "us\n" << m_os.str ();
+      if (!m_msg.empty () && m_msg.back () != '\n') o << "\n";
+      buffer.append (o.str ());
+    }
+
+    void flush () { buffer.write (); }
+  }
+
+  namespace {
+    thread_local raw_ostream *diagsStream = nullptr;
+  }
+
+  raw_ostream &diags () { return diagsStream ? *diagsStream : errs (); }
+
+  DiagsRedirect::DiagsRedirect (raw_ostream &o) : m_prev (diagsStream)
+  { diagsStream = &o; }
+
+  DiagsRedirect::~DiagsRedirect () { diagsStream = m_prev; }
+}
@@ -0,0 +1,110 @@
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/GlobalAlias.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "sea_dsa/Materialize.hh"
+#include "sea_dsa/support/Debug.h"
+
+using namespace llvm;
+
+namespace sea_dsa {
+
+  int materializeReachable (Module &M, const std::vector<GlobalValue*> &roots)
+  {
+    int num = 0;
+    std::vector<Function*> w;
+    SmallPtrSet<const Value*, 32> seen;
+
+    // -- record the functions and global initializers reachable
+    //    from a value
+    std::vector<const Value*> stack;
+    auto visit = [&] (const Value *v)
+      {
+	stack.push_back (v);
+	while (!stack.empty ())
+	  {
+	    const Value *u = stack.back ();
+	    stack.pop_back ();
+	    if (!isa<Constant> (u) || !seen.insert (u).second) continue;
+
+	    if (const Function *f = dyn_cast<Function> (u))
+	      w.push_back (const_cast<Function*> (f));
+	    else if (const GlobalVariable *gv = dyn_cast<GlobalVariable> (u))
+	      {
+		if (gv->hasInitializer ())
+		  stack.push_back (gv->getInitializer ());
+	      }
+	    else if (const GlobalAlias *ga = dyn_cast<GlobalAlias> (u))
+	      stack.push_back (ga->getAliasee ());
+	    else
+	      for (const Use &op : cast<Constant> (u)->operands ())
+		stack.push_back (op.get ());
+	  }
+      };
+
+    for (GlobalValue *gv : roots) visit (gv);
+
+    while (!w.empty ())
+      {
+	Function *f = w.back ();
+	w.pop_back ();
+
+	if (f->isMaterializable ())
+	  {
+	    if (std::error_code ec = f->materialize ())
+	      {
+		diags () << "ERROR: cannot materialize " << f->getName ()
+			<< ": " << ec.message () << "\n";
+		return -1;
+	      }
+	    num++;
+	  }
+
+	for (inst_iterator it = inst_begin (f), et = inst_end (f); it != et; ++it)
+	  for (const Use &op : it->operands ())
+	    visit (op.get ());
+      }
+
+    LOG ("dsa-materialize",
+	 unsigned lazy = 0;
+	 for (auto &F : M) if (F.isMaterializable ()) lazy++;
+	 logs () << "Materialized " << num << " functions. "
+	         << lazy << " functions are not materialized\n";);
+
+    return num;
+  }
+
+  void MaterializeReachable::getAnalysisUsage (AnalysisUsage &AU) const
+  {
+    // -- nothing is preserved: the call graph must be recomputed
+    //    with the new function bodies
+  }
+
+  bool MaterializeReachable::runOnModule (Module &M)
+  {
+    std::vector<GlobalValue*> roots;
+    if (Function *main = M.getFunction ("main"))
+      roots.push_back (main);
+    else
+      for (auto &F : M)
+	if (!F.hasLocalLinkage ()) roots.push_back (&F);
+
+    // -- externally visible global variables can be accessed by
+    //    unknown code so their initializers are roots too
+    for (auto &GV : M.globals ())
+      if (!GV.hasLocalLinkage ()) roots.push_back (&GV);
+
+    return materializeReachable (M, roots) > 0;
+  }
+
+} // end namespace
+
+char sea_dsa::MaterializeReachable::ID = 0;
+
+static llvm::RegisterPass<sea_dsa::MaterializeReachable>
+X ("sea-dsa-materialize", "Materialize functions reachable from the entry points");
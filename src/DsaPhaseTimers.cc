@@ -0,0 +1,150 @@
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "sea_dsa/PhaseTimers.hh"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+static llvm::cl::opt<bool>
+PhaseTimersOpt("sea-dsa-phase-timers",
+	       llvm::cl::desc("DSA: measure the time spent in each phase of the analysis"),
+	       llvm::cl::init(false));
+
+static llvm::cl::opt<bool>
+PerfCountersOpt("sea-dsa-perf-counters",
+		llvm::cl::desc("DSA: read hardware performance counters in each phase (Linux only)"),
+		llvm::cl::init(false));
+
+using namespace llvm;
+
+namespace sea_dsa {
+
+  const char *timedPhaseName (TimedPhase p) {
+    switch (p) {
+    case TIMER_LOCAL:      return "local";
+    case TIMER_BU_CLONE:   return "bottom-up-clone";
+    case TIMER_TD_CLONE:   return "top-down-clone";
+    case TIMER_CI_RESOLVE: return "context-insensitive-resolve";
+    case TIMER_SIMULATION: return "simulation";
+    case TIMER_COMPRESS:   return "compress";
+    default:               return "unknown";
+    }
+  }
+
+  namespace {
+
+    // Hardware counters of the current thread. A counter that cannot
+    // be opened is ignored.
+    class PerfEvents {
+      int m_fds [PhaseTimers::NUM_PERF_COUNTERS];
+
+    public:
+
+      PerfEvents () {
+	for (unsigned c = 0; c < PhaseTimers::NUM_PERF_COUNTERS; ++c)
+	  m_fds [c] = -1;
+#ifdef __linux__
+	static const uint64_t configs [PhaseTimers::NUM_PERF_COUNTERS] =
+	  { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+	    PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+	for (unsigned c = 0; c < PhaseTimers::NUM_PERF_COUNTERS; ++c) {
+	  struct perf_event_attr attr;
+	  std::memset (&attr, 0, sizeof (attr));
+	  attr.size = sizeof (attr);
+	  attr.type = PERF_TYPE_HARDWARE;
+	  attr.config = configs [c];
+	  attr.exclude_kernel = 1;
+	  attr.exclude_hv = 1;
+	  // -- this thread, any cpu
+	  m_fds [c] = syscall (__NR_perf_event_open, &attr, 0, -1, -1, 0);
+	}
+#endif
+      }
+
+      ~PerfEvents () {
+#ifdef __linux__
+	for (unsigned c = 0; c < PhaseTimers::NUM_PERF_COUNTERS; ++c)
+	  if (m_fds [c] >= 0) close (m_fds [c]);
+#endif
+      }
+
+      bool has (unsigned c) const { return m_fds [c] >= 0; }
+
+      void read (uint64_t values [PhaseTimers::NUM_PERF_COUNTERS]) const {
+	for (unsigned c = 0; c < PhaseTimers::NUM_PERF_COUNTERS; ++c) {
+	  values [c] = 0;
+#ifdef __linux__
+	  if (m_fds [c] >= 0 &&
+	      ::read (m_fds [c], &values [c], sizeof (uint64_t)) != sizeof (uint64_t))
+	    values [c] = 0;
+#endif
+	}
+      }
+    };
+
+    const PerfEvents &perfEvents () {
+      static thread_local PerfEvents events;
+      return events;
+    }
+  }
+
+  PhaseTimers::Scope::Scope (TimedPhase phase)
+    : m_phase (phase), m_perf (), m_active (isEnabled ()) {
+    if (!m_active) return;
+    if (PerfCountersOpt) perfEvents ().read (m_perf);
+    m_start = std::chrono::steady_clock::now ();
+  }
+
+  PhaseTimers::Scope::~Scope () {
+    if (!m_active) return;
+    auto end = std::chrono::steady_clock::now ();
+    Counters &c = get ().m_phases [m_phase];
+    c.m_calls++;
+    c.m_time += std::chrono::duration_cast<std::chrono::nanoseconds> (end - m_start).count ();
+    if (PerfCountersOpt) {
+      uint64_t perf [NUM_PERF_COUNTERS];
+      perfEvents ().read (perf);
+      for (unsigned i = 0; i < NUM_PERF_COUNTERS; ++i)
+	c.m_perf [i] += perf [i] - m_perf [i];
+    }
+  }
+
+  bool PhaseTimers::isEnabled ()
+  { return PhaseTimersOpt || PerfCountersOpt; }
+
+  PhaseTimers &PhaseTimers::get () {
+    static thread_local PhaseTimers timers;
+    return timers;
+  }
+
+  bool PhaseTimers::hasPerfCounter (PerfCounter c)
+  { return PerfCountersOpt && perfEvents ().has (c); }
+
+  void PhaseTimers::printSummary (raw_ostream &o) const {
+    static const char *perfNames [NUM_PERF_COUNTERS] =
+      { "cycles", "instructions", "LLC misses", "branch misses" };
+
+    o << " --- Phase information (inclusive)\n";
+    for (unsigned p = 0; p < NUM_TIMERS; ++p) {
+      const Counters &c = m_phases [p];
+      if (c.m_calls == 0) continue;
+      o << "\t" << timedPhaseName ((TimedPhase) p) << ": " << c.m_calls << " calls, "
+	<< c.m_time / 1000000 << "." << format ("%03u", (unsigned) (c.m_time / 1000 % 1000))
+	<< " ms";
+      for (unsigned i = 0; i < NUM_PERF_COUNTERS; ++i)
+	if (hasPerfCounter ((PerfCounter) i))
+	  o << ", " << c.m_perf [i] << " " << perfNames [i];
+      if (hasPerfCounter (PERF_CYCLES) && hasPerfCounter (PERF_INSTRUCTIONS) &&
+	  c.m_perf [PERF_CYCLES] > 0)
+	o << format (", %.2f IPC", (double) c.m_perf [PERF_INSTRUCTIONS] / c.m_perf [PERF_CYCLES]);
+      o << "\n";
+    }
+  }
+}
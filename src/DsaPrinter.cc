@@ -1,325 +1,74 @@
 #include "llvm/Pass.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/ADT/GraphTraits.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/Support/DOTGraphTraits.h"
 #include "llvm/Support/GraphWriter.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Regex.h"
 
 #include "sea_dsa/DsaAnalysis.hh"
 #include "sea_dsa/Info.hh"
 #include "sea_dsa/GraphTraits.hh"
+#include "sea_dsa/FrozenGraph.hh"
 #include "sea_dsa/support/Debug.h"
+#include "sea_dsa/support/Strings.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
 
 /*
-   Convert each DSA graph to .dot file.
+   Convert each DSA graph to a .dot or .json file.
+
+   Each graph is written from its FrozenGraph snapshot (see
+   GlobalAnalysis::getFrozenGraph) while it is traversed, so nothing
+   but the snapshot and the output file buffer is kept in memory. Huge graphs can be truncated with
+   -sea-dsa-printer-max-nodes and -sea-dsa-printer-max-edges: what is
+   not written is summarized by a single node.
  */
 
+namespace sea_dsa {
+  enum PrinterFormat { DOT_FORMAT, JSON_FORMAT };
+}
+
 static llvm::cl::opt<std::string>
 OutputDir("sea-dsa-dot-outdir",
 	  llvm::cl::desc("DSA: output directory for dot files"),
 	  llvm::cl::init(""),
 	  llvm::cl::value_desc("DIR"));
 
-using namespace llvm;
+static llvm::cl::opt<sea_dsa::PrinterFormat>
+OutputFormat("sea-dsa-printer-format",
+	     llvm::cl::desc("DSA: format of the printed graphs"),
+	     llvm::cl::values
+	     (clEnumValN (sea_dsa::DOT_FORMAT, "dot", "Graphviz dot (default)"),
+	      clEnumValN (sea_dsa::JSON_FORMAT, "json", "JSON"),
+	      clEnumValEnd),
+	     llvm::cl::init (sea_dsa::DOT_FORMAT));
+
+static llvm::cl::opt<unsigned>
+MaxNodes("sea-dsa-printer-max-nodes",
+	 llvm::cl::desc("DSA: maximum number of nodes written per graph (0 = no limit)"),
+	 llvm::cl::init(0));
+
+static llvm::cl::opt<unsigned>
+MaxEdges("sea-dsa-printer-max-edges",
+	 llvm::cl::desc("DSA: maximum number of edges written per graph (0 = no limit)"),
+	 llvm::cl::init(0));
 
-namespace sea_dsa {
+static llvm::cl::opt<std::string>
+FunctionFilter("sea-dsa-printer-filter",
+	       llvm::cl::desc("DSA: only print the graphs of functions whose name matches the regex"),
+	       llvm::cl::init(""),
+	       llvm::cl::value_desc("REGEX"));
 
-  namespace internals {
-    
-    /* XXX: The API of llvm::GraphWriter is not flexible enough.
-       We need the labels for source and destinations of edges to be the
-       same rather than s0,s1... and d0,d1,..
-       
-       internals::GraphWriter is a copy of llvm::GraphWriter but with
-       some changes (search for MODIFICATION) in writeEdge customized to 
-       output nice Dsa graphs.
-    */
-    
-    template<typename GraphType>
-    class GraphWriter {
-      raw_ostream &O;
-      const GraphType &G;
-      
-      typedef DOTGraphTraits<GraphType>           DOTTraits;
-      typedef GraphTraits<GraphType>              GTraits;
-      typedef typename GTraits::NodeType          NodeType;
-      typedef typename GTraits::nodes_iterator    node_iterator;
-      typedef typename GTraits::ChildIteratorType child_iterator;
-      DOTTraits DTraits;
-      
-      // Writes the edge labels of the node to O and returns true if there are any
-      // edge labels not equal to the empty string "".
-      bool getEdgeSourceLabels(raw_ostream &O, NodeType *Node) {
-	child_iterator EI = GTraits::child_begin(Node);
-	child_iterator EE = GTraits::child_end(Node);
-	bool hasEdgeSourceLabels = false;
-	
-	for (unsigned i = 0; EI != EE && i != 64; ++EI, ++i) {
-	  std::string label = DTraits.getEdgeSourceLabel(Node, EI);
-	  
-	  if (label.empty())
-	    continue;
-	  
-	  hasEdgeSourceLabels = true;
-	  
-	  if (i)
-	    O << "|";
-	  
-	  O << "<s" << i << ">" << DOT::EscapeString(label);
-	}
-	
-	if (EI != EE && hasEdgeSourceLabels)
-	  O << "|<s64>truncated...";
-	
-	return hasEdgeSourceLabels;
-      }
-      
-    public:
-      GraphWriter(raw_ostream &o, const GraphType &g, bool SN) : O(o), G(g) {
-	DTraits = DOTTraits(SN);
-      }
-      
-      void writeGraph(const std::string &Title = "") {
-	// Output the header for the graph...
-	writeHeader(Title);
-	
-	// Emit all of the nodes in the graph...
-	writeNodes();
-	
-	// Output any customizations on the graph
-	DOTGraphTraits<GraphType>::addCustomGraphFeatures(G, *this);
-	
-	// Output the end of the graph
-	writeFooter();
-      }
-      
-      void writeHeader(const std::string &Title) {
-	std::string GraphName = DTraits.getGraphName(G);
-	
-	if (!Title.empty())
-	  O << "digraph \"" << DOT::EscapeString(Title) << "\" {\n";
-	else if (!GraphName.empty())
-	  O << "digraph \"" << DOT::EscapeString(GraphName) << "\" {\n";
-	else
-	  O << "digraph unnamed {\n";
-	
-	if (DTraits.renderGraphFromBottomUp())
-	  O << "\trankdir=\"BT\";\n";
-	
-	if (!Title.empty())
-	  O << "\tlabel=\"" << DOT::EscapeString(Title) << "\";\n";
-	else if (!GraphName.empty())
-	  O << "\tlabel=\"" << DOT::EscapeString(GraphName) << "\";\n";
-	O << DTraits.getGraphProperties(G);
-	O << "\n";
-      }
-      
-      void writeFooter() {
-      // Finish off the graph
-	O << "}\n";
-      }
-      
-      void writeNodes() {
-	// Loop over the graph, printing it out...
-	for (node_iterator I = GTraits::nodes_begin(G), E = GTraits::nodes_end(G);
-	     I != E; ++I)
-	  if (!isNodeHidden(*I))
-	    writeNode(*I);
-      }
-      
-      bool isNodeHidden(NodeType &Node) {
-	return isNodeHidden(&Node);
-      }
-      
-      bool isNodeHidden(NodeType *const *Node) {
-	return isNodeHidden(*Node);
-      }
-      
-      bool isNodeHidden(NodeType *Node) {
-	return DTraits.isNodeHidden(Node);
-      }
-      
-      void writeNode(NodeType& Node) {
-	writeNode(&Node);
-      }
-      
-      void writeNode(NodeType *const *Node) {
-	writeNode(*Node);
-      }
-      
-      void writeNode(NodeType *Node) {
-	std::string NodeAttributes = DTraits.getNodeAttributes(Node, G);
-	
-	O << "\tNode" << static_cast<const void*>(Node) << " [shape=record,";
-	if (!NodeAttributes.empty()) O << NodeAttributes << ",";
-	O << "label=\"{";
-	
-	if (!DTraits.renderGraphFromBottomUp()) {
-	  O << DOT::EscapeString(DTraits.getNodeLabel(Node, G));
-	  
-	  // If we should include the address of the node in the label, do so now.
-	  if (DTraits.hasNodeAddressLabel(Node, G))
-	    O << "|" << static_cast<const void*>(Node);
-	  
-	  std::string NodeDesc = DTraits.getNodeDescription(Node, G);
-	  if (!NodeDesc.empty())
-	    O << "|" << DOT::EscapeString(NodeDesc);
-	}
-	
-	std::string edgeSourceLabels;
-	raw_string_ostream EdgeSourceLabels(edgeSourceLabels);
-	bool hasEdgeSourceLabels = getEdgeSourceLabels(EdgeSourceLabels, Node);
-	
-	if (hasEdgeSourceLabels) {
-	  if (!DTraits.renderGraphFromBottomUp()) O << "|";
-	  
-	  O << "{" << EdgeSourceLabels.str() << "}";
-	  
-	  if (DTraits.renderGraphFromBottomUp()) O << "|";
-	}
-	
-	if (DTraits.renderGraphFromBottomUp()) {
-	  O << DOT::EscapeString(DTraits.getNodeLabel(Node, G));
-	  
-	  // If we should include the address of the node in the label, do so now.
-	  if (DTraits.hasNodeAddressLabel(Node, G))
-	    O << "|" << static_cast<const void*>(Node);
-	  
-	  std::string NodeDesc = DTraits.getNodeDescription(Node, G);
-	  if (!NodeDesc.empty())
-	    O << "|" << DOT::EscapeString(NodeDesc);
-	}
-	
-        #if 0 
-        // XXX: MODIFICATION
-        // if (DTraits.hasEdgeDestLabels()) {
-        // 	O << "|{";
-	
-        // 	unsigned i = 0, e = DTraits.numEdgeDestLabels(Node);
-        // 	for (; i != e && i != 64; ++i) {
-        // 	  if (i) O << "|";
-        // 	  O << "<d" << i << ">"
-        // 	    << DOT::EscapeString(DTraits.getEdgeDestLabel(Node, i));
-        // 	}
-	
-        // 	if (i != e)
-        // 	  O << "|<d64>truncated...";
-        // 	O << "}";
-        // }
-        #endif
-      
-	O << "}\"];\n";   // Finish printing the "node" line
-	
-	// Output all of the edges now
-	child_iterator EI = GTraits::child_begin(Node);
-	child_iterator EE = GTraits::child_end(Node);
-	for (unsigned i = 0; EI != EE && i != 64; ++EI, ++i)
-	  if (!DTraits.isNodeHidden(*EI))
-	    writeEdge(Node, i, EI);
-	for (; EI != EE; ++EI)
-	  if (!DTraits.isNodeHidden(*EI))
-	    writeEdge(Node, 64, EI);
-      }
-      
-      void writeEdge(NodeType *Node, unsigned edgeidx, child_iterator EI) {
-	if (NodeType *TargetNode = *EI) {
-	  int DestPort = -1;
-	  
-          #if 0 
-	  // MODIFICATION
-	  // if (DTraits.edgeTargetsEdgeSource(Node, EI)) {
-	  //   child_iterator TargetIt = DTraits.getEdgeTarget(Node, EI);
-	  //   // Figure out which edge this targets...
-	  //   unsigned Offset =
-	  //     (unsigned)std::distance(GTraits::child_begin(TargetNode), TargetIt);
-	  //   DestPort = static_cast<int>(Offset);
-	  // }
-	  #else
- 	  DestPort = DTraits.getIndex (TargetNode, EI.getOffset ());
-	  #endif
-	
-	  if (DTraits.getEdgeSourceLabel(Node, EI).empty())
-	    edgeidx = -1;
-	  
-	  emitEdge(static_cast<const void*>(Node), edgeidx,
-		   static_cast<const void*>(TargetNode), DestPort,
-		   DTraits.getEdgeAttributes(Node, EI, G));
-	}
-      }
-      
-      /// emitSimpleNode - Outputs a simple (non-record) node
-      void emitSimpleNode(const void *ID, const std::string &Attr,
-			  const std::string &Label, unsigned NumEdgeSources = 0,
-			  const std::vector<std::string> *EdgeSourceLabels = nullptr) {
-	O << "\tNode" << ID << "[ ";
-	if (!Attr.empty())
-	  O << Attr << ",";
-	O << " label =\"";
-	if (NumEdgeSources) O << "{";
-	O << DOT::EscapeString(Label);
-	if (NumEdgeSources) {
-	  O << "|{";
-	  
-	  for (unsigned i = 0; i != NumEdgeSources; ++i) {
-	    if (i) O << "|";
-	    O << "<s" << i << ">";
-	    if (EdgeSourceLabels) O << DOT::EscapeString((*EdgeSourceLabels)[i]);
-	  }
-	  O << "}}";
-	}
-	O << "\"];\n";
-      }
-      
-      /// emitEdge - Output an edge from a simple node into the graph...
-      void emitEdge(const void *SrcNodeID, int SrcNodePort,
-		    const void *DestNodeID, int DestNodePort,
-		    const std::string &Attrs) {
-	if (SrcNodePort  > 64) return;             // Eminating from truncated part?
-	if (DestNodePort > 64) DestNodePort = 64;  // Targeting the truncated part?
-	
-	O << "\tNode" << SrcNodeID;
-	if (SrcNodePort >= 0)
-	  O << ":s" << SrcNodePort;
-	O << " -> Node" << DestNodeID;
-	
-	// Edges that go to cells with zero offset do not
-	// necessarily point to field 0. This makes graphs nicer.
-	if (DestNodePort > 0 && DTraits.hasEdgeDestLabels()) {
-	  //if (DestNodePort >= 0 && DTraits.hasEdgeDestLabels()) {
-  	  #if 0
-	  // MODIFICATION
-	  //O << ":d" << DestNodePort;
-	  #else
-	  O << ":s" << DestNodePort;
-	  #endif 
-	}
-	
-	if (!Attrs.empty())
-	  O << "[" << Attrs << "]";
-	O << ";\n";
-      }
-      
-      /// getOStream - Get the raw output stream into the graph file. Useful to
-      /// write fancy things using addCustomGraphFeatures().
-      raw_ostream &getOStream() {
-	return O;
-      }
-    };
+static llvm::cl::opt<unsigned>
+PrinterJobs("sea-dsa-printer-jobs",
+	    llvm::cl::desc("DSA: number of threads writing graphs (0 = one per core)"),
+	    llvm::cl::init(1));
 
-    template<typename GraphType>
-    raw_ostream &WriteGraph(raw_ostream &O, const GraphType &G,
-			    bool ShortNames = false,
-			    const Twine &Title = "") {
-      // Start the graph emission process...
-      GraphWriter<GraphType> W(O, G, ShortNames);
-      
-      // Emit the graph.
-      W.writeGraph(Title.str());
-      return O;
-    }
-    
-  } // end internals
-} // end namespace sea_dsa
+using namespace llvm;
 
 namespace llvm {
 
@@ -329,9 +78,6 @@ namespace llvm {
     DOTGraphTraits (bool& b) {}    
     DOTGraphTraits () {}
 
-    // static std::string getGraphName(const sea_dsa::Graph *G) {
-    // }
-
     static std::string getGraphProperties(const sea_dsa::Graph *G) {
       std::string empty;
       raw_string_ostream OS(empty);
@@ -390,238 +136,403 @@ namespace llvm {
 	  }
 	  OS << "}";
 	}
-	OS << ":";
-	typename sea_dsa::Node::NodeType  node_type = N->getNodeType();
-	if (node_type.array) OS << " Sequence ";
-	if (node_type.alloca) OS << "S";
-	if (node_type.heap) OS << "H";
-	if (node_type.global) OS << "G";
-	if (node_type.unknown) OS << "U";
-	if (node_type.incomplete) OS << "I";
-	if (node_type.modified) OS << "M";
-	if (node_type.read) OS << "R";
-	if (node_type.external) OS << "E";
-	if (node_type.externFunc) OS << "X";
-	if (node_type.externGlobal) OS << "Y";
-	if (node_type.inttoptr) OS << "P";
-	if (node_type.ptrtoint) OS << "2";
-	if (node_type.vastart) OS << "V";
-	if (node_type.dead) OS << "D";
+	OS << ":" << getNodeTypeLabel (N->getNodeType ());
 	//OS << " " << N->size() << " ";
       }
 
       return OS.str();
     }
 
+    static std::string getNodeTypeLabel (const sea_dsa::Node::NodeType &node_type) {
+      std::string empty;
+      raw_string_ostream OS(empty);
+      if (node_type.array) OS << " Sequence ";
+      if (node_type.alloca) OS << "S";
+      if (node_type.heap) OS << "H";
+      if (node_type.global) OS << "G";
+      if (node_type.unknown) OS << "U";
+      if (node_type.incomplete) OS << "I";
+      if (node_type.modified) OS << "M";
+      if (node_type.read) OS << "R";
+      if (node_type.external) OS << "E";
+      if (node_type.externFunc) OS << "X";
+      if (node_type.externGlobal) OS << "Y";
+      if (node_type.inttoptr) OS << "P";
+      if (node_type.ptrtoint) OS << "2";
+      if (node_type.vastart) OS << "V";
+      if (node_type.dead) OS << "D";
+
+      return OS.str();
+    }
+
     bool isNodeHidden(sea_dsa::Node *Node) {
       // TODO: do not show nodes without incoming edges
       return false;
     }
 
-    static std::string getEdgeSourceLabel(const sea_dsa::Node *Node,
-                                          sea_dsa::Node::iterator I) {
-      std::string S;
-      llvm::raw_string_ostream O(S);
-      O << I.getOffset();
-      return O.str();
-    }
-
     static bool hasEdgeDestLabels () { return true;}
 
     static unsigned numEdgeDestLabels (const sea_dsa::Node *Node) {
       return Node->links ().size();
     }
-    
-    ///////
-    // XXX: if we use llvm::GraphWriter and we want to add destination labels.
-    // It won't show the graphs as we want anyway.
-    ///////
-    // static std::string getEdgeDestLabel(const sea_dsa::Node *Node,
-    // 					unsigned Idx) {
-    //   std::string S;
-    //   llvm::raw_string_ostream O(S);
-    //   O << getOffset (Node,Idx);
-    //   return O.str();
-    // }
-
-    // static bool edgeTargetsEdgeSource(const void *Node,
-    // 				      sea_dsa::Node::iterator I) {
-    //   if (I.getOffset() < I->getNode()->size()) {
-    //   	if (I->hasLink (I.getOffset())) {
-    // 	  //unsigned O = I->getLink(I.getOffset()).getOffset();
-    // 	  //return O != 0;
-    // 	  return true;
-    // 	} else {
-    // 	  return false;
-    // 	}
-    //   } else {
-    //   	return false;
-    //   }
-    // }
-
-    // static sea_dsa::Node::iterator getEdgeTarget(const sea_dsa::Node *Node,
-    // 						      sea_dsa::Node::iterator I) {
-    //   unsigned O = I->getLink(I.getOffset()).getOffset();
-    //   unsigned LinkNo = O;
-    //   sea_dsa::Node *N = *I;
-    //   sea_dsa::Node::iterator R = N->begin();
-    //   for (; LinkNo; --LinkNo) ++R;
-    //   return R;
-    // }
-
-    // static int getOffset (const sea_dsa::Node *Node, unsigned Idx) {
-    //   auto it = Node->links().begin();
-    //   auto et = Node->links().end();
-    //   unsigned i = 0;
-    //   for (; it!=et; ++it,i++) {
-    // 	if (i==Idx) {
-    // 	  return it->first;
-    // 	}
-    //   }
-    //   return -1;
-    // }
-    
-    static int getIndex (const sea_dsa::Node *Node, unsigned Offset) {
-      auto it = Node->links().begin();
-      auto et = Node->links().end();
-      unsigned idx = 0;
-      for (; it!=et; ++it,++idx) {
-    	if (it->first == Offset)
-    	  return idx;
+  };
+
+} // end namespace llvm
+
+namespace sea_dsa {
+
+  namespace internals {
+
+    /* Write a graph node by node to the output stream.
+
+       Memory nodes are written in the order of the graph and then the
+       cells of formals, returns and scalars. Once the node (resp.
+       edge) limit is reached, the remaining nodes (resp. edges) are
+       only counted. Edges to nodes that are not written go to a
+       summary node (id 0 in JSON).
+    */
+    class GraphStreamWriter {
+      typedef DOTGraphTraits<Graph*> DOTTraits;
+      typedef FrozenGraph::NodeId NodeId;
+
+      raw_ostream &O;
+      const FrozenGraph &G;
+      PrinterFormat m_format;
+      unsigned m_maxNodes;
+      unsigned m_maxEdges;
+
+      // -- written memory nodes
+      std::vector<bool> m_written;
+      unsigned m_numNodes;
+      unsigned m_numEdges;
+      unsigned m_elidedNodes;
+      unsigned m_elidedEdges;
+      // -- JSON: no comma before the first element of an array
+      bool m_first;
+
+      bool nodeLimit () const
+      { return m_maxNodes > 0 && m_numNodes >= m_maxNodes; }
+
+      // Return false if the edge is not written because of the limit
+      bool takeEdge () {
+	if (m_maxEdges > 0 && m_numEdges >= m_maxEdges) {
+	  m_elidedEdges++;
+	  return false;
+	}
+	m_numEdges++;
+	return true;
       }
-      return -1;
-    }
-   
-    static void addCustomGraphFeatures(sea_dsa::Graph *g,
-				       sea_dsa::internals::GraphWriter<sea_dsa::Graph*> &GW) {
-      
-      typedef sea_dsa::Graph::scalar_const_iterator scalar_const_iterator;
-      typedef sea_dsa::Graph::formal_const_iterator formal_const_iterator;
-      typedef sea_dsa::Graph::return_const_iterator return_const_iterator;      
-      typedef sea_dsa::Graph Graph;
-      typedef sea_dsa::Node Node;
-      
-      const Graph * G = g;
-
-      // print edges from scalar (local and global) variables to cells
-      { 
-	scalar_const_iterator it = g->scalar_begin();
-	scalar_const_iterator et = g->scalar_end();
-	for (; it!=et; ++it) {
-	  std::string OS_str;
-	  llvm::raw_string_ostream OS(OS_str);
-	  const llvm::Value* v = it->first;
-	  if (v->hasName ())
-	    OS << v->getName ();
-	  else
-	    OS << *v;
-	  GW.emitSimpleNode(it->first, "shape=plaintext", OS.str());
-	  Node *DestNode = it->second->getNode();
-	  int EdgeDest = getIndex(DestNode, it->second->getOffset());
-	  GW.emitEdge(it->first, -1,
-		      DestNode, EdgeDest,
-		      "arrowtail=tee,color=gray63");
-		      
+
+      bool isWritten (const FrozenGraph::Cell &c) const
+      { return !c.isNull () && m_written [c.getNode ()]; }
+
+      // Same label as DOTTraits::getNodeLabel
+      std::string getNodeLabel (NodeId n) const {
+	std::string empty;
+	raw_string_ostream OS (empty);
+	if (G.isCollapsed (n))
+	  OS << "COLLAPSED";
+	else {
+	  ArrayRef<uint32_t> fields = G.getTypeFields (n);
+	  ArrayRef<uint32_t> sets = G.getTypeSets (n);
+	  OS << "{";
+	  if (fields.empty ()) OS << "void";
+	  for (unsigned i = 0; i < fields.size (); ++i) {
+	    if (i > 0) OS << ",";
+	    OS << fields [i] << ":"; // offset
+	    ArrayRef<const Type*> types = G.getTypeSet (sets [i]);
+	    if (types.empty ()) OS << "void";
+	    for (unsigned j = 0; j < types.size (); ++j) {
+	      if (j > 0) OS << "|";
+	      types [j]->print (OS);
+	    }
+	  }
+	  OS << "}";
+	}
+	OS << ":" << DOTTraits::getNodeTypeLabel (G.getNodeType (n));
+	return OS.str ();
+      }
+
+      void writeEdgeTarget (const FrozenGraph::Cell &c) {
+	if (m_format == JSON_FORMAT) {
+	  O << "\"node\":" << (isWritten (c) ? G.getId (c.getNode ()) : 0)
+	    << ",\"offset\":" << c.getOffset ();
+	  return;
+	}
+	if (!isWritten (c)) {
+	  O << "NodeElided";
+	  return;
 	}
+	O << "Node" << G.getId (c.getNode ());
+	// Edges that go to cells with zero offset do not
+	// necessarily point to field 0. This makes graphs nicer.
+	ArrayRef<uint32_t> fields = G.getLinkFields (c.getNode ());
+	auto it = std::lower_bound (fields.begin (), fields.end (), c.getOffset ());
+	if (it != fields.end () && *it == c.getOffset () && it != fields.begin ())
+	  O << ":s" << (it - fields.begin ());
       }
 
-      // print edges from formal parameters to cells
-      { 
-	formal_const_iterator it = g->formal_begin();
-	formal_const_iterator et = g->formal_end();
-	for (; it!=et; ++it) {
-	  std::string OS_str;
-	  llvm::raw_string_ostream OS(OS_str);
-	  const llvm::Argument* arg = it->first;
-	  OS << arg->getParent()->getName () << "#" << arg->getArgNo();
-	  GW.emitSimpleNode(it->first, "shape=plaintext,fontcolor=blue", OS.str());
-	  Node *DestNode = it->second->getNode();
-	  int EdgeDest = getIndex(DestNode, it->second->getOffset());
-	  GW.emitEdge(it->first, -1,
-		      DestNode, EdgeDest,
-		      "tailclip=false,color=gray63");
-		      
+      void writeNode (NodeId n) {
+	ArrayRef<uint32_t> fields = G.getLinkFields (n);
+	ArrayRef<FrozenGraph::Cell> cells = G.getLinkCells (n);
+
+	if (m_format == JSON_FORMAT) {
+	  if (!m_first) O << ",";
+	  m_first = false;
+	  O << "\n  {\"id\":" << G.getId (n)
+	    << ",\"label\":\"" << escapeJSON (getNodeLabel (n)) << "\""
+	    << ",\"collapsed\":" << (G.isCollapsed (n) ? "true" : "false")
+	    << ",\"size\":" << G.size (n)
+	    << ",\"links\":[";
+	  bool first = true;
+	  for (unsigned i = 0; i < fields.size (); ++i) {
+	    if (!takeEdge ()) continue;
+	    if (!first) O << ",";
+	    first = false;
+	    O << "{\"field\":" << fields [i] << ",";
+	    writeEdgeTarget (cells [i]);
+	    O << "}";
+	  }
+	  O << "]}";
+	  return;
+	}
+
+	O << "\tNode" << G.getId (n) << " [shape=record,";
+	if (G.isCollapsed (n)) O << "color=brown1, style=filled,";
+	O << "label=\"{" << DOT::EscapeString (getNodeLabel (n));
+	if (!fields.empty ()) {
+	  O << "|{";
+	  for (unsigned i = 0; i < fields.size (); ++i) {
+	    if (i) O << "|";
+	    O << "<s" << i << ">" << fields [i];
+	  }
+	  O << "}";
+	}
+	O << "}\"];\n";
+
+	for (unsigned i = 0; i < fields.size (); ++i) {
+	  if (!takeEdge ()) continue;
+	  O << "\tNode" << G.getId (n) << ":s" << i << " -> ";
+	  writeEdgeTarget (cells [i]);
+	  O << ";\n";
 	}
       }
 
-      // print edges from function return to cells
-      { 
-	return_const_iterator it = g->return_begin();
-	return_const_iterator et = g->return_end();
-	for (; it!=et; ++it) {
-	  std::string OS_str;
-	  llvm::raw_string_ostream OS(OS_str);
-	  const llvm::Function* f = it->first;
-	  OS << f->getName () << "#Ret";
-	  GW.emitSimpleNode(it->first, "shape=plaintext,fontcolor=blue", OS.str());
-	  Node *DestNode = it->second->getNode();
-	  int EdgeDest = getIndex(DestNode, it->second->getOffset());
-	  GW.emitEdge(it->first, -1,
-		      DestNode, EdgeDest,
-		      "arrowtail=tee,color=gray63");
-		      
+      // Write a named value (scalar, formal or return) and its edge
+      void writeValue (const std::string &name, const char *kind,
+		       const FrozenGraph::Cell &c) {
+	if (nodeLimit ()) {
+	  m_elidedNodes++;
+	  m_elidedEdges++;
+	  return;
+	}
+	unsigned id = m_numNodes++;
+
+	if (m_format == JSON_FORMAT) {
+	  if (!m_first) O << ",";
+	  m_first = false;
+	  O << "\n  {\"name\":\"" << escapeJSON (name) << "\",\"kind\":\"" << kind << "\"";
+	  if (takeEdge ()) {
+	    O << ",";
+	    writeEdgeTarget (c);
+	  }
+	  O << "}";
+	  return;
+	}
+
+	bool scalar = std::string (kind) == "scalar";
+	O << "\tValue" << id << " [shape=plaintext,"
+	  << (scalar ? "" : "fontcolor=blue,")
+	  << "label=\"" << DOT::EscapeString (name) << "\"];\n";
+	if (takeEdge ()) {
+	  O << "\tValue" << id << " -> ";
+	  writeEdgeTarget (c);
+	  O << (scalar ? "[arrowtail=tee,color=gray63]" : "[tailclip=false,color=gray63]")
+	    << ";\n";
 	}
       }
-      
-    }
-  };
 
-} // end namespace llvm
+    public:
 
-namespace sea_dsa {
+      GraphStreamWriter (raw_ostream &o, const FrozenGraph &g, PrinterFormat format,
+			 unsigned maxNodes, unsigned maxEdges)
+	: O (o), G (g), m_format (format), m_maxNodes (maxNodes), m_maxEdges (maxEdges),
+	  m_numNodes (0), m_numEdges (0), m_elidedNodes (0), m_elidedEdges (0),
+	  m_first (true) {}
+
+      void write (const std::string &title) {
+	// -- decide which memory nodes are written before writing
+	//    any edge
+	m_written.assign (G.numNodes (), false);
+	for (NodeId n = 0; n < G.numNodes (); ++n) {
+	  if (nodeLimit ()) m_elidedNodes++;
+	  else {
+	    m_written [n] = true;
+	    m_numNodes++;
+	  }
+	}
 
-  using namespace llvm;
-  
-  static std::string appendOutDir (std::string FileName) {
-    if (!OutputDir.empty ()) {
-      if (!llvm::sys::fs::create_directory (OutputDir)) {
-	std::string FullFileName = OutputDir + "/" + FileName;
+	if (m_format == JSON_FORMAT)
+	  O << "{\"function\":\"" << escapeJSON (title) << "\",\"nodes\":[";
+	else {
+	  O << "digraph \"" << DOT::EscapeString (title) << "\" {\n";
+	  O << "\tlabel=\"" << DOT::EscapeString (title) << "\";\n";
+	  O << DOTTraits::getGraphProperties (nullptr) << "\n";
+	}
+
+	for (NodeId n = 0; n < G.numNodes (); ++n)
+	  if (m_written [n]) writeNode (n);
+
+	if (m_format == JSON_FORMAT) {
+	  O << "],\n \"values\":[";
+	  m_first = true;
+	}
+
+	// -- the scalars of the snapshot include the formals
+	for (auto &kv : G.scalars ())
+	  if (const Argument *arg = dyn_cast<Argument> (kv.first))
+	    writeValue (arg->getParent ()->getName ().str () + "#" +
+			std::to_string (arg->getArgNo ()), "formal", kv.second);
+	for (auto &kv : G.returns ())
+	  writeValue (kv.first->getName ().str () + "#Ret", "return", kv.second);
+	for (auto &kv : G.scalars ()) {
+	  const Value *v = kv.first;
+	  if (isa<Argument> (v)) continue;
+	  std::string name;
+	  raw_string_ostream OS (name);
+	  if (v->hasName ())
+	    OS << v->getName ();
+	  else
+	    OS << *v;
+	  writeValue (OS.str (), "scalar", kv.second);
+	}
+
+	if (m_format == JSON_FORMAT) {
+	  O << "],\n \"elided_nodes\":" << m_elidedNodes
+	    << ",\"elided_edges\":" << m_elidedEdges << "}\n";
+	  return;
+	}
+
+	if (m_elidedNodes > 0 || m_elidedEdges > 0)
+	  O << "\tNodeElided [shape=box,style=dashed,label=\""
+	    << m_elidedNodes << " nodes and " << m_elidedEdges
+	    << " edges not shown\"];\n";
+	O << "}\n";
+      }
+    };
+
+  } // end internals
+
+  static std::string appendOutDir (std::string FileName, const std::string &OutDir) {
+    if (!OutDir.empty ()) {
+      if (!llvm::sys::fs::create_directory (OutDir)) {
+	std::string FullFileName = OutDir + "/" + FileName;
 	return FullFileName;
       }
     }
     return FileName;
   }
-  
-  static bool writeGraph (Graph *G, std::string Filename) {
-    std::string FullFilename = appendOutDir (Filename);
+
+  static std::string getFileName (const Function &F, PrinterFormat format) {
+    return F.getName ().str () + (format == JSON_FORMAT ? ".mem.json" : ".mem.dot");
+  }
+
+  static bool writeGraph (const FrozenGraph &G, const Function &F,
+			  const std::string &OutDir = OutputDir,
+			  PrinterFormat format = OutputFormat) {
+    std::string FullFilename = appendOutDir (getFileName (F, format), OutDir);
     std::error_code EC;
     raw_fd_ostream File(FullFilename, EC, sys::fs::F_Text);
     if (!EC) {
-      internals::WriteGraph(File, G);
-      LOG("dsa-printer", G->write(errs()));
+      internals::GraphStreamWriter W (File, G, format, MaxNodes, MaxEdges);
+      W.write (F.getName ().str ());
+      LOG("dsa-printer", G.write(logs()));
       return true;
     }
+    diags () << "WARNING: cannot write " << FullFilename << "\n";
     return false;
   }
-  
+
   struct DsaPrinter : public ModulePass {
     static char ID; 
     DsaAnalysis* m_dsa;
+    // directory where dot files are written
+    std::string m_outdir;
+    
+    DsaPrinter() : ModulePass(ID), m_dsa(nullptr), m_outdir (OutputDir) { }
     
-    DsaPrinter() : ModulePass(ID), m_dsa(nullptr) { }
+    DsaPrinter(const std::string &outdir)
+      : ModulePass(ID), m_dsa(nullptr), m_outdir (outdir) { }
     
     bool runOnModule(Module &M) override {
       m_dsa = &getAnalysis<sea_dsa::DsaAnalysis>();
-      if (m_dsa->getDsaAnalysis().kind () == CONTEXT_INSENSITIVE) {
-	Function *main = M.getFunction ("main");
-	if (main && m_dsa->getDsaAnalysis().hasGraph (*main)) {
-	  Graph *G = &m_dsa->getDsaAnalysis().getGraph (*main);
-	  std::string Filename = main->getName().str() + ".mem.dot";
-	  writeGraph (G, Filename);
+      GlobalAnalysis &ga = m_dsa->getDsaAnalysis();
+
+      // -- a copy: the option is shared by all the modules of a batch
+      std::string pattern = FunctionFilter;
+      Regex filter (pattern);
+      std::string err;
+      if (!pattern.empty () && !filter.isValid (err)) {
+	diags () << "WARNING: ignoring invalid regex " << pattern
+		<< ": " << err << "\n";
+	pattern.clear ();
+      }
+
+      // -- the functions to print grouped by graph so that a graph
+      //    shared by several functions is only read by one thread.
+      //    If the analysis can evict graphs (e.g., graphs read from a
+      //    file with a bound on the loaded graphs), grouping would
+      //    load all of them: each function is a job and its graph is
+      //    only loaded while it is written.
+      const bool evictable = ga.canEvictGraphs ();
+      std::vector<std::vector<const Function*> > jobs;
+      DenseMap<const void*, unsigned> jobOf;
+      auto addJob = [&] (Function &F) {
+	if (!ga.hasGraph (F)) return;
+	if (!pattern.empty () && !filter.match (F.getName ())) return;
+	if (evictable) {
+	  jobs.push_back (std::vector<const Function*> (1, &F));
+	  return;
 	}
+	GraphHandle G = ga.getGraphHandle (F);
+	if (G->begin() == G->end()) return;
+	auto it = jobOf.find (G.getKey ());
+	if (it == jobOf.end ()) {
+	  it = jobOf.insert (std::make_pair (G.getKey (), jobs.size ())).first;
+	  jobs.push_back (std::vector<const Function*> ());
+	}
+	jobs [it->second].push_back (&F);
+      };
+
+      if (ga.kind () == CONTEXT_INSENSITIVE) {
+	if (Function *main = M.getFunction ("main")) addJob (*main);
       } else {
-	for (auto &F: M) runOnFunction(F);
+	for (auto &F: M) addJob (F);
       }
-      return false;
-    }
-    
-    bool runOnFunction(Function &F) {
-      if (m_dsa->getDsaAnalysis().hasGraph (F)) {	
-	Graph *G = &m_dsa->getDsaAnalysis().getGraph (F);
-	if (G->begin() != G->end()) {
-	  std::string Filename = F.getName().str() + ".mem.dot";
-	  writeGraph (G, Filename);
+
+      // -- graphs are only read (they have no forwarding nodes left)
+      //    so they can be written concurrently
+      std::atomic<unsigned> next (0);
+      auto worker = [&] () {
+	for (unsigned i = next++; i < jobs.size (); i = next++) {
+	  auto G = ga.getFrozenGraph (*jobs [i].front ());
+	  if (G->numNodes () == 0) continue;
+	  for (const Function *F : jobs [i])
+	    writeGraph (*G, *F, m_outdir);
 	}
+      };
+
+      // -- getGraphHandle (and thus getFrozenGraph) of an analysis
+      //    that evicts graphs is not thread-safe
+      unsigned numThreads = evictable ? 1 : (unsigned) PrinterJobs;
+      if (numThreads == 0) numThreads = std::max (1u, std::thread::hardware_concurrency ());
+      numThreads = std::min<unsigned> (numThreads, jobs.size ());
+      if (numThreads <= 1)
+	worker ();
+      else {
+	std::vector<std::thread> threads;
+	for (unsigned i = 0; i < numThreads; ++i) threads.push_back (std::thread (worker));
+	for (auto &t : threads) t.join ();
       }
       return false;
     }
@@ -648,10 +559,10 @@ namespace sea_dsa {
       if (m_dsa->getDsaAnalysis().kind () == CONTEXT_INSENSITIVE) {
 	Function *main = M.getFunction ("main");
 	if (main && m_dsa->getDsaAnalysis().hasGraph (*main)) {
-	  Graph *G = &m_dsa->getDsaAnalysis().getGraph (*main);
-	  std::string Filename = main->getName().str() + ".mem.dot";
-	  if (writeGraph (G, Filename))
-	    DisplayGraph(Filename, wait, GraphProgram::DOT);	      
+	  auto G = m_dsa->getDsaAnalysis().getFrozenGraph (*main);
+	  if (writeGraph (*G, *main, OutputDir, DOT_FORMAT))
+	    DisplayGraph(appendOutDir (getFileName (*main, DOT_FORMAT), OutputDir),
+			 wait, GraphProgram::DOT);
 	}
       } else {
 	for (auto &F: M) runOnFunction(F);
@@ -661,11 +572,11 @@ namespace sea_dsa {
     
     bool runOnFunction(Function &F) {
       if (m_dsa->getDsaAnalysis().hasGraph (F)) {
-	Graph *G = &m_dsa->getDsaAnalysis().getGraph (F);
-	if (G->begin() != G->end()) {
-	  std::string Filename = F.getName().str() + ".mem.dot";
-	  if (writeGraph (G, Filename)) {
-	    DisplayGraph(Filename, wait, GraphProgram::DOT);
+	auto G = m_dsa->getDsaAnalysis().getFrozenGraph (F);
+	if (G->numNodes () > 0) {
+	  if (writeGraph (*G, F, OutputDir, DOT_FORMAT)) {
+	    DisplayGraph(appendOutDir (getFileName (F, DOT_FORMAT), OutputDir),
+			 wait, GraphProgram::DOT);
 	  }
 	}
       }
@@ -691,6 +602,10 @@ namespace sea_dsa {
     return new sea_dsa::DsaPrinter();
   }
   
+  Pass *createDsaPrinterPass (const std::string &outDir) {
+    return new sea_dsa::DsaPrinter(outDir);
+  }
+  
   Pass *createDsaViewerPass () {
     return new sea_dsa::DsaViewer();
   }
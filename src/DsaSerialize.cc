@@ -0,0 +1,1357 @@
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "sea_dsa/Graph.hh"
+#include "sea_dsa/Serialize.hh"
+#include "sea_dsa/support/Debug.h"
+
+#include <algorithm>
+#include <list>
+
+using namespace llvm;
+
+namespace sea_dsa
+{
+  namespace
+  {
+    const uint32_t MAGIC = 0x41534453; // "SDSA"
+    const uint32_t VERSION = 3;
+    const unsigned HEADER_SIZE = 8;
+
+    /// (0, i) is the i-th global value of the module and (f+1, i) is
+    /// the i-th local value of the f-th function of the module.
+    struct ValueKey
+    {
+      uint32_t m_fn;
+      uint32_t m_idx;
+      explicit ValueKey (uint32_t fn = 0, uint32_t idx = 0) : m_fn (fn), m_idx (idx) {}
+    };
+
+    /// Stable keys for the values of a module. Global values are
+    /// numbered by a symbol table that is written to the file and
+    /// resolved by name when the file is read, so keys of unchanged
+    /// functions survive edits to the rest of the module. The keys of
+    /// the local values of a function are only computed if the
+    /// function is queried.
+    class ValueKeys
+    {
+      typedef std::vector<const Value*> ValueVector;
+      typedef DenseMap<const Value*, unsigned> IdMap;
+
+      struct LocalIndex
+      {
+	ValueVector m_values;
+	IdMap m_ids;
+      };
+
+      const Module &m_M;
+      std::vector<const GlobalValue*> m_symbols;
+      IdMap m_symbol_ids;
+      std::vector<std::unique_ptr<LocalIndex> > m_locals;
+
+      void addLocal (LocalIndex &li, const Value *v)
+      {
+	if (li.m_ids.count (v)) return;
+	li.m_ids [v] = li.m_values.size ();
+	li.m_values.push_back (v);
+      }
+
+      /// add all constant expressions reachable from c
+      void addConstantExprs (LocalIndex &li, const Constant *c)
+      {
+	if (isa<GlobalValue> (c)) return;
+	if (isa<ConstantExpr> (c))
+	{
+	  if (li.m_ids.count (c)) return;
+	  addLocal (li, c);
+	}
+	for (const Use &u : c->operands ())
+	  if (const Constant *op = dyn_cast<Constant> (u.get ()))
+	    addConstantExprs (li, op);
+      }
+
+      const LocalIndex *getLocalIndex (unsigned sym)
+      {
+	const Function *fn = dyn_cast_or_null<Function> (m_symbols [sym]);
+	if (!fn) return nullptr;
+
+	std::unique_ptr<LocalIndex> &li = m_locals [sym];
+	if (li) return li.get ();
+
+	li.reset (new LocalIndex ());
+	for (auto it = fn->arg_begin (), et = fn->arg_end (); it != et; ++it)
+	  addLocal (*li, &*it);
+	for (const_inst_iterator it = inst_begin (*fn), et = inst_end (*fn); it != et; ++it)
+	  addLocal (*li, &*it);
+	for (const_inst_iterator it = inst_begin (*fn), et = inst_end (*fn); it != et; ++it)
+	  for (const Use &u : it->operands ())
+	    if (const Constant *c = dyn_cast<Constant> (u.get ()))
+	      addConstantExprs (*li, c);
+	return li.get ();
+      }
+
+      /// return a function with an instruction that uses ce. Only
+      /// used for a graph shared by functions that do not use ce.
+      const Function *getUserFunction (const ConstantExpr &ce) const
+      {
+	SmallVector<const Value*, 8> worklist;
+	SmallPtrSet<const Value*, 8> seen;
+	worklist.push_back (&ce);
+	while (!worklist.empty ())
+	{
+	  const Value *v = worklist.pop_back_val ();
+	  for (const User *u : v->users ())
+	  {
+	    if (const Instruction *I = dyn_cast<Instruction> (u))
+	      return I->getParent ()->getParent ();
+	    if (isa<Constant> (u) && !isa<GlobalValue> (u) && seen.insert (u).second)
+	      worklist.push_back (u);
+	  }
+	}
+	return nullptr;
+      }
+
+      bool getLocalKey (const Function &fn, const Value &v, ValueKey &k)
+      {
+	auto it = m_symbol_ids.find (&fn);
+	if (it == m_symbol_ids.end ()) return false;
+	const LocalIndex *li = getLocalIndex (it->second);
+	auto vit = li->m_ids.find (&v);
+	if (vit == li->m_ids.end ()) return false;
+	k = ValueKey (it->second + 1, vit->second);
+	return true;
+      }
+
+      /// global values of the module in order
+      void getGlobalValues (std::vector<const GlobalValue*> &gvs) const
+      {
+	for (const GlobalVariable &gv : m_M.globals ()) gvs.push_back (&gv);
+	for (const Function &fn : m_M) gvs.push_back (&fn);
+	for (const GlobalAlias &ga : m_M.aliases ()) gvs.push_back (&ga);
+      }
+
+      void setSymbols (const std::vector<const GlobalValue*> &symbols)
+      {
+	m_symbols = symbols;
+	m_symbol_ids.clear ();
+	for (unsigned i = 0; i < m_symbols.size (); ++i)
+	  if (m_symbols [i]) m_symbol_ids [m_symbols [i]] = i;
+	m_locals.clear ();
+	m_locals.resize (m_symbols.size ());
+      }
+
+    public:
+
+      ValueKeys (const Module &M) : m_M (M)
+      {
+	std::vector<const GlobalValue*> gvs;
+	getGlobalValues (gvs);
+	setSymbols (gvs);
+      }
+
+      /// Replace the symbol table by the global values of the module
+      /// with the given names. Unnamed global values are matched by
+      /// their position among the unnamed ones.
+      void resolve (const std::vector<std::string> &names)
+      {
+	std::vector<const GlobalValue*> gvs;
+	getGlobalValues (gvs);
+	std::vector<const GlobalValue*> unnamed;
+	for (const GlobalValue *gv : gvs)
+	  if (!gv->hasName ()) unnamed.push_back (gv);
+
+	std::vector<const GlobalValue*> symbols;
+	unsigned nextUnnamed = 0;
+	for (const std::string &name : names)
+	{
+	  if (name.empty ())
+	    symbols.push_back (nextUnnamed < unnamed.size () ?
+			       unnamed [nextUnnamed++] : nullptr);
+	  else
+	    symbols.push_back (m_M.getNamedValue (name));
+	}
+	setSymbols (symbols);
+      }
+
+      unsigned numSymbols () const { return m_symbols.size (); }
+
+      /// null if the symbol does not exist in the module
+      const GlobalValue *getSymbol (uint32_t sym) const
+      { return sym < m_symbols.size () ? m_symbols [sym] : nullptr; }
+
+      bool getSymbolId (const GlobalValue &gv, uint32_t &id) const
+      {
+	auto it = m_symbol_ids.find (&gv);
+	if (it == m_symbol_ids.end ()) return false;
+	id = it->second;
+	return true;
+      }
+
+      const Function *getFunction (uint32_t sym) const
+      { return dyn_cast_or_null<Function> (getSymbol (sym)); }
+
+      /// A constant expression is keyed in fn, the function whose
+      /// graph is written, so that its key does not change when
+      /// other functions that use it are edited.
+      bool getKey (const Value &v, const Function *fn, ValueKey &k)
+      {
+	if (const GlobalValue *gv = dyn_cast<GlobalValue> (&v))
+	{
+	  uint32_t id;
+	  if (!getSymbolId (*gv, id)) return false;
+	  k = ValueKey (0, id);
+	  return true;
+	}
+	if (const Argument *a = dyn_cast<Argument> (&v))
+	  return getLocalKey (*a->getParent (), v, k);
+	if (const Instruction *I = dyn_cast<Instruction> (&v))
+	  return getLocalKey (*I->getParent ()->getParent (), v, k);
+	if (const ConstantExpr *ce = dyn_cast<ConstantExpr> (&v))
+	{
+	  if (fn && getLocalKey (*fn, v, k)) return true;
+	  const Function *user = getUserFunction (*ce);
+	  return user && getLocalKey (*user, v, k);
+	}
+	return false;
+      }
+
+      const Value *getValue (ValueKey k)
+      {
+	if (k.m_fn == 0) return getSymbol (k.m_idx);
+	if (k.m_fn > m_symbols.size ()) return nullptr;
+	const LocalIndex *li = getLocalIndex (k.m_fn - 1);
+	return li && k.m_idx < li->m_values.size () ? li->m_values [k.m_idx] : nullptr;
+      }
+    };
+
+    class WordWriter
+    {
+      std::vector<uint32_t> m_words;
+
+    public:
+
+      void put (uint32_t v) { m_words.push_back (v); }
+      void put (ValueKey k) { put (k.m_fn); put (k.m_idx); }
+      void put (const std::vector<uint32_t> &ws)
+      { m_words.insert (m_words.end (), ws.begin (), ws.end ()); }
+      /// length followed by the characters packed in words
+      void putString (StringRef str)
+      {
+	put (str.size ());
+	for (unsigned i = 0; i < str.size (); i += 4)
+	{
+	  uint32_t w = 0;
+	  for (unsigned j = 0; j < 4 && i + j < str.size (); ++j)
+	    w |= (uint32_t) (unsigned char) str [i + j] << (8 * j);
+	  put (w);
+	}
+      }
+      void put64 (uint64_t v) { put ((uint32_t) v); put ((uint32_t) (v >> 32)); }
+
+      unsigned size () const { return m_words.size (); }
+      void set (unsigned pos, uint32_t v) { m_words [pos] = v; }
+      const std::vector<uint32_t> &words () const { return m_words; }
+    };
+
+    /// Bound-checked reader of little-endian words
+    class WordReader
+    {
+      const unsigned char *m_begin;
+      const unsigned char *m_cur;
+      const unsigned char *m_end;
+      bool m_ok;
+
+    public:
+
+      WordReader (const char *begin, const char *end)
+	: m_begin ((const unsigned char*) begin),
+	  m_cur ((const unsigned char*) begin),
+	  m_end ((const unsigned char*) end), m_ok (true) {}
+
+      bool ok () const { return m_ok; }
+
+      /// number of words left
+      uint64_t remaining () const { return m_ok ? (m_end - m_cur) / 4 : 0; }
+
+      /// move to the given word
+      void seek (uint64_t word)
+      {
+	if (word * 4 > (uint64_t) (m_end - m_begin)) m_ok = false;
+	else m_cur = m_begin + word * 4;
+      }
+
+      uint32_t get ()
+      {
+	if (!m_ok || m_end - m_cur < 4) { m_ok = false; return 0; }
+	uint32_t v = (uint32_t) m_cur [0] | ((uint32_t) m_cur [1] << 8) |
+	  ((uint32_t) m_cur [2] << 16) | ((uint32_t) m_cur [3] << 24);
+	m_cur += 4;
+	return v;
+      }
+
+      ValueKey getKey ()
+      {
+	uint32_t fn = get ();
+	return ValueKey (fn, get ());
+      }
+
+      uint64_t get64 ()
+      {
+	uint64_t v = get ();
+	return v | ((uint64_t) get () << 32);
+      }
+
+      std::string getString ()
+      {
+	uint32_t len = get ();
+	std::string str;
+	uint32_t w = 0;
+	for (unsigned i = 0; i < len && m_ok; ++i)
+	{
+	  if (i % 4 == 0) w = get ();
+	  str.push_back ((char) ((w >> (8 * (i % 4))) & 0xff));
+	}
+	return str;
+      }
+    };
+
+    void writeWords (const std::vector<uint32_t> &ws, raw_ostream &o)
+    {
+      for (uint32_t v : ws)
+      {
+	char bytes [4] = {(char) (v & 0xff), (char) ((v >> 8) & 0xff),
+			  (char) ((v >> 16) & 0xff), (char) ((v >> 24) & 0xff)};
+	o.write (bytes, 4);
+      }
+    }
+
+    /// Structural encoding of types. Named structs are referenced by
+    /// name and resolved in the module at load time.
+    class TypeWriter
+    {
+      enum { PACKED = 0x1, LITERAL = 0x2, OPAQUE = 0x4, NAMED = 0x8 };
+
+      DenseMap<const Type*, unsigned> m_ids;
+      WordWriter m_table;
+      unsigned m_num;
+
+    public:
+
+      TypeWriter () : m_num (0) {}
+
+      unsigned getId (const Type *t)
+      {
+	auto it = m_ids.find (t);
+	if (it != m_ids.end ()) return it->second;
+
+	// -- children are written before their parents
+	std::vector<uint32_t> rec;
+	rec.push_back (t->getTypeID ());
+	switch (t->getTypeID ())
+	{
+	case Type::IntegerTyID:
+	  rec.push_back (cast<IntegerType> (t)->getBitWidth ());
+	  break;
+	case Type::PointerTyID:
+	  rec.push_back (getId (t->getPointerElementType ()));
+	  rec.push_back (t->getPointerAddressSpace ());
+	  break;
+	case Type::ArrayTyID:
+	{
+	  const ArrayType *at = cast<ArrayType> (t);
+	  rec.push_back (getId (at->getElementType ()));
+	  rec.push_back ((uint32_t) at->getNumElements ());
+	  rec.push_back ((uint32_t) (at->getNumElements () >> 32));
+	  break;
+	}
+	case Type::VectorTyID:
+	{
+	  const VectorType *vt = cast<VectorType> (t);
+	  rec.push_back (getId (vt->getElementType ()));
+	  rec.push_back (vt->getNumElements ());
+	  break;
+	}
+	case Type::FunctionTyID:
+	{
+	  const FunctionType *ft = cast<FunctionType> (t);
+	  rec.push_back (getId (ft->getReturnType ()));
+	  rec.push_back (ft->isVarArg ());
+	  rec.push_back (ft->getNumParams ());
+	  for (const Type *p : ft->params ()) rec.push_back (getId (p));
+	  break;
+	}
+	case Type::StructTyID:
+	{
+	  const StructType *st = cast<StructType> (t);
+	  uint32_t flags = st->isPacked () ? PACKED : 0;
+	  if (st->isLiteral ())
+	  {
+	    rec.push_back (flags | LITERAL);
+	    rec.push_back (st->getNumElements ());
+	    for (const Type *e : st->elements ()) rec.push_back (getId (e));
+	  }
+	  else if (st->hasName ())
+	  {
+	    StringRef name = st->getName ();
+	    rec.push_back (flags | NAMED);
+	    rec.push_back (name.size ());
+	    for (unsigned i = 0; i < name.size (); i += 4)
+	    {
+	      uint32_t w = 0;
+	      for (unsigned j = 0; j < 4 && i + j < name.size (); ++j)
+		w |= (uint32_t) (unsigned char) name [i + j] << (8 * j);
+	      rec.push_back (w);
+	    }
+	  }
+	  else
+	    // -- unnamed identified structs cannot be resolved
+	    rec.push_back (flags | OPAQUE);
+	  break;
+	}
+	default:
+	  // -- primitive types
+	  break;
+	}
+
+	m_table.put (rec.size ());
+	m_table.put (rec);
+	m_ids [t] = m_num;
+	return m_num++;
+      }
+
+      unsigned size () const { return m_num; }
+      const std::vector<uint32_t> &words () const { return m_table.words (); }
+
+      /// decode the types of a table written by TypeWriter. Types that
+      /// cannot be resolved are null.
+      static bool read (WordReader &r, Module &M, std::vector<Type*> &types)
+      {
+	LLVMContext &ctx = M.getContext ();
+	uint32_t num = r.get ();
+	types.reserve (num);
+	auto child = [&types] (uint32_t id) -> Type*
+	  { return id < types.size () ? types [id] : nullptr; };
+
+	for (unsigned i = 0; i < num && r.ok (); ++i)
+	{
+	  uint32_t len = r.get ();
+	  std::vector<uint32_t> rec;
+	  rec.reserve (len);
+	  for (unsigned j = 0; j < len; ++j) rec.push_back (r.get ());
+	  if (!r.ok () || rec.empty ()) return false;
+
+	  Type *t = nullptr;
+	  switch (rec [0])
+	  {
+	  case Type::IntegerTyID:
+	    if (rec.size () > 1) t = IntegerType::get (ctx, rec [1]);
+	    break;
+	  case Type::PointerTyID:
+	    if (rec.size () > 2 && child (rec [1]))
+	      t = PointerType::get (child (rec [1]), rec [2]);
+	    break;
+	  case Type::ArrayTyID:
+	    if (rec.size () > 3 && child (rec [1]))
+	      t = ArrayType::get (child (rec [1]),
+				  (uint64_t) rec [2] | ((uint64_t) rec [3] << 32));
+	    break;
+	  case Type::VectorTyID:
+	    if (rec.size () > 2 && child (rec [1]))
+	      t = VectorType::get (child (rec [1]), rec [2]);
+	    break;
+	  case Type::FunctionTyID:
+	  {
+	    if (rec.size () < 4 || rec.size () != 4 + rec [3]) break;
+	    Type *ret = child (rec [1]);
+	    std::vector<Type*> params;
+	    for (unsigned j = 4; j < rec.size (); ++j) params.push_back (child (rec [j]));
+	    if (ret && std::find (params.begin (), params.end (), nullptr) == params.end ())
+	      t = FunctionType::get (ret, params, rec [2]);
+	    break;
+	  }
+	  case Type::StructTyID:
+	  {
+	    if (rec.size () < 2) break;
+	    uint32_t flags = rec [1];
+	    if (flags & LITERAL)
+	    {
+	      if (rec.size () < 3 || rec.size () != 3 + rec [2]) break;
+	      std::vector<Type*> elems;
+	      for (unsigned j = 3; j < rec.size (); ++j) elems.push_back (child (rec [j]));
+	      if (std::find (elems.begin (), elems.end (), nullptr) == elems.end ())
+		t = StructType::get (ctx, elems, flags & PACKED);
+	    }
+	    else if (flags & NAMED)
+	    {
+	      if (rec.size () < 3) break;
+	      std::string name;
+	      for (unsigned j = 0; j < rec [2] && 3 + j / 4 < rec.size (); ++j)
+		name.push_back ((char) ((rec [3 + j / 4] >> (8 * (j % 4))) & 0xff));
+	      t = M.getTypeByName (name);
+	    }
+	    break;
+	  }
+	  default:
+	    if (rec [0] <= Type::X86_MMXTyID)
+	      t = Type::getPrimitiveType (ctx, (Type::TypeID) rec [0]);
+	    break;
+	  }
+	  types.push_back (t);
+	}
+	return r.ok ();
+      }
+    };
+
+    uint32_t packNodeType (const Node::NodeType &t)
+    {
+      uint32_t v = 0;
+      unsigned i = 0;
+      v |= t.shadow << i++;
+      v |= t.alloca << i++;
+      v |= t.heap << i++;
+      v |= t.global << i++;
+      v |= t.externFunc << i++;
+      v |= t.externGlobal << i++;
+      v |= t.unknown << i++;
+      v |= t.incomplete << i++;
+      v |= t.modified << i++;
+      v |= t.read << i++;
+      v |= t.array << i++;
+      v |= t.collapsed << i++;
+      v |= t.external << i++;
+      v |= t.inttoptr << i++;
+      v |= t.ptrtoint << i++;
+      v |= t.vastart << i++;
+      v |= t.dead << i++;
+      return v;
+    }
+
+    Node::NodeType unpackNodeType (uint32_t v)
+    {
+      Node::NodeType t;
+      unsigned i = 0;
+      t.shadow = (v >> i++) & 1;
+      t.alloca = (v >> i++) & 1;
+      t.heap = (v >> i++) & 1;
+      t.global = (v >> i++) & 1;
+      t.externFunc = (v >> i++) & 1;
+      t.externGlobal = (v >> i++) & 1;
+      t.unknown = (v >> i++) & 1;
+      t.incomplete = (v >> i++) & 1;
+      t.modified = (v >> i++) & 1;
+      t.read = (v >> i++) & 1;
+      t.array = (v >> i++) & 1;
+      t.collapsed = (v >> i++) & 1;
+      t.external = (v >> i++) & 1;
+      t.inttoptr = (v >> i++) & 1;
+      t.ptrtoint = (v >> i++) & 1;
+      t.vastart = (v >> i++) & 1;
+      t.dead = (v >> i++) & 1;
+      return t;
+    }
+  } // end namespace
+
+  /// Reads and writes the internals of a graph
+  class GraphSerializer
+  {
+    typedef DenseMap<const Node*, unsigned> NodeIdMap;
+
+    static void writeCell (const Cell &c, const NodeIdMap &ids, WordWriter &out)
+    {
+      out.put (ids.lookup (c.getNode ()));
+      out.put (c.getRawOffset ());
+    }
+
+    /// words of a node without types, links and allocation sites
+    static const unsigned NODE_MIN_WORDS = 11;
+
+    static bool readCell (WordReader &in, const std::vector<Node*> &nodes, Cell &c)
+    {
+      uint32_t id = in.get ();
+      uint32_t offset = in.get ();
+      if (!in.ok () || id >= nodes.size ()) return false;
+      c = Cell (nodes [id], offset);
+      return true;
+    }
+
+  public:
+
+    /// Layout of a graph:
+    ///   #nodes, nodes, #scalars, scalars, #formals, formals, #returns, returns
+    /// Layout of a node:
+    ///   id (2 words), flags, size, has unique scalar, unique scalar (3 words),
+    ///   #types, types, #links, links, #allocation sites, allocation sites
+    /// fn is the function of g, or one of them if g is shared.
+    /// Return the number of values that could not be written.
+    static unsigned writeGraph (const Graph &g, const Function &fn, ValueKeys &keys,
+				TypeWriter &types, WordWriter &out)
+    {
+      unsigned missed = 0;
+      NodeIdMap ids;
+      for (const Node &n : g)
+      {
+	unsigned id = ids.size ();
+	ids [&n] = id;
+      }
+
+      out.put (ids.size ());
+      for (const Node &n : g)
+      {
+	assert (!n.isForwarding ());
+	out.put64 (n.m_id);
+	out.put (packNodeType (n.m_nodeType));
+	out.put (n.m_size);
+
+	ValueKey k;
+	bool hasKey = n.m_unique_scalar && keys.getKey (*n.m_unique_scalar, &fn, k);
+	if (n.m_unique_scalar && !hasKey) ++missed;
+	out.put (n.m_has_unique_scalar);
+	out.put (hasKey);
+	out.put (k);
+
+	out.put (n.m_types.size ());
+	for (auto &kv : n.m_types)
+	{
+	  out.put (kv.first);
+	  std::vector<uint32_t> tys;
+	  for (const Type *t : kv.second) tys.push_back (types.getId (t));
+	  out.put (tys.size ());
+	  out.put (tys);
+	}
+
+	out.put (n.m_links.size ());
+	for (auto &kv : n.m_links)
+	{
+	  out.put (kv.first);
+	  writeCell (*kv.second, ids, out);
+	}
+
+	std::vector<ValueKey> sites;
+	for (const Value *v : n.m_alloca_sites)
+	  if (keys.getKey (*v, &fn, k)) sites.push_back (k);
+	  else ++missed;
+	out.put (sites.size ());
+	for (ValueKey s : sites) out.put (s);
+      }
+
+      // -- scalars, formals and returns: value key followed by a cell
+      unsigned pos = out.size ();
+      unsigned num = 0;
+      out.put (0);
+      for (auto &kv : g.m_values)
+      {
+	ValueKey k;
+	if (!keys.getKey (*kv.first, &fn, k)) { ++missed; continue; }
+	out.put (k);
+	writeCell (*kv.second, ids, out);
+	++num;
+      }
+      out.set (pos, num);
+
+      pos = out.size ();
+      num = 0;
+      out.put (0);
+      for (auto &kv : g.m_formals)
+      {
+	ValueKey k;
+	if (!keys.getKey (*kv.first, &fn, k)) { ++missed; continue; }
+	out.put (k);
+	writeCell (*kv.second, ids, out);
+	++num;
+      }
+      out.set (pos, num);
+
+      pos = out.size ();
+      num = 0;
+      out.put (0);
+      for (auto &kv : g.m_returns)
+      {
+	ValueKey k;
+	if (!keys.getKey (*kv.first, &fn, k)) { ++missed; continue; }
+	out.put (k);
+	writeCell (*kv.second, ids, out);
+	++num;
+      }
+      out.set (pos, num);
+
+      return missed;
+    }
+
+    /// Read a graph written by writeGraph into an empty graph g.
+    /// missing is increased by the number of values that are no
+    /// longer in the module. Return false if the input is malformed.
+    static bool readGraph (WordReader &in, ValueKeys &keys,
+			   const std::vector<Type*> &types, Graph &g,
+			   unsigned &missing)
+    {
+      auto getValue = [&] (ValueKey k) {
+	const Value *v = keys.getValue (k);
+	if (!v) ++missing;
+	return v;
+      };
+
+      uint32_t numNodes = in.get ();
+      // -- a node takes at least NODE_MIN_WORDS words so a larger
+      //    number of nodes cannot fit in what is left of the graph
+      if (!in.ok () || numNodes > in.remaining () / NODE_MIN_WORDS) return false;
+
+      std::vector<Node*> nodes;
+      nodes.reserve (numNodes);
+      for (unsigned i = 0; i < numNodes; ++i) nodes.push_back (&g.mkNode ());
+
+      for (Node *n : nodes)
+      {
+	uint64_t id = in.get64 ();
+	n->m_id = id;
+	// -- new nodes must not reuse the ids of loaded nodes
+	if (Node::m_id_factory < id) Node::m_id_factory = id;
+	n->m_nodeType = unpackNodeType (in.get ());
+	n->m_size = in.get ();
+
+	bool hasUnique = in.get ();
+	bool hasKey = in.get ();
+	ValueKey k = in.getKey ();
+	n->m_has_unique_scalar = hasUnique;
+	n->m_unique_scalar = hasKey ? getValue (k) : nullptr;
+
+	uint32_t numTypes = in.get ();
+	for (unsigned i = 0; i < numTypes && in.ok (); ++i)
+	{
+	  uint32_t offset = in.get ();
+	  uint32_t sz = in.get ();
+	  Graph::Set s = g.emptySet ();
+	  for (unsigned j = 0; j < sz && in.ok (); ++j)
+	  {
+	    uint32_t t = in.get ();
+	    if (t < types.size () && types [t]) s = g.mkSet (s, types [t]);
+	  }
+	  n->m_types.insert (std::make_pair (offset, s));
+	}
+
+	uint32_t numLinks = in.get ();
+	for (unsigned i = 0; i < numLinks && in.ok (); ++i)
+	{
+	  uint32_t offset = in.get ();
+	  Cell c;
+	  if (!readCell (in, nodes, c)) return false;
+	  n->m_links [offset].reset (new Cell (c));
+	}
+
+	uint32_t numSites = in.get ();
+	for (unsigned i = 0; i < numSites && in.ok (); ++i)
+	  if (const Value *v = getValue (in.getKey ()))
+	    n->m_alloca_sites.insert (v);
+      }
+
+      uint32_t numScalars = in.get ();
+      for (unsigned i = 0; i < numScalars && in.ok (); ++i)
+      {
+	const Value *v = getValue (in.getKey ());
+	Cell c;
+	if (!readCell (in, nodes, c)) return false;
+	if (v) g.m_values [v].reset (new Cell (c));
+      }
+
+      uint32_t numFormals = in.get ();
+      for (unsigned i = 0; i < numFormals && in.ok (); ++i)
+      {
+	const Argument *a = dyn_cast_or_null<Argument> (getValue (in.getKey ()));
+	Cell c;
+	if (!readCell (in, nodes, c)) return false;
+	if (a) g.m_formals [a].reset (new Cell (c));
+      }
+
+      uint32_t numReturns = in.get ();
+      for (unsigned i = 0; i < numReturns && in.ok (); ++i)
+      {
+	const Function *fn = dyn_cast_or_null<Function> (getValue (in.getKey ()));
+	Cell c;
+	if (!readCell (in, nodes, c)) return false;
+	if (fn) g.m_returns [fn].reset (new Cell (c));
+      }
+
+      return in.ok ();
+    }
+  };
+
+  namespace
+  {
+    const uint32_t NO_GRAPH = ~0U;
+
+    /// Per-function data used by the incremental analysis
+    struct Summary
+    {
+      uint64_t m_bu_hash;
+      uint32_t m_bu_graph;
+      uint64_t m_fingerprint;
+
+      Summary () : m_bu_hash (0), m_bu_graph (NO_GRAPH), m_fingerprint (0) {}
+    };
+  }
+
+  /// File layout:
+  ///   header: magic, version, kind, #graphs, #function entries,
+  ///           #summaries, symbol table offset, type table offset
+  ///   function table: (symbol, graph id)
+  ///   graph table: (offset, size) in words for each graph
+  ///   summary table: (symbol, bottom-up hash, bottom-up graph id,
+  ///                   fingerprint) where hashes take two words
+  ///   graphs
+  ///   symbol table: #symbols followed by the names of the global values
+  ///   type table: #types followed by the types
+  class GraphFileWriter
+  {
+    ValueKeys m_keys;
+    TypeWriter m_types;
+    WordWriter m_body;
+    std::vector<std::pair<uint32_t, uint32_t> > m_graphs;
+    std::vector<std::pair<uint32_t, uint32_t> > m_fns;
+    std::vector<std::pair<uint32_t, Summary> > m_summaries;
+    unsigned m_missed;
+
+  public:
+
+    GraphFileWriter (const Module &M) : m_keys (M), m_missed (0) {}
+
+    /// Serialize the graph g of fn and return its id. g cannot have
+    /// forwarding nodes.
+    uint32_t addGraph (const Graph &g, const Function &fn)
+    {
+      unsigned start = m_body.size ();
+      m_missed += GraphSerializer::writeGraph (g, fn, m_keys, m_types, m_body);
+      m_graphs.push_back (std::make_pair (start, m_body.size () - start));
+      return m_graphs.size () - 1;
+    }
+
+    void addFunction (const Function &fn, uint32_t graph)
+    {
+      uint32_t sym;
+      if (m_keys.getSymbolId (fn, sym))
+	m_fns.push_back (std::make_pair (sym, graph));
+    }
+
+    void addSummary (const Function &fn, const Summary &summary)
+    {
+      uint32_t sym;
+      if (m_keys.getSymbolId (fn, sym))
+	m_summaries.push_back (std::make_pair (sym, summary));
+    }
+
+    void write (GlobalAnalysisKind kind, raw_ostream &o)
+    {
+      unsigned bodyStart = HEADER_SIZE + 2 * m_fns.size () +
+	2 * m_graphs.size () + 6 * m_summaries.size ();
+
+      WordWriter symbols;
+      symbols.put (m_keys.numSymbols ());
+      for (unsigned i = 0; i < m_keys.numSymbols (); ++i)
+	symbols.putString (m_keys.getSymbol (i)->getName ());
+
+      WordWriter out;
+      out.put (MAGIC);
+      out.put (VERSION);
+      out.put (kind);
+      out.put (m_graphs.size ());
+      out.put (m_fns.size ());
+      out.put (m_summaries.size ());
+      out.put (bodyStart + m_body.size ());
+      out.put (bodyStart + m_body.size () + symbols.size ());
+      assert (out.size () == HEADER_SIZE);
+      for (auto &kv : m_fns) { out.put (kv.first); out.put (kv.second); }
+      for (auto &kv : m_graphs) { out.put (bodyStart + kv.first); out.put (kv.second); }
+      for (auto &kv : m_summaries)
+      {
+	out.put (kv.first);
+	out.put64 (kv.second.m_bu_hash);
+	out.put (kv.second.m_bu_graph);
+	out.put64 (kv.second.m_fingerprint);
+      }
+      assert (out.size () == bodyStart);
+
+      WordWriter types;
+      types.put (m_types.size ());
+
+      writeWords (out.words (), o);
+      writeWords (m_body.words (), o);
+      writeWords (symbols.words (), o);
+      writeWords (types.words (), o);
+      writeWords (m_types.words (), o);
+      o.flush ();
+
+      if (m_missed > 0)
+	diags () << "WARNING: " << m_missed
+		<< " values could not be serialized and they will be missing\n";
+    }
+
+    /// Write into filename through a temporary file so that a
+    /// previous version of filename that is still mapped in memory
+    /// is not modified.
+    bool write (GlobalAnalysisKind kind, const std::string &filename)
+    {
+      std::string tmp = filename + ".tmp";
+      {
+	std::error_code EC;
+	raw_fd_ostream o (tmp, EC, sys::fs::F_None);
+	if (EC)
+	{
+	  diags () << "ERROR: cannot open " << tmp << ": " << EC.message () << "\n";
+	  return false;
+	}
+	write (kind, o);
+      }
+      if (std::error_code EC = sys::fs::rename (tmp, filename))
+      {
+	diags () << "ERROR: cannot write " << filename << ": " << EC.message () << "\n";
+	return false;
+      }
+      return true;
+    }
+  };
+
+  static void addGraphs (const Module &M, GlobalAnalysis &ga, GraphFileWriter &w)
+  {
+    DenseMap<const Graph*, uint32_t> graphIds;
+    for (const Function &fn : M)
+    {
+      if (fn.isDeclaration () || !ga.hasGraph (fn)) continue;
+
+      Graph &g = ga.getGraph (fn);
+      auto it = graphIds.find (&g);
+      if (it == graphIds.end ())
+      {
+	// -- no forwarding nodes are written
+	g.compress ();
+	it = graphIds.insert (std::make_pair (&g, w.addGraph (g, fn))).first;
+      }
+      w.addFunction (fn, it->second);
+    }
+  }
+
+  bool writeGraphs (const Module &M, GlobalAnalysis &ga, raw_ostream &o)
+  {
+    GraphFileWriter w (M);
+    addGraphs (M, ga, w);
+    w.write (ga.kind (), o);
+    return true;
+  }
+
+  bool writeGraphs (const Module &M, GlobalAnalysis &ga, const std::string &filename)
+  {
+    GraphFileWriter w (M);
+    addGraphs (M, ga, w);
+    return w.write (ga.kind (), filename);
+  }
+
+  /// Graphs of a file written by GraphFileWriter that are decoded on
+  /// demand. A graph returned by getGraph is kept until the store is
+  /// destroyed. A graph only acquired through handles can be evicted
+  /// once all its handles are released: at most m_max_graphs graphs
+  /// are kept in memory if possible (0 means no bound) and the least
+  /// recently released graph is evicted first.
+  class GraphStore
+  {
+    typedef std::shared_ptr<Graph> GraphRef;
+    typedef std::list<uint32_t> LruList;
+
+    struct Entry
+    {
+      uint32_t m_offset;
+      uint32_t m_size;
+      GraphRef m_graph;
+      // -- in m_lru iff the graph is loaded, not kept and not acquired
+      LruList::iterator m_lru;
+      // -- number of handles of the graph
+      unsigned m_refs;
+      // -- the graph was returned by getGraph
+      bool m_kept;
+    };
+
+    std::string m_filename;
+    const DataLayout &m_dl;
+    Graph::SetFactory &m_setFactory;
+    std::unique_ptr<MemoryBuffer> m_buffer;
+    ValueKeys m_keys;
+    std::vector<Type*> m_types;
+    std::vector<Entry> m_entries;
+    DenseMap<const Function*, uint32_t> m_fn_graphs;
+    DenseMap<const Function*, Summary> m_summaries;
+    LruList m_lru;
+    unsigned m_max_graphs;
+    unsigned m_loaded;
+
+    void evict ()
+    {
+      while (m_max_graphs > 0 && m_loaded > m_max_graphs && !m_lru.empty ())
+      {
+	Entry &e = m_entries [m_lru.back ()];
+	e.m_graph.reset ();
+	e.m_lru = m_lru.end ();
+	m_lru.pop_back ();
+	--m_loaded;
+      }
+    }
+
+    /// Decode the graph with the given id if it is not in memory. The
+    /// graph is taken out of m_lru: the caller keeps or acquires it.
+    Entry &load (uint32_t id)
+    {
+      Entry &e = m_entries [id];
+      if (e.m_lru != m_lru.end ())
+      {
+	m_lru.erase (e.m_lru);
+	e.m_lru = m_lru.end ();
+      }
+      if (!e.m_graph)
+      {
+	e.m_graph = readGraph (id);
+	++m_loaded;
+	LOG ("dsa-serialize",
+	     logs () << "Loaded graph " << id << "\n";);
+      }
+      return e;
+    }
+
+  public:
+
+    GraphStore (const std::string &filename, Module &M,
+		const DataLayout &dl, Graph::SetFactory &setFactory,
+		std::unique_ptr<MemoryBuffer> buffer, unsigned maxGraphs)
+      : m_filename (filename), m_dl (dl), m_setFactory (setFactory),
+	m_buffer (std::move (buffer)), m_keys (M), m_max_graphs (maxGraphs),
+	m_loaded (0) {}
+
+    /// Read the header, the tables, the symbols and the types. Graphs
+    /// are not decoded. Return the kind of the stored analysis.
+    bool open (Module &M, GlobalAnalysisKind &kind)
+    {
+      WordReader in (m_buffer->getBufferStart (), m_buffer->getBufferEnd ());
+      uint32_t magic = in.get ();
+      uint32_t version = in.get ();
+      uint32_t k = in.get ();
+      uint32_t numGraphs = in.get ();
+      uint32_t numEntries = in.get ();
+      uint32_t numSummaries = in.get ();
+      uint32_t symbolTableOffset = in.get ();
+      uint32_t typeTableOffset = in.get ();
+      if (!in.ok () || magic != MAGIC || version != VERSION || k > HYBRID)
+      {
+	diags () << "ERROR: " << m_filename << " is not a Dsa graph file\n";
+	return false;
+      }
+      kind = (GlobalAnalysisKind) k;
+
+      std::vector<std::pair<uint32_t, uint32_t> > fnTable;
+      for (unsigned i = 0; i < numEntries && in.ok (); ++i)
+      {
+	uint32_t sym = in.get ();
+	fnTable.push_back (std::make_pair (sym, in.get ()));
+      }
+
+      // -- each graph takes two words in the graph table
+      if (!in.ok () || numGraphs > in.remaining () / 2)
+      {
+	diags () << "ERROR: " << m_filename << " is malformed\n";
+	return false;
+      }
+      m_entries.resize (numGraphs);
+      for (Entry &e : m_entries)
+      {
+	e.m_offset = in.get ();
+	e.m_size = in.get ();
+	e.m_lru = m_lru.end ();
+	e.m_refs = 0;
+	e.m_kept = false;
+      }
+
+      std::vector<std::pair<uint32_t, Summary> > summaries;
+      for (unsigned i = 0; i < numSummaries && in.ok (); ++i)
+      {
+	uint32_t sym = in.get ();
+	Summary s;
+	s.m_bu_hash = in.get64 ();
+	s.m_bu_graph = in.get ();
+	s.m_fingerprint = in.get64 ();
+	summaries.push_back (std::make_pair (sym, s));
+      }
+
+      in.seek (symbolTableOffset);
+      uint32_t numNames = in.get ();
+      // -- each name takes at least one word
+      if (!in.ok () || numNames > in.remaining ())
+      {
+	diags () << "ERROR: " << m_filename << " is malformed\n";
+	return false;
+      }
+      std::vector<std::string> names (numNames);
+      for (unsigned i = 0; i < names.size () && in.ok (); ++i)
+	names [i] = in.getString ();
+
+      in.seek (typeTableOffset);
+      if (!in.ok () || !TypeWriter::read (in, M, m_types))
+      {
+	diags () << "ERROR: " << m_filename << " is malformed\n";
+	return false;
+      }
+
+      // -- functions that are not in M anymore are ignored
+      m_keys.resolve (names);
+      for (auto &kv : fnTable)
+	if (const Function *fn = m_keys.getFunction (kv.first))
+	  if (kv.second < numGraphs) m_fn_graphs [fn] = kv.second;
+      for (auto &kv : summaries)
+	if (const Function *fn = m_keys.getFunction (kv.first))
+	{
+	  if (kv.second.m_bu_graph >= numGraphs) kv.second.m_bu_graph = NO_GRAPH;
+	  m_summaries [fn] = kv.second;
+	}
+      return true;
+    }
+
+    bool hasGraph (const Function &fn) const
+    { return m_fn_graphs.count (&fn) > 0; }
+
+    bool getGraphId (const Function &fn, uint32_t &id) const
+    {
+      auto it = m_fn_graphs.find (&fn);
+      if (it == m_fn_graphs.end ()) return false;
+      id = it->second;
+      return true;
+    }
+
+    bool getSummary (const Function &fn, Summary &s) const
+    {
+      auto it = m_summaries.find (&fn);
+      if (it == m_summaries.end ()) return false;
+      s = it->second;
+      return true;
+    }
+
+    /// Decode a new copy of the graph with the given id. If missing
+    /// is not null then it is set to the number of values of the
+    /// graph that are no longer in the module.
+    GraphRef readGraph (uint32_t id, unsigned *missing = nullptr)
+    {
+      assert (id < m_entries.size ());
+      GraphRef g = std::make_shared<Graph> (m_dl, m_setFactory);
+      // -- the reader cannot go past the end of the graph
+      const Entry &e = m_entries [id];
+      uint64_t end = ((uint64_t) e.m_offset + e.m_size) * 4;
+      const char *begin = m_buffer->getBufferStart ();
+      bool inBounds = end <= m_buffer->getBufferSize ();
+      WordReader in (begin, inBounds ? begin + end : begin);
+      in.seek (e.m_offset);
+      unsigned numMissing = 0;
+      if (!inBounds || !GraphSerializer::readGraph (in, m_keys, m_types, *g, numMissing))
+      {
+	diags () << "ERROR: " << m_filename << " is malformed. "
+		<< "Graph " << id << " is incomplete.\n";
+      }
+      if (missing) *missing = numMissing;
+      return g;
+    }
+
+    Graph &getGraph (const Function &fn)
+    {
+      auto it = m_fn_graphs.find (&fn);
+      assert (it != m_fn_graphs.end ());
+      Entry &e = load (it->second);
+      e.m_kept = true;
+      evict ();
+      return *e.m_graph;
+    }
+
+    /// The graph of fn until release is called with the returned id
+    const Graph &acquire (const Function &fn, uint32_t &id)
+    {
+      auto it = m_fn_graphs.find (&fn);
+      assert (it != m_fn_graphs.end ());
+      id = it->second;
+      Entry &e = load (id);
+      ++e.m_refs;
+      evict ();
+      return *e.m_graph;
+    }
+
+    void release (uint32_t id)
+    {
+      Entry &e = m_entries [id];
+      assert (e.m_refs > 0);
+      if (--e.m_refs > 0 || e.m_kept) return;
+      m_lru.push_front (id);
+      e.m_lru = m_lru.begin ();
+      evict ();
+    }
+
+    /// The address of the entry of the graph with the given id
+    const void *getKey (uint32_t id) const { return &m_entries [id]; }
+
+    /// The id of the graph whose entry is at key
+    uint32_t getId (const void *key) const
+    { return static_cast<const Entry*> (key) - &m_entries [0]; }
+
+    unsigned numLoadedGraphs () const { return m_loaded; }
+
+    bool canEvict () const { return m_max_graphs > 0; }
+  };
+
+  static std::unique_ptr<GraphStore>
+  openGraphStore (const std::string &filename, Module &M,
+		  const DataLayout &dl, Graph::SetFactory &setFactory,
+		  unsigned maxGraphs, GlobalAnalysisKind &kind)
+  {
+    std::unique_ptr<GraphStore> res;
+    ErrorOr<std::unique_ptr<MemoryBuffer> > buf =
+      MemoryBuffer::getFile (filename, -1, false);
+    if (!buf)
+    {
+      diags () << "ERROR: cannot open " << filename << ": "
+	      << buf.getError ().message () << "\n";
+      return res;
+    }
+
+    res.reset (new GraphStore (filename, M, dl, setFactory, std::move (*buf), maxGraphs));
+    if (!res->open (M, kind)) res.reset ();
+    return res;
+  }
+
+  SerializedGlobalAnalysis::SerializedGlobalAnalysis (GlobalAnalysisKind kind,
+						      std::unique_ptr<GraphStore> store)
+    : GlobalAnalysis (kind), m_store (std::move (store)) {}
+
+  SerializedGlobalAnalysis::~SerializedGlobalAnalysis () {}
+
+  std::unique_ptr<SerializedGlobalAnalysis>
+  SerializedGlobalAnalysis::load (const std::string &filename, Module &M,
+				  const DataLayout &dl, SetFactory &setFactory,
+				  unsigned maxGraphs)
+  {
+    std::unique_ptr<SerializedGlobalAnalysis> res;
+    GlobalAnalysisKind kind;
+    std::unique_ptr<GraphStore> store =
+      openGraphStore (filename, M, dl, setFactory, maxGraphs, kind);
+    if (store)
+      res.reset (new SerializedGlobalAnalysis (kind, std::move (store)));
+    return res;
+  }
+
+  const Graph &SerializedGlobalAnalysis::getGraph (const Function &fn) const
+  { return m_store->getGraph (fn); }
+
+  Graph &SerializedGlobalAnalysis::getGraph (const Function &fn)
+  { return m_store->getGraph (fn); }
+
+  bool SerializedGlobalAnalysis::hasGraph (const Function &fn) const
+  { return m_store->hasGraph (fn); }
+
+  GraphHandle SerializedGlobalAnalysis::getGraphHandle (const Function &fn) const
+  {
+    uint32_t id;
+    const Graph &g = m_store->acquire (fn, id);
+    return GraphHandle (this, g, m_store->getKey (id));
+  }
+
+  void SerializedGlobalAnalysis::releaseGraph (const void *key) const
+  { m_store->release (m_store->getId (key)); }
+
+  bool SerializedGlobalAnalysis::canEvictGraphs () const
+  { return m_store->canEvict (); }
+
+  unsigned SerializedGlobalAnalysis::numLoadedGraphs () const
+  { return m_store->numLoadedGraphs (); }
+
+  /// INCREMENTAL ANALYSIS
+
+  IncrementalCache::IncrementalCache (const std::string &filename, Module &M,
+				      const DataLayout &dl, SetFactory &setFactory)
+    : m_filename (filename), m_M (M), m_next (new GraphFileWriter (M))
+  {
+    // -- no previous results: everything is recomputed
+    if (!sys::fs::exists (filename)) return;
+
+    GlobalAnalysisKind kind;
+    m_prev = openGraphStore (filename, M, dl, setFactory, 0, kind);
+    if (!m_prev)
+      diags () << "WARNING: ignoring previous Dsa results in " << filename << "\n";
+  }
+
+  IncrementalCache::~IncrementalCache () {}
+
+  IncrementalCache::GraphRef
+  IncrementalCache::getBottomUpGraph (const Function &fn, uint64_t hash)
+  {
+    Summary s;
+    if (!m_prev || !m_prev->getSummary (fn, s) ||
+	s.m_bu_hash != hash || s.m_bu_graph == NO_GRAPH)
+      return nullptr;
+    return m_prev->readGraph (s.m_bu_graph);
+  }
+
+  void IncrementalCache::addBottomUpGraph (const Function &fn, uint64_t hash,
+					   const Graph &g)
+  {
+    // -- the graph is serialized right away because it will be
+    //    modified by the rest of the analysis
+    auto it = m_bu_ids.find (&g);
+    if (it == m_bu_ids.end ())
+      it = m_bu_ids.insert (std::make_pair (&g, m_next->addGraph (g, fn))).first;
+    m_bu [&fn] = std::make_pair (hash, it->second);
+  }
+
+  IncrementalCache::GraphRef
+  IncrementalCache::getGraph (const Function &fn, uint64_t hash)
+  {
+    Summary s;
+    uint32_t id;
+    if (!m_prev || !m_prev->getSummary (fn, s) ||
+	s.m_bu_hash != hash || !m_prev->getGraphId (fn, id))
+      return nullptr;
+
+    // -- functions that shared a graph still share it
+    GraphRef &g = m_finals [id];
+    if (!g)
+    {
+      unsigned missing;
+      g = m_prev->readGraph (id, &missing);
+      // -- the graph refers to values of edited functions that are
+      //    gone so it is out of date
+      if (missing > 0) g.reset ();
+    }
+    return g;
+  }
+
+  bool IncrementalCache::hasFingerprint (const Function &fn, uint64_t fp)
+  {
+    Summary s;
+    return m_prev && m_prev->getSummary (fn, s) && s.m_fingerprint == fp;
+  }
+
+  void IncrementalCache::addFingerprint (const Function &fn, uint64_t fp)
+  { m_fingerprints [&fn] = fp; }
+
+  bool IncrementalCache::save (GlobalAnalysis &ga)
+  {
+    addGraphs (m_M, ga, *m_next);
+    for (const Function &fn : m_M)
+    {
+      auto bu = m_bu.find (&fn);
+      if (bu == m_bu.end ()) continue;
+
+      Summary s;
+      s.m_bu_hash = bu->second.first;
+      s.m_bu_graph = bu->second.second;
+      s.m_fingerprint = m_fingerprints.lookup (&fn);
+      m_next->addSummary (fn, s);
+    }
+    return m_next->write (ga.kind (), m_filename);
+  }
+}
@@ -0,0 +1,139 @@
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "sea_dsa/ShapeProfile.hh"
+#include "sea_dsa/Graph.hh"
+#include "sea_dsa/Global.hh"
+#include "sea_dsa/support/Debug.h"
+
+#include "boost/container/flat_set.hpp"
+
+#include <iterator>
+
+static llvm::cl::opt<std::string>
+ShapeStatsToFile("sea-dsa-shape-stats-to-file",
+		 llvm::cl::desc("DSA: write distributions of the shape of the graphs into a JSON file"),
+		 llvm::cl::init(""),
+		 llvm::cl::value_desc("FILE"));
+
+using namespace llvm;
+
+namespace sea_dsa {
+
+  const char *shapeMetricName (ShapeMetric m) {
+    switch (m) {
+    case SHAPE_NODES_PER_GRAPH:      return "nodes_per_graph";
+    case SHAPE_LINKS_PER_NODE:       return "links_per_node";
+    case SHAPE_OFFSETS_PER_NODE:     return "offsets_per_node";
+    case SHAPE_TYPE_SET_SIZE:        return "type_set_size";
+    case SHAPE_ALLOC_SITES_PER_NODE: return "alloc_sites_per_node";
+    case SHAPE_FORWARDING_CHAIN:     return "forwarding_chain_length";
+    case SHAPE_CLONE_SIZE:           return "clone_size";
+    case SHAPE_SCC_GROWTH:           return "scc_growth";
+    default:                         return "unknown";
+    }
+  }
+
+  // -- index of the bucket of v: 0 for 0, k for [2^(k-1), 2^k)
+  static unsigned bucket (uint64_t v) {
+    unsigned k = 0;
+    while (v) { v >>= 1; ++k; }
+    return k;
+  }
+
+  void Histogram::add (uint64_t v) {
+    unsigned b = bucket (v);
+    if (m_buckets.size () <= b) m_buckets.resize (b + 1, 0);
+    m_buckets [b]++;
+    if (m_count == 0 || v < m_min) m_min = v;
+    if (v > m_max) m_max = v;
+    m_count++;
+    m_sum += v;
+  }
+
+  void Histogram::writeJSON (raw_ostream &o) const {
+    o << "{\"count\":" << m_count << ",\"sum\":" << m_sum
+      << ",\"min\":" << m_min << ",\"max\":" << m_max;
+    if (m_count > 0)
+      o << format (",\"mean\":%.3f", (double) m_sum / m_count);
+    o << ",\"buckets\":[";
+    bool first = true;
+    for (unsigned b = 0; b < m_buckets.size (); ++b) {
+      if (m_buckets [b] == 0) continue;
+      uint64_t lo = b == 0 ? 0 : (uint64_t) 1 << (b - 1);
+      uint64_t hi = b == 0 ? 0 : ((uint64_t) 1 << b) - 1;
+      if (!first) o << ",";
+      first = false;
+      o << "{\"lo\":" << lo << ",\"hi\":" << hi << ",\"count\":" << m_buckets [b] << "}";
+    }
+    o << "]}";
+  }
+
+  ShapeProfile::CloneScope::CloneScope ()
+    : m_last_id (0), m_active (isEnabled ()) {
+    if (m_active) m_last_id = Node::getLastId ();
+  }
+
+  ShapeProfile::CloneScope::~CloneScope () {
+    if (m_active) get ().record (SHAPE_CLONE_SIZE, Node::getLastId () - m_last_id);
+  }
+
+  bool ShapeProfile::isEnabled ()
+  { return !ShapeStatsToFile.empty (); }
+
+  ShapeProfile &ShapeProfile::get () {
+    static thread_local ShapeProfile profile;
+    return profile;
+  }
+
+  void ShapeProfile::addGraph (const Graph &g) {
+    record (SHAPE_NODES_PER_GRAPH, std::distance (g.begin (), g.end ()));
+    for (const Node &n : g) {
+      record (SHAPE_LINKS_PER_NODE, n.links ().size ());
+      record (SHAPE_ALLOC_SITES_PER_NODE, n.getAllocSites ().size ());
+
+      // -- offsets with a type or a link
+      boost::container::flat_set<unsigned> offsets;
+      for (auto &kv : n.types ()) {
+	offsets.insert (kv.first);
+	record (SHAPE_TYPE_SET_SIZE, std::distance (kv.second.begin (), kv.second.end ()));
+      }
+      for (auto &kv : n.links ()) offsets.insert (kv.first);
+      record (SHAPE_OFFSETS_PER_NODE, offsets.size ());
+    }
+  }
+
+  void ShapeProfile::writeJSON (raw_ostream &o) const {
+    o << "{";
+    for (unsigned m = 0; m < NUM_SHAPE_METRICS; ++m) {
+      if (m > 0) o << ",";
+      o << "\n \"" << shapeMetricName ((ShapeMetric) m) << "\":";
+      m_metrics [m].writeJSON (o);
+    }
+    o << "\n}\n";
+  }
+
+  void ShapeProfile::writeToFile (const Module &M, const GlobalAnalysis &ga) {
+    if (ShapeStatsToFile.empty ()) return;
+
+    // -- graphs shared by several functions are measured once
+    boost::container::flat_set<const void*> seen;
+    for (auto &F : M) {
+      if (!ga.hasGraph (F)) continue;
+      GraphHandle g = ga.getGraphHandle (F);
+      if (seen.insert (g.getKey ()).second)
+	addGraph (*g);
+    }
+
+    std::error_code EC;
+    raw_fd_ostream file (ShapeStatsToFile, EC, sys::fs::F_Text);
+    if (EC) {
+      diags () << "WARNING: cannot open " << ShapeStatsToFile << "\n";
+      return;
+    }
+    writeJSON (file);
+  }
+}
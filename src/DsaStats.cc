@@ -1,11 +1,22 @@
 #include "llvm/IR/Module.h"
 #include "llvm/Pass.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/CommandLine.h"
 
 #include "sea_dsa/Info.hh"
 #include "sea_dsa/Graph.hh"
+#include "sea_dsa/Global.hh"
+#include "sea_dsa/FrozenGraph.hh"
+#include "sea_dsa/CollapseProfile.hh"
+#include "sea_dsa/FixpointProfile.hh"
+#include "sea_dsa/PhaseTimers.hh"
 // #include "ufo/Stats.hh"
 
+static llvm::cl::opt<unsigned>
+MemoryTop("sea-dsa-stats-memory-top",
+	  llvm::cl::desc("DSA: number of largest graphs reported by the stats"),
+	  llvm::cl::init(5));
+
 namespace sea_dsa {
 
   using namespace llvm;
@@ -120,12 +131,52 @@ namespace sea_dsa {
   }
   
   
+  static void printMemoryUsage (const Module &M, const DsaInfo &dsa_info, llvm::raw_ostream &o) {
+    const GlobalAnalysis &ga = dsa_info.getGlobalAnalysis ();
+    o << " --- Memory usage information\n";
+    ga.memoryUsage (M).write (o);
+    if (ga.mappersMemoryUsage () > 0)
+      o << "\t" << ga.mappersMemoryUsage ()
+	<< " bytes of simulation mappers (freed at the end of the analysis)\n";
+    
+    // -- functions sharing a graph are reported together
+    typedef std::pair<uint64_t, std::string> entry_t;
+    std::vector<entry_t> graphs;
+    DenseMap<const void*, unsigned> index;
+    uint64_t frozen = 0;
+    for (auto &F : M) {
+      if (!ga.hasGraph (F)) continue;
+      GraphHandle g = ga.getGraphHandle (F);
+      auto it = index.find (g.getKey ());
+      if (it != index.end ()) {
+	graphs [it->second].second += "," + F.getName ().str ();
+	continue;
+      }
+      index [g.getKey ()] = graphs.size ();
+      graphs.push_back (entry_t (g->memoryUsage ().total (), F.getName ().str ()));
+      frozen += ga.getFrozenGraph (F)->memoryUsage ();
+    }
+    o << "\t" << frozen << " bytes of the graphs as FrozenGraph snapshots\n";
+    std::stable_sort (graphs.begin (), graphs.end (),
+		      [] (const entry_t &e1, const entry_t &e2)
+		      { return e1.first > e2.first; });
+    
+    o << "\t Summary of the " << MemoryTop << " largest graphs:\n";
+    for (unsigned i = 0; i < graphs.size () && i < MemoryTop; ++i)
+      o << "\t  " << graphs [i].first << " bytes: " << graphs [i].second << "\n";
+  }
+  
   class DsaPrintStats: public ModulePass {
   public:
     
     static char ID;
     
-    DsaPrintStats (): ModulePass (ID) {}
+    // stream where the stats are printed
+    raw_ostream &m_o;
+    
+    DsaPrintStats (): ModulePass (ID), m_o (errs ()) {}
+    
+    DsaPrintStats (raw_ostream &o): ModulePass (ID), m_o (o) {}
     
     void getAnalysisUsage (AnalysisUsage &AU) const override {
       AU.addRequired<DsaInfoPass>();
@@ -146,11 +197,18 @@ namespace sea_dsa {
       auto dsa_nodes = dsa_info.live_nodes ();
       auto const &dsa_alloc_sites = dsa_info.alloc_sites ();
       
-      errs() << " ========== Begin SeaHorn Dsa info  ==========\n";
-      printMemAccesses (dsa_nodes, errs());
-      printMemTypes (dsa_nodes, errs());
-      printAllocSites  (dsa_nodes, dsa_alloc_sites, errs());
-      errs() << " ========== End SeaHorn Dsa info  ==========\n";
+      m_o << " ========== Begin SeaHorn Dsa info  ==========\n";
+      printMemAccesses (dsa_nodes, m_o);
+      printMemTypes (dsa_nodes, m_o);
+      printAllocSites  (dsa_nodes, dsa_alloc_sites, m_o);
+      printMemoryUsage (M, dsa_info, m_o);
+      if (CollapseProfile::isEnabled ())
+	CollapseProfile::get ().printSummary (m_o);
+      if (FixpointProfile::isEnabled ())
+	FixpointProfile::get ().printSummary (m_o);
+      if (PhaseTimers::isEnabled ())
+	PhaseTimers::get ().printSummary (m_o);
+      m_o << " ========== End SeaHorn Dsa info  ==========\n";
       
       return false;
     }
@@ -166,6 +224,10 @@ namespace sea_dsa {
     return new DsaPrintStats ();
   }
   
+  Pass *createDsaPrintStatsPass (raw_ostream &o) {
+    return new DsaPrintStats (o);
+  }
+  
 } // end namespace sea_dsa
 
 static llvm::RegisterPass<sea_dsa::DsaPrintStats> 
@@ -0,0 +1,261 @@
+#include "llvm/IR/Type.h"
+#include "llvm/IR/Value.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalAlias.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "sea_dsa/FrozenGraph.hh"
+
+#include "boost/range/iterator_range.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <map>
+
+using namespace llvm;
+
+namespace sea_dsa {
+
+  namespace {
+    // Positions of the values of some functions in their module: the
+    // functions in module order and, for each of them, the function,
+    // its arguments, its instructions and the constants they use in
+    // the order of their first use (including the global values
+    // reached through initializers).
+    class ModuleOrder {
+      DenseMap<const Value*, unsigned> m_pos;
+
+      void add (const Value *v) {
+	unsigned pos = m_pos.size ();
+	m_pos.insert (std::make_pair (v, pos));
+      }
+
+      void visit (const Value *v) {
+	if (!isa<Constant> (v) || m_pos.count (v)) return;
+	add (v);
+	if (const GlobalVariable *gv = dyn_cast<GlobalVariable> (v)) {
+	  if (gv->hasInitializer ()) visit (gv->getInitializer ());
+	} else if (const GlobalAlias *ga = dyn_cast<GlobalAlias> (v))
+	  visit (ga->getAliasee ());
+	else if (!isa<GlobalValue> (v))
+	  for (const Value *op : cast<Constant> (v)->operands ()) visit (op);
+      }
+
+    public:
+
+      explicit ModuleOrder (std::vector<const Function*> fns) {
+	if (fns.size () > 1) {
+	  DenseMap<const Function*, unsigned> fnPos;
+	  unsigned pos = 0;
+	  for (const Function &f : *fns.front ()->getParent ())
+	    fnPos [&f] = pos++;
+	  std::sort (fns.begin (), fns.end (),
+		     [&fnPos] (const Function *f1, const Function *f2)
+		     { return fnPos.lookup (f1) < fnPos.lookup (f2); });
+	}
+	for (const Function *fn : fns) {
+	  add (fn);
+	  for (const Argument &a : fn->args ()) add (&a);
+	  for (const BasicBlock &bb : *fn)
+	    for (const Instruction &I : bb) {
+	      add (&I);
+	      for (const Value *op : I.operands ()) visit (op);
+	    }
+	}
+      }
+
+      // Values not reached come after all the others, by name
+      bool less (const Value *v1, const Value *v2) const {
+	auto it1 = m_pos.find (v1), it2 = m_pos.find (v2);
+	unsigned p1 = it1 == m_pos.end () ? UINT_MAX : it1->second;
+	unsigned p2 = it2 == m_pos.end () ? UINT_MAX : it2->second;
+	if (p1 != p2) return p1 < p2;
+	if (p1 != UINT_MAX) return false;
+	return v1->getName () < v2->getName ();
+      }
+    };
+
+    const Function *getParentFunction (const Value *v) {
+      if (const Argument *a = dyn_cast<Argument> (v)) return a->getParent ();
+      if (const Instruction *I = dyn_cast<Instruction> (v))
+	return I->getParent ()->getParent ();
+      return nullptr;
+    }
+
+    // Positions of the entries of v sorted by key
+    template <typename Entry>
+    void buildIndex (const std::vector<Entry> &v, std::vector<uint32_t> &index) {
+      index.resize (v.size ());
+      for (unsigned i = 0; i < v.size (); ++i) index [i] = i;
+      std::sort (index.begin (), index.end (),
+		 [&v] (uint32_t i1, uint32_t i2) { return v [i1].first < v [i2].first; });
+    }
+
+    // Position in v of the entry of key or -1
+    template <typename Entry, typename Key>
+    int findIndex (const std::vector<Entry> &v, const std::vector<uint32_t> &index,
+		   Key key) {
+      auto it = std::lower_bound (index.begin (), index.end (), key,
+				  [&v] (uint32_t i, Key k) { return v [i].first < k; });
+      if (it == index.end () || v [*it].first != key) return -1;
+      return *it;
+    }
+  }
+
+  FrozenGraph::FrozenGraph (const Graph &g) {
+    // -- number the nodes. Forwarding nodes are skipped: cells are
+    //    resolved to their representative.
+    DenseMap<const Node*, NodeId> ids;
+    for (const Node &n : g) {
+      if (n.isForwarding ()) continue;
+      NodeId id = m_flags.size ();
+      ids [&n] = id;
+      m_flags.push_back (n.getNodeType ());
+      m_size.push_back (n.size ());
+      m_ids.push_back (n.getId ());
+      m_unique_scalar.push_back (n.getUniqueScalar ());
+    }
+
+    auto mkCell = [&ids] (const sea_dsa::Cell &c) {
+      if (c.isNull ()) return Cell ();
+      return Cell (ids.lookup (c.getNode ()), c.getOffset ());
+    };
+
+    // -- links, types and allocation sites. The fields of flat_maps
+    //    are already sorted.
+    std::map<std::vector<const Type*>, uint32_t> sets;
+    std::vector<const Type*> types;
+    m_link_off.push_back (0);
+    m_type_off.push_back (0);
+    m_site_off.push_back (0);
+    m_set_off.push_back (0);
+    for (const Node &n : g) {
+      if (n.isForwarding ()) continue;
+      for (auto &kv : n.links ()) {
+	m_link_field.push_back (kv.first);
+	m_link_cell.push_back (mkCell (*kv.second));
+      }
+      m_link_off.push_back (m_link_field.size ());
+
+      for (auto &kv : n.types ()) {
+	types.clear ();
+	for (const Type *t : kv.second) types.push_back (t);
+	auto it = sets.find (types);
+	if (it == sets.end ()) {
+	  it = sets.insert (std::make_pair (types, (uint32_t) sets.size ())).first;
+	  m_set_types.insert (m_set_types.end (), types.begin (), types.end ());
+	  m_set_off.push_back (m_set_types.size ());
+	}
+	m_type_field.push_back (kv.first);
+	m_type_set.push_back (it->second);
+      }
+      m_type_off.push_back (m_type_field.size ());
+
+      m_sites.insert (m_sites.end (), n.getAllocSites ().begin (), n.getAllocSites ().end ());
+      m_site_off.push_back (m_sites.size ());
+    }
+
+    // -- cells of scalars (including globals), formals and returns
+    for (auto &kv : boost::make_iterator_range (g.scalar_begin (), g.scalar_end ()))
+      m_scalars.push_back (ScalarEntry (kv.first, mkCell (*kv.second)));
+    for (auto &kv : boost::make_iterator_range (g.formal_begin (), g.formal_end ()))
+      m_scalars.push_back (ScalarEntry (kv.first, mkCell (*kv.second)));
+    for (auto &kv : boost::make_iterator_range (g.return_begin (), g.return_end ()))
+      m_returns.push_back (ReturnEntry (kv.first, mkCell (*kv.second)));
+
+    // -- module order instead of the order of the maps, which
+    //    depends on the addresses of the values
+    std::vector<const Function*> fns;
+    for (auto &e : m_scalars)
+      if (const Function *fn = getParentFunction (e.first)) fns.push_back (fn);
+    for (auto &e : m_returns) fns.push_back (e.first);
+    std::sort (fns.begin (), fns.end ());
+    fns.erase (std::unique (fns.begin (), fns.end ()), fns.end ());
+    ModuleOrder order (fns);
+    std::sort (m_scalars.begin (), m_scalars.end (),
+	       [&order] (const ScalarEntry &e1, const ScalarEntry &e2)
+	       { return order.less (e1.first, e2.first); });
+    std::sort (m_returns.begin (), m_returns.end (),
+	       [&order] (const ReturnEntry &e1, const ReturnEntry &e2)
+	       { return order.less (e1.first, e2.first); });
+    buildIndex (m_scalars, m_scalar_index);
+    buildIndex (m_returns, m_return_index);
+  }
+
+  uint32_t FrozenGraph::adjustOffset (NodeId n, uint64_t offset) const {
+    if (isCollapsed (n)) return 0;
+    if (isArray (n) && size (n) > 0) return offset % size (n);
+    return offset;
+  }
+
+  FrozenGraph::Cell FrozenGraph::getLink (const Cell &c, uint32_t offset) const {
+    if (c.isNull ()) return Cell ();
+    uint32_t field = offset == 0 ? c.getOffset ()
+      : adjustOffset (c.getNode (), (uint64_t) c.getOffset () + offset);
+    ArrayRef<uint32_t> fields = getLinkFields (c.getNode ());
+    auto it = std::lower_bound (fields.begin (), fields.end (), field);
+    if (it == fields.end () || *it != field) return Cell ();
+    return getLinkCells (c.getNode ()) [it - fields.begin ()];
+  }
+
+  FrozenGraph::Cell FrozenGraph::getCell (const Value &v) const {
+    int i = findIndex (m_scalars, m_scalar_index, v.stripPointerCasts ());
+    return i < 0 ? Cell () : m_scalars [i].second;
+  }
+
+  FrozenGraph::Cell FrozenGraph::getRetCell (const Function &fn) const {
+    int i = findIndex (m_returns, m_return_index, &fn);
+    return i < 0 ? Cell () : m_returns [i].second;
+  }
+
+  template <typename T>
+  static uint64_t bytes (const std::vector<T> &v)
+  { return v.capacity () * sizeof (T); }
+
+  uint64_t FrozenGraph::memoryUsage () const {
+    return sizeof (*this) +
+      bytes (m_flags) + bytes (m_size) + bytes (m_ids) + bytes (m_unique_scalar) +
+      bytes (m_link_off) + bytes (m_link_field) + bytes (m_link_cell) +
+      bytes (m_type_off) + bytes (m_type_field) + bytes (m_type_set) +
+      bytes (m_set_off) + bytes (m_set_types) +
+      bytes (m_site_off) + bytes (m_sites) +
+      bytes (m_scalars) + bytes (m_returns) +
+      bytes (m_scalar_index) + bytes (m_return_index);
+  }
+
+  void FrozenGraph::write (raw_ostream &o) const {
+    for (NodeId n = 0; n < numNodes (); ++n) {
+      o << "Node " << n << " (id " << getId (n) << "): flags=["
+	<< getNodeType (n).toStr () << "] size=" << size (n) << " types=[";
+      ArrayRef<uint32_t> fields = getTypeFields (n);
+      ArrayRef<uint32_t> sets = getTypeSets (n);
+      for (unsigned i = 0; i < fields.size (); ++i) {
+	if (i > 0) o << ",";
+	o << fields [i] << "->" << sets [i];
+      }
+      o << "] links=[";
+      ArrayRef<uint32_t> lfields = getLinkFields (n);
+      ArrayRef<Cell> cells = getLinkCells (n);
+      for (unsigned i = 0; i < lfields.size (); ++i) {
+	if (i > 0) o << ",";
+	o << lfields [i] << "->(" << cells [i].getOffset () << "," << cells [i].getNode () << ")";
+      }
+      o << "] alloca sites=" << getAllocSites (n).size () << "\n";
+    }
+    for (unsigned i = 0; i < numTypeSets (); ++i) {
+      o << "Type set " << i << ": {";
+      bool first = true;
+      for (const Type *t : getTypeSet (i)) {
+	if (!first) o << ",";
+	first = false;
+	o << *t;
+      }
+      o << "}\n";
+    }
+  }
+}
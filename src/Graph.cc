@@ -4,7 +4,9 @@
 #include "llvm/IR/Argument.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/GlobalAlias.h"
+#include "llvm/IR/GlobalVariable.h"
 #include "llvm/IR/DataLayout.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/Support/raw_ostream.h"
 
 #include <string>
@@ -14,6 +16,9 @@
 #include "sea_dsa/Cloner.hh"
 #include "sea_dsa/Mapper.hh"
 #include "sea_dsa/CallSite.hh"
+#include "sea_dsa/CollapseProfile.hh"
+#include "sea_dsa/PhaseTimers.hh"
+#include "sea_dsa/ShapeProfile.hh"
 #include "sea_dsa/support/Debug.h"
 
 #include "boost/range/algorithm/set_algorithm.hpp"
@@ -68,7 +73,7 @@ void sea_dsa::Node::growSize (unsigned v)
   else if (v > m_size)
   {
     // -- cannot grow size of an array
-    if (isArray ()) collapse (__LINE__);
+    if (isArray ()) collapse (COLLAPSE_ARRAY_GROW);
     else m_size = v;
   }
 }
@@ -166,13 +171,16 @@ void sea_dsa::Node::joinTypes (unsigned offset, const Node &n)
 }
 
 /// collapse the current node. Looses all field sensitivity
-void sea_dsa::Node::collapse (int tag)
+void sea_dsa::Node::collapse (CollapseReason reason)
 {
   if (isCollapsed ()) return;
+  
+  if (CollapseProfile::isEnabled ())
+    CollapseProfile::get ().record (reason, size (), m_types.size ());
         
   LOG ("unique_scalar",
        if (m_unique_scalar)
-         errs () << "KILL due to collapse: "
+         logs () << "KILL due to collapse: "
                  << *m_unique_scalar <<"\n";);
 
   m_unique_scalar = nullptr;
@@ -188,9 +196,10 @@ void sea_dsa::Node::collapse (int tag)
   else
   {
     LOG ("dsa-collapse",
-         errs () << "Collapsing tag: " << tag << "\n";
-         write (errs ());
-         errs () << "\n";);
+         logs () << "Collapsing: "
+                 << collapseReasonName (reason) << "\n";
+         write (logs ());
+         logs () << "\n";);
     
     // create a new node to be the collapsed version of the current one
     // move everything to the new node. This breaks cycles in the links.
@@ -214,7 +223,7 @@ void sea_dsa::Node::pointTo (Node &node, const Offset &offset)
   {
     LOG ("unique_scalar",
          if (m_unique_scalar && node.getUniqueScalar ())
-           errs () << "KILL due to point-to "
+           logs () << "KILL due to point-to "
                    << *m_unique_scalar
                    << " and "
                    << *node.getUniqueScalar () << "\n";);
@@ -287,7 +296,7 @@ void sea_dsa::Node::unifyAt (Node &n, unsigned o)
   // collapse before merging with a collapsed node
   if (!isCollapsed () && n.isCollapsed ())
   {
-    collapse (__LINE__);
+    collapse (COLLAPSE_MERGE_COLLAPSED);
     getNode ()->unifyAt (*n.getNode (), o);
     return;
   }
@@ -305,7 +314,7 @@ void sea_dsa::Node::unifyAt (Node &n, unsigned o)
     // -- cannot merge array at non-zero offset
     else
     {
-      collapse (__LINE__);
+      collapse (COLLAPSE_ARRAY_AT_OFFSET);
       getNode ()->unifyAt (*n.getNode (), o);
       return;
     }
@@ -322,7 +331,7 @@ void sea_dsa::Node::unifyAt (Node &n, unsigned o)
     // previous non-constant indexes
     if (max->size () % min->size () != 0)
     {
-      collapse (__LINE__);
+      collapse (COLLAPSE_ARRAY_SIZES);
       getNode ()->unifyAt (*n.getNode (), o);
       return;
     }
@@ -343,7 +352,7 @@ void sea_dsa::Node::unifyAt (Node &n, unsigned o)
       else
       {
         // -- cannot unify arrays at non-zero offset
-        collapse (__LINE__);
+        collapse (COLLAPSE_ARRAYS_AT_OFFSET);
         getNode ()->unifyAt (*n.getNode (), o);
         return;
       }
@@ -355,7 +364,7 @@ void sea_dsa::Node::unifyAt (Node &n, unsigned o)
     // and the non-array does not fit into the array 
     if (offset != 0 && offset + n.size () > size ())
     {
-      collapse (__LINE__);
+      collapse (COLLAPSE_OUT_OF_ARRAY);
       getNode ()->unifyAt (*n.getNode (), o);
       return;
     }
@@ -364,7 +373,7 @@ void sea_dsa::Node::unifyAt (Node &n, unsigned o)
   if (&n == this)
   {
     // -- merging the node into itself at a different offset
-    if (offset > 0) collapse(__LINE__);
+    if (offset > 0) collapse(COLLAPSE_SELF_AT_OFFSET);
     return;
   }
 
@@ -669,12 +678,14 @@ unsigned sea_dsa::Node::getRawOffset () const
 
 sea_dsa::Node& sea_dsa::Graph::mkNode ()
 {
+  assert (!m_frozen && "frozen graphs are read-only");
   m_nodes.push_back (std::unique_ptr<Node> (new Node (*this)));
   return *m_nodes.back ();
 }
 
 sea_dsa::Node &sea_dsa::Graph::cloneNode (const Node &n)
 {
+  assert (!m_frozen && "frozen graphs are read-only");
   m_nodes.push_back (std::unique_ptr<Node> (new Node (*this, n, false)));
   return *m_nodes.back ();
 }
@@ -728,6 +739,22 @@ sea_dsa::Graph::global_const_iterator sea_dsa::Graph::globals_end() const
 
 void sea_dsa::Graph::compress ()
 {
+  // -- already compressed
+  if (m_frozen) return;
+  
+  PhaseTimers::Scope timer (TIMER_COMPRESS);
+  
+  // -- length of the forwarding chains before they are resolved
+  if (ShapeProfile::isEnabled ())
+    for (auto &n : m_nodes)
+    {
+      if (!n->isForwarding ()) continue;
+      unsigned len = 0;
+      for (const Node *m = n.get (); m->isForwarding (); m = m->m_forward.m_node)
+        ++len;
+      ShapeProfile::get ().record (SHAPE_FORWARDING_CHAIN, len);
+    }
+  
   // -- resolve all forwarding
   for (auto &n : m_nodes)
   {
@@ -757,9 +784,84 @@ void sea_dsa::Graph::compress ()
                  m_nodes.end ());
 }
 
+// Add to s the global values used by v, looking through constant
+// expressions and the initializers of global variables
+static void collectGlobals (const Value *v, DenseSet<const Value*> &seen,
+                            std::vector<const GlobalValue*> &s)
+{
+  if (!isa<Constant> (v) || !seen.insert (v).second) return;
+  if (const GlobalValue *gv = dyn_cast<GlobalValue> (v))
+  {
+    s.push_back (gv);
+    if (const GlobalVariable *gvar = dyn_cast<GlobalVariable> (gv))
+    {
+      if (gvar->hasInitializer ())
+        collectGlobals (gvar->getInitializer (), seen, s);
+    }
+    else if (const GlobalAlias *ga = dyn_cast<GlobalAlias> (gv))
+      collectGlobals (ga->getAliasee (), seen, s);
+    return;
+  }
+  for (const Value *op : cast<Constant> (v)->operands ())
+    collectGlobals (op, seen, s);
+}
+
+void sea_dsa::Graph::mkGlobalCells (const std::vector<const Function*> &fns)
+{
+  assert (!m_frozen && "frozen graphs are read-only");
+  
+  DenseSet<const Value*> seen;
+  std::vector<const GlobalValue*> globals;
+  for (const Function *fn : fns)
+    for (const BasicBlock &bb : *fn)
+      for (const Instruction &I : bb)
+      {
+        ImmutableCallSite CS (&I);
+        for (const Use &op : I.operands ())
+        {
+          if (CS && CS.isCallee (&op) &&
+              isa<Function> (op->stripPointerCasts ()))
+            continue;
+          collectGlobals (op->stripPointerCasts (), seen, globals);
+        }
+      }
+  for (const GlobalValue *gv : globals)
+    if (!m_values.count (gv)) mkCell (*gv, Cell ());
+}
+
+void sea_dsa::Graph::freeze ()
+{
+  if (m_frozen) return;
+  
+  // -- every cell and link points directly to a representative
+  compress ();
+  
+  m_frozen = true;
+}
+
+void sea_dsa::Graph::pruneScalars (const DenseSet<const Value*> &keep)
+{
+  assert (!m_frozen && "frozen graphs are read-only");
+  
+  // -- move the kept cells into a new map so that the memory of the
+  //    old one is released
+  ValueMap kept;
+  for (auto &kv : m_values)
+    if (isa<GlobalValue> (kv.first) || keep.count (kv.first))
+      kept [kv.first] = std::move (kv.second);
+  
+  LOG ("dsa-prune",
+       logs () << "Pruned " << m_values.size () - kept.size () << " out of "
+               << m_values.size () << " scalar cells\n";);
+  
+  m_values.swap (kept);
+  compress ();
+  remove_dead ();
+}
+
 // pre: the graph has been compressed already
 void sea_dsa::Graph::remove_dead () {
-  LOG("dsa-dead", errs () << "Removing dead nodes ...\n";);
+  LOG("dsa-dead", logs () << "Removing dead nodes ...\n";);
   
   std::set<const Node*> reachable;
   
@@ -768,7 +870,7 @@ void sea_dsa::Graph::remove_dead () {
     const Cell* C = kv.second.get ();
     if (C->isNull()) continue;
     if (reachable.insert(C->getNode()).second) {
-      LOG("dsa-dead", errs () << "\treachable node " << C->getNode () << "\n";);
+      LOG("dsa-dead", logs () << "\treachable node " << C->getNode () << "\n";);
     }
   }
 
@@ -777,7 +879,7 @@ void sea_dsa::Graph::remove_dead () {
     const Cell* C = kv.second.get();
     if (C->isNull()) continue;
     if (reachable.insert(C->getNode()).second) {
-      LOG("dsa-dead", errs () << "\treachable node " << C->getNode () << "\n";);
+      LOG("dsa-dead", logs () << "\treachable node " << C->getNode () << "\n";);
     }
   }
   
@@ -786,7 +888,7 @@ void sea_dsa::Graph::remove_dead () {
     const Cell* C = kv.second.get();
     if (C->isNull()) continue;
     if (reachable.insert(C->getNode()).second) {
-      LOG("dsa-dead", errs () << "\treachable node " << C->getNode () << "\n";);
+      LOG("dsa-dead", logs () << "\treachable node " << C->getNode () << "\n";);
     }
   }
 
@@ -800,7 +902,7 @@ void sea_dsa::Graph::remove_dead () {
       auto s = kv.second->getNode ();
       if (reachable.insert(s).second) {
 	worklist.push_back (s);
-	LOG("dsa-dead", errs () << "\t" << s << " reachable from " << n << "\n";);
+	LOG("dsa-dead", logs () << "\t" << s << " reachable from " << n << "\n";);
       }
     }
   }
@@ -810,20 +912,24 @@ void sea_dsa::Graph::remove_dead () {
                                  [reachable] (const std::unique_ptr<Node> &n)
                                  { LOG("dsa-dead",
 				       if (reachable.count(&*n) == 0)
-					 errs () << "\tremoving dead " << &*n << "\n";);
+					 logs () << "\tremoving dead " << &*n << "\n";);
 				   return (reachable.count(&*n) == 0);}),
                  m_nodes.end ());
 }
 
 sea_dsa::Cell &sea_dsa::Graph::mkCell (const llvm::Value &u, const Cell &c)
+{ return mkCanonicalCell (*u.stripPointerCasts (), c); }
+
+sea_dsa::Cell &sea_dsa::Graph::mkCanonicalCell (const llvm::Value &v, const Cell &c)
 {
-  auto &v = *u.stripPointerCasts ();
+  assert (!m_frozen && "frozen graphs are read-only");
+  assert (&v == v.stripPointerCasts ());
   // Pretend that global values are always present
   if (isa<GlobalValue> (&v) && c.isNull ())
   {
     sea_dsa::Node &n = mkNode ();
     n.addAllocSite (v);
-    return mkCell (v, Cell (n, 0));  
+    return mkCanonicalCell (v, Cell (n, 0));  
   }
 
   auto &res = isa<Argument> (v) ? m_formals[cast<const Argument>(&v)] : m_values [&v];
@@ -837,10 +943,10 @@ sea_dsa::Cell &sea_dsa::Graph::mkCell (const llvm::Value &u, const Cell &c)
       else
       {
         LOG ("unique_scalar",
-             errs () << "KILL due to mkCell: ";
+             logs () << "KILL due to mkCell: ";
              if (res->getNode ()->getUniqueScalar ())
-               errs () << "OLD: " << *res->getNode ()->getUniqueScalar () ;
-             errs () << " NEW: " << v <<"\n";);
+               logs () << "OLD: " << *res->getNode ()->getUniqueScalar () ;
+             logs () << " NEW: " << v <<"\n";);
         res->getNode ()->setUniqueScalar (nullptr);
       }
     }
@@ -870,8 +976,13 @@ const sea_dsa::Cell &sea_dsa::Graph::getRetCell (const llvm::Function &fn) const
 }
 
 const sea_dsa::Cell &sea_dsa::Graph::getCell (const llvm::Value &u) 
+{ return getCanonicalCell (*(u.stripPointerCasts ())); }
+
+const sea_dsa::Cell &sea_dsa::Graph::getCanonicalCell (const llvm::Value &v) 
 {
-  const llvm::Value &v = *(u.stripPointerCasts ());
+  assert (&v == v.stripPointerCasts ());
+  if (m_frozen) return static_cast<const Graph*> (this)->getCell (v);
+  
   // -- try m_formals first
   if (const llvm::Argument *arg = dyn_cast<const Argument> (&v))
   {
@@ -880,7 +991,7 @@ const sea_dsa::Cell &sea_dsa::Graph::getCell (const llvm::Value &u)
     return *(it->second);
   }
   else if (isa<GlobalValue> (&v))
-    return mkCell (v, Cell ());
+    return mkCanonicalCell (v, Cell ());
   else 
   {
     auto it = m_values.find (&v);
@@ -889,12 +1000,35 @@ const sea_dsa::Cell &sea_dsa::Graph::getCell (const llvm::Value &u)
   }
 }
 
+const sea_dsa::Cell &sea_dsa::Graph::getCell (const llvm::Value &u) const
+{
+  // -- never modified so it can be shared by all threads
+  static const Cell nullCell;
+  const Cell *c = findCell (u);
+  return c ? *c : nullCell;
+}
+
+const sea_dsa::Cell *sea_dsa::Graph::findCell (const llvm::Value &u) const
+{
+  const llvm::Value &v = *(u.stripPointerCasts ());
+  if (const llvm::Argument *arg = dyn_cast<const Argument> (&v))
+  {
+    auto it = m_formals.find (arg);
+    return it != m_formals.end () ? it->second.get () : nullptr;
+  }
+  auto it = m_values.find (&v);
+  return it != m_values.end () ? it->second.get () : nullptr;
+}
+
 bool sea_dsa::Graph::hasCell (const llvm::Value &u) const
+{ return hasCanonicalCell (*u.stripPointerCasts ()); }
+
+bool sea_dsa::Graph::hasCanonicalCell (const llvm::Value &v) const
 {
-  auto &v = *u.stripPointerCasts ();
+  assert (&v == v.stripPointerCasts ());
   return
     // -- globals are always implicitly present
-    isa<GlobalValue> (&v) || 
+    (isa<GlobalValue> (&v) && !m_frozen) || 
     m_values.count (&v) > 0 ||
     (isa<Argument> (&v) &&
      m_formals.count (cast<const Argument>(&v)) > 0 );
@@ -917,6 +1051,8 @@ bool sea_dsa::Graph::computeCalleeCallerMapping (const DsaCallSite &cs,
                                              SimulationMapper& simMap,
 					     const bool reportIfSanityCheckFailed) 
 {
+  PhaseTimers::Scope timer (TIMER_SIMULATION);
+  
   // XXX: to be removed
   const bool onlyModified = false;
   
@@ -931,7 +1067,7 @@ bool sea_dsa::Graph::computeCalleeCallerMapping (const DsaCallSite &cs,
       {
         if (reportIfSanityCheckFailed)
         {
-          errs () << "ERROR: callee is not simulated by caller at " 
+          diags () << "ERROR: callee is not simulated by caller at " 
                   << *cs.getInstruction() << "\n"
                   << "\tGlobal: " << *kv.first << "\n"
                   << "\tCallee cell=" << c << "\n"
@@ -953,7 +1089,7 @@ bool sea_dsa::Graph::computeCalleeCallerMapping (const DsaCallSite &cs,
       {
         if (reportIfSanityCheckFailed)
         {
-          errs () << "ERROR: callee is not simulated by caller at " 
+          diags () << "ERROR: callee is not simulated by caller at " 
                   << *cs.getInstruction() << "\n"
                   << "\rReturn value of " << callee.getName () << "\n"
                   << "\rCallee cell=" << c << "\n"
@@ -979,7 +1115,7 @@ bool sea_dsa::Graph::computeCalleeCallerMapping (const DsaCallSite &cs,
         {
           if (reportIfSanityCheckFailed)
           {
-            errs () << "ERROR: callee is not simulated by caller at " 
+            diags () << "ERROR: callee is not simulated by caller at " 
                     << *cs.getInstruction() << "\n"
                     << "\tFormal param " << *fml << "\n"
                     << "\tActual param " << *arg << "\n"
@@ -994,6 +1130,57 @@ bool sea_dsa::Graph::computeCalleeCallerMapping (const DsaCallSite &cs,
   return true;
 }
 
+bool sea_dsa::Graph::computeCalleeCallerMapping (const DsaCallSite &cs, 
+                                             const Graph& calleeG, const Graph &callerG,
+                                             SimulationMapper& simMap,
+					     const bool reportIfSanityCheckFailed) 
+{
+  PhaseTimers::Scope timer (TIMER_SIMULATION);
+  
+  // -- the mapper does not modify the caller cells
+  auto insert = [&] (const Cell &c, const Cell &callerC, const char *what,
+                     const Value &v) {
+    Cell nc (callerC);
+    if (simMap.insert (c, nc)) return true;
+    if (reportIfSanityCheckFailed)
+    {
+      diags () << "ERROR: callee is not simulated by caller at " 
+              << *cs.getInstruction() << "\n"
+              << "\t" << what << " " << v << "\n"
+              << "\tCallee cell=" << c << "\n"
+              << "\tCaller cell=" << nc << "\n";
+    }
+    return false;
+  };
+  
+  for (auto &kv : boost::make_iterator_range (calleeG.globals_begin (),
+                                              calleeG.globals_end ()))
+  {
+    const Cell *nc = callerG.findCell (*kv.first);
+    if (nc && !insert (*kv.second, *nc, "Global:", *kv.first)) return false;
+  }
+  
+  const Function &callee = *cs.getCallee ();
+  if (calleeG.hasRetCell (callee))
+  {
+    const Cell *nc = callerG.findCell (*cs.getInstruction ());
+    if (nc && !insert (calleeG.getRetCell (callee), *nc, "Return value of", callee))
+      return false;
+  }
+  
+  DsaCallSite::const_actual_iterator AI = cs.actual_begin(), AE = cs.actual_end();
+  for (DsaCallSite::const_formal_iterator FI = cs.formal_begin(), FE = cs.formal_end();
+       FI != FE && AI != AE; ++FI, ++AI) 
+  {
+    const Value *fml = &*FI;
+    const Value *arg = (*AI).get();
+    const Cell *c = calleeG.findCell (*fml);
+    const Cell *nc = callerG.findCell (*arg);
+    if (c && nc && !insert (*c, *nc, "Formal param", *fml)) return false;
+  }      
+  return true;
+}
+
 void sea_dsa::Graph::import (const Graph &g, bool withFormals)
 {
   Cloner C (*this);
@@ -1035,6 +1222,71 @@ void sea_dsa::Graph::import (const Graph &g, bool withFormals)
 }
 
 
+sea_dsa::Graph::MemoryUsage &
+sea_dsa::Graph::MemoryUsage::operator+= (const MemoryUsage &o)
+{
+  m_nodes += o.m_nodes;
+  m_links += o.m_links;
+  m_types += o.m_types;
+  m_type_sets += o.m_type_sets;
+  m_alloc_sites += o.m_alloc_sites;
+  m_scalars += o.m_scalars;
+  m_formals += o.m_formals;
+  m_returns += o.m_returns;
+  return *this;
+}
+
+void sea_dsa::Graph::MemoryUsage::write (raw_ostream &o) const
+{
+  auto line = [&o] (uint64_t bytes, const char *what)
+    { o << "\t" << bytes << " bytes of " << what << "\n"; };
+  line (m_nodes, "nodes");
+  line (m_links, "links");
+  line (m_types, "type maps");
+  line (m_type_sets, "type sets");
+  line (m_alloc_sites, "allocation sites");
+  line (m_scalars, "scalar cells");
+  line (m_formals, "formal cells");
+  line (m_returns, "return cells");
+  line (total (), "total");
+}
+
+sea_dsa::Graph::MemoryUsage sea_dsa::Graph::memoryUsage () const
+{
+  MemoryUsage res;
+  res.m_nodes = m_nodes.capacity () * sizeof (NodeVector::value_type) +
+    m_nodes.size () * sizeof (Node);
+
+  // -- trees of the type sets. Subtrees are shared between sets so
+  //    each tree node is counted once.
+  typedef Set::TreeTy TreeTy;
+  DenseSet<const TreeTy*> trees;
+  std::vector<const TreeTy*> worklist;
+  
+  for (auto &n : m_nodes) {
+    res.m_links += n->m_links.capacity () * sizeof (Node::links_type::value_type) +
+      n->m_links.size () * sizeof (Cell);
+    res.m_types += n->m_types.capacity () * sizeof (Node::types_type::value_type);
+    res.m_alloc_sites += n->m_alloca_sites.capacity () * sizeof (const Value*);
+    for (auto &kv : n->m_types)
+      if (const TreeTy *t = kv.second.getRootWithoutRetain ())
+	worklist.push_back (t);
+  }
+  while (!worklist.empty ()) {
+    const TreeTy *t = worklist.back ();
+    worklist.pop_back ();
+    if (!trees.insert (t).second) continue;
+    if (t->getLeft ()) worklist.push_back (t->getLeft ());
+    if (t->getRight ()) worklist.push_back (t->getRight ());
+  }
+  res.m_type_sets = trees.size () * sizeof (TreeTy);
+
+  res.m_scalars = m_values.getMemorySize () + m_values.size () * sizeof (Cell);
+  res.m_formals = m_formals.getMemorySize () + m_formals.size () * sizeof (Cell);
+  res.m_returns = m_returns.getMemorySize () + m_returns.size () * sizeof (Cell);
+  return res;
+}
+
 void sea_dsa::Graph::write (raw_ostream&o) const{
 
   typedef std::set<const llvm::Value*> ValSet;
@@ -1129,4 +1381,4 @@ void sea_dsa::Graph::write (raw_ostream&o) const{
 }
 
 // Initialization of static data
-uint64_t sea_dsa::Node::m_id_factory = 0;
+thread_local uint64_t sea_dsa::Node::m_id_factory = 0;
@@ -146,3 +146,16 @@ bool SimulationMapper::isFunction () const
     if (kv.second.size () > 1) return false;
   return true;
 }
+
+uint64_t SimulationMapper::memoryUsage () const
+{
+  typedef rel_type::value_type entry_t;
+  typedef rel_type::mapped_type::value_type pair_t;
+  // -- one heap-allocated node per entry (value and next pointer)
+  //    plus the bucket array
+  uint64_t res = sizeof (*this) + m_sim.bucket_count () * sizeof (void*) +
+    m_sim.size () * (sizeof (entry_t) + sizeof (void*));
+  for (auto &kv : m_sim)
+    res += kv.second.capacity () * sizeof (pair_t);
+  return res;
+}
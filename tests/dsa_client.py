@@ -0,0 +1,65 @@
+#!/usr/bin/python
+
+# Start seadsa as a server on a fresh socket, send it one request per
+# argument after -- and print the answers.
+#
+# usage: dsa_client.py seadsa [seadsa options] -- request...
+
+import os
+import shutil
+import socket
+import subprocess
+import sys
+import tempfile
+import time
+
+def usage ():
+   print ("dsa_client.py seadsa [seadsa options] -- request...")
+   return
+
+def connect (path, server):
+   # -- the server might not be listening yet
+   for i in range (300):
+      if server.poll () is not None:
+         return None
+      s = socket.socket (socket.AF_UNIX, socket.SOCK_STREAM)
+      try:
+         s.connect (path)
+         return s
+      except socket.error:
+         s.close ()
+         time.sleep (0.1)
+   return None
+
+def run (cmd, requests):
+   tmpdir = tempfile.mkdtemp ()
+   path = os.path.join (tmpdir, 'seadsa.sock')
+   server = subprocess.Popen (cmd + ['--sea-dsa-server=' + path])
+   try:
+      s = connect (path, server)
+      if s is None:
+         print ("error: cannot connect to " + path)
+         return 1
+      f = s.makefile ('rw')
+      for r in requests + ['shutdown']:
+         f.write (r + '\n')
+         f.flush ()
+         if r in ('quit', 'shutdown'):
+            break
+         sys.stdout.write (f.readline ())
+      f.close ()
+      s.close ()
+      return server.wait ()
+   finally:
+      if server.poll () is None:
+         server.kill ()
+      shutil.rmtree (tmpdir)
+
+if __name__ == "__main__":
+
+   if '--' not in sys.argv or sys.argv.index ('--') < 2:
+      usage ()
+      sys.exit (1)
+
+   sep = sys.argv.index ('--')
+   sys.exit (run (sys.argv[1:sep], sys.argv[sep+1:]))
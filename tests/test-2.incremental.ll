@@ -0,0 +1,34 @@
+; RUN: rm -f %T/test-2.inc
+; RUN: %seadsa  %cs_dsa %s --sea-dsa-incremental=%T/test-2.inc
+; RUN: sed -e 's/store i32 2/store i32 3/' %s > %T/test-2.inc.edited.ll
+; RUN: %seadsa  %cs_dsa --sea-dsa-dot %T/test-2.inc.edited.ll --sea-dsa-dot-outdir=%T/test-2.inc2.ll --sea-dsa-incremental=%T/test-2.inc --sea-dsa-log=dsa-bu,dsa-global 2> %T/test-2.inc2.log
+; RUN: %seadsa  %cs_dsa --sea-dsa-dot %T/test-2.inc.edited.ll --sea-dsa-dot-outdir=%T/test-2.inc3.ll
+; RUN: %cmp-graphs %T/test-2.inc3.ll/main.mem.dot %T/test-2.inc2.ll/main.mem.dot > %T/test-2.inc2.cmp1
+; RUN: %cmp-graphs %T/test-2.inc3.ll/a.mem.dot %T/test-2.inc2.ll/a.mem.dot > %T/test-2.inc2.cmp2
+; RUN: cat %T/test-2.inc2.log %T/test-2.inc2.cmp1 %T/test-2.inc2.cmp2 | OutputCheck %s -d --comment=";"
+; CHECK: ^Recomputed 2 out of 3 bottom-up graphs$
+; CHECK: ^Reused 1 out of 3 graphs from the previous run$
+; CHECK: ^OK$
+; CHECK: ^OK$
+
+; Only @b is edited between the runs: @b and its caller @main are
+; recomputed and the final graph of @a is reused.
+
+define void @a(i32* %p) {
+  store i32 1, i32* %p, align 4
+  ret void
+}
+
+define void @b(i32* %q) {
+  store i32 2, i32* %q, align 4
+  ret void
+}
+
+define i32 @main() {
+  %x = alloca i32, align 4
+  %y = alloca i32, align 4
+  call void @a(i32* %x)
+  call void @b(i32* %y)
+  %v = load i32* %x, align 4
+  ret i32 %v
+}
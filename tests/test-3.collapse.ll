@@ -0,0 +1,23 @@
+; RUN: %seadsa  %cs_dsa %s --sea-dsa-collapse-profile-to-file=%T/test-3.collapse.csv
+; RUN: OutputCheck %s --file-to-check=%T/test-3.collapse.csv -d --comment=";"
+; CHECK: ^reason,phase,function,instruction,count,lost_bytes,lost_fields$
+; CHECK: ^self-at-offset,local,"main","%r = phi
+
+; The phi node merges two cells of the same node at different offsets
+
+define i32 @main(i1 %c) {
+entry:
+  %p = call i8* @malloc(i32 8)
+  %q = getelementptr inbounds i8* %p, i32 4
+  br i1 %c, label %then, label %end
+
+then:
+  br label %end
+
+end:
+  %r = phi i8* [ %p, %entry ], [ %q, %then ]
+  store i8 0, i8* %r
+  ret i32 0
+}
+
+declare noalias i8* @malloc(i32)
@@ -0,0 +1,26 @@
+; RUN: %seadsa  %cs_dsa %s --sea-dsa-fixpoint-trace=%T/test-3.fixpoint.json
+; RUN: OutputCheck %s --file-to-check=%T/test-3.fixpoint.json -d --comment=";"
+; CHECK: ^{"displayTimeUnit":"ms","traceEvents":\[$
+; CHECK: "name":"decide"
+; CHECK: "name":"top-down".*"caller":"main","callee":"f"
+
+; Two different nodes of f are the same node in main so f needs a
+; top-down propagation
+
+define void @f(i32* %a, i32* %b) {
+entry:
+  store i32 1, i32* %a
+  store i32 2, i32* %b
+  ret void
+}
+
+define i32 @main() {
+entry:
+  %p = call i8* @malloc(i32 4)
+  %q = bitcast i8* %p to i32*
+  call void @f(i32* %q, i32* %q)
+  %r = load i32* %q
+  ret i32 %r
+}
+
+declare noalias i8* @malloc(i32)
@@ -0,0 +1,19 @@
+; RUN: %dsa-client %seadsa %cs_dsa --sea-dsa-freeze-graphs -- "node %s main @x" "node %s main @u" > %T/test-3.freeze-globals.out
+; RUN: cat %T/test-3.freeze-globals.out | OutputCheck %s -d --comment=";"
+; CHECK: ^{"ok":true,"node":[0-9]+,"offset":0,
+; CHECK-NEXT: ^{"ok":false,"error":"no cell for @u"}$
+
+; Lookups in frozen graphs. @x is only used from the initializer of
+; @p but main can reach it, so it has a cell. @u is not reached by
+; main: the lookup fails instead of crashing.
+
+@x = global i32 0
+@p = global i32* @x
+@u = global i32 0
+
+define i32 @main() {
+entry:
+  %q = load i32** @p
+  %v = load i32* %q
+  ret i32 %v
+}
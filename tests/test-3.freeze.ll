@@ -0,0 +1,23 @@
+; RUN: %seadsa  %cs_dsa --sea-dsa-freeze-graphs --sea-dsa-stats %s 2>&1 | OutputCheck %s
+; CHECK: number of read or modified nodes
+; CHECK: End SeaHorn Dsa info
+
+; Frozen graphs are queried by DsaInfo. @g is only used through a
+; constant expression and @h is not used by @f
+
+@g = global [2 x i32] zeroinitializer
+@h = global i32 0
+
+define void @f(i32* %p) {
+entry:
+  store i32 1, i32* getelementptr inbounds ([2 x i32]* @g, i32 0, i32 1)
+  store i32 2, i32* %p
+  ret void
+}
+
+define i32 @main() {
+entry:
+  call void @f(i32* @h)
+  %r = load i32* @h
+  ret i32 %r
+}
@@ -0,0 +1,17 @@
+; RUN: %seadsa  %cs_dsa --sea-dsa-prune-scalars --sea-dsa-log=dsa-prune %s 2>&1 | OutputCheck %s
+; CHECK: ^Pruned 1 out of [0-9]+ scalar cells$
+
+; The cell of %q is dropped: it is only compared with null
+
+define i32 @main() {
+entry:
+  %p = call i8* @malloc(i32 8)
+  %q = getelementptr inbounds i8* %p, i32 4
+  %c = icmp eq i8* %q, null
+  %r = bitcast i8* %p to i32*
+  %v = load i32* %r
+  %w = select i1 %c, i32 0, i32 %v
+  ret i32 %w
+}
+
+declare noalias i8* @malloc(i32)
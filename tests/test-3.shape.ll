@@ -0,0 +1,23 @@
+; RUN: %seadsa  %cs_dsa %s --sea-dsa-shape-stats-to-file=%T/test-3.shape.json
+; RUN: OutputCheck %s --file-to-check=%T/test-3.shape.json -d --comment=";"
+; CHECK: "nodes_per_graph":{"count":2,
+; CHECK: "clone_size":{"count":[1-9]
+
+define void @f(i32** %a) {
+entry:
+  %p = call i8* @malloc(i32 4)
+  %q = bitcast i8* %p to i32*
+  store i32* %q, i32** %a
+  ret void
+}
+
+define i32 @main() {
+entry:
+  %a = alloca i32*
+  call void @f(i32** %a)
+  %q = load i32** %a
+  %r = load i32* %q
+  ret i32 %r
+}
+
+declare noalias i8* @malloc(i32)
@@ -0,0 +1,28 @@
+; RUN: %dsa-client %seadsa %cs_dsa -- "alias %s main a b" "alias %s main s a" "alias %s main a t" "alias %s main s b 8 4" "node %s main b" > %T/test-4.server.out
+; RUN: cat %T/test-4.server.out | OutputCheck %s -d --comment=";"
+; CHECK: ^{"ok":true,"alias":false}$
+; CHECK-NEXT: ^{"ok":true,"alias":true}$
+; CHECK-NEXT: ^{"ok":true,"alias":false}$
+; CHECK-NEXT: ^{"ok":true,"alias":true}$
+; CHECK-NEXT: ^{"ok":true,"node":[0-9]+,"offset":4,"collapsed":false,
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+%struct.pair = type { i32, i32 }
+
+define i32 @main() {
+  %s = alloca %struct.pair, align 4
+  %t = alloca i32, align 4
+  %a = getelementptr inbounds %struct.pair* %s, i32 0, i32 0
+  %b = getelementptr inbounds %struct.pair* %s, i32 0, i32 1
+  store i32 1, i32* %a, align 4
+  store i32 2, i32* %b, align 4
+  store i32 3, i32* %t, align 4
+  %1 = load i32* %a, align 4
+  %2 = load i32* %b, align 4
+  %3 = add nsw i32 %1, %2
+  %4 = load i32* %t, align 4
+  %5 = add nsw i32 %3, %4
+  ret i32 %5
+}
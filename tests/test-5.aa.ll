@@ -0,0 +1,38 @@
+; RUN: %seadsa  %cs_dsa --sea-dsa-aa-eval -print-no-aliases -print-may-aliases %s 2> %T/test-5.aa.log
+; RUN: cat %T/test-5.aa.log | OutputCheck %s -d --comment=";"
+; p points to @gx: the icmp gives no cell to @gx in the local graph of f
+; CHECK: MayAlias:\s+i32\* %p, i32\* @gx
+; CHECK: NoAlias:\s+i32\* %a, i32\* %b
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+%struct.pair = type { i32, i32 }
+
+@gx = global i32 0, align 4
+
+define void @f(i32* %p) {
+  store i32 1, i32* %p, align 4
+  %c = icmp eq i32* %p, @gx
+  br i1 %c, label %then, label %exit
+
+then:
+  store i32 2, i32* %p, align 4
+  br label %exit
+
+exit:
+  ret void
+}
+
+define i32 @main() {
+  %s = alloca %struct.pair, align 4
+  %a = getelementptr inbounds %struct.pair* %s, i32 0, i32 0
+  %b = getelementptr inbounds %struct.pair* %s, i32 0, i32 1
+  store i32 1, i32* %a, align 4
+  store i32 2, i32* %b, align 4
+  call void @f(i32* @gx)
+  %1 = load i32* %a, align 4
+  %2 = load i32* %b, align 4
+  %3 = add nsw i32 %1, %2
+  ret i32 %3
+}
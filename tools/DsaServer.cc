@@ -0,0 +1,320 @@
+#include "DsaServer.hh"
+
+#include "llvm/PassManager.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/ValueSymbolTable.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "sea_dsa/DsaAnalysis.hh"
+#include "sea_dsa/Info.hh"
+#include "sea_dsa/support/Strings.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <sstream>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace llvm;
+
+namespace sea_dsa {
+
+  namespace {
+
+    // A module with the passes that analyzed it. The passes are owned
+    // by the pass manager.
+    struct AnalyzedModule {
+      std::unique_ptr<LLVMContext> m_context;
+      std::unique_ptr<Module> m_module;
+      std::unique_ptr<PassManager> m_pm;
+      DsaAnalysis *m_dsa;
+      DsaInfoPass *m_info;
+      sys::TimeValue m_mtime;
+
+      AnalyzedModule (): m_dsa (nullptr), m_info (nullptr) {}
+    };
+
+    std::string error (const std::string &msg) {
+      return "{\"ok\":false,\"error\":\"" + escapeJSON (msg) + "\"}";
+    }
+
+    std::string valueName (const Value &v) {
+      if (const Instruction *I = dyn_cast<Instruction> (&v))
+	return I->getParent ()->getParent ()->getName ().str () + ":%" + v.getName ().str ();
+      if (const Argument *a = dyn_cast<Argument> (&v))
+	return a->getParent ()->getName ().str () + ":%" + v.getName ().str ();
+      return "@" + v.getName ().str ();
+    }
+
+    class DsaServer {
+
+      std::map<std::string, std::unique_ptr<AnalyzedModule> > m_modules;
+
+      bool getModificationTime (const std::string &file, sys::TimeValue &t) {
+	sys::fs::file_status st;
+	if (sys::fs::status (file, st)) return false;
+	t = st.getLastModificationTime ();
+	return true;
+      }
+
+      // Parse and analyze file. Return an error message if it failed.
+      std::string load (const std::string &file) {
+	std::unique_ptr<AnalyzedModule> am (new AnalyzedModule ());
+	if (!getModificationTime (file, am->m_mtime))
+	  return "cannot access " + file;
+
+	am->m_context.reset (new LLVMContext ());
+	SMDiagnostic err;
+	am->m_module = parseIRFile (file, err, *am->m_context);
+	if (!am->m_module)
+	  return "bitcode was not properly read; " + err.getMessage ().str ();
+	if (verifyModule (*am->m_module))
+	  return "broken module " + file;
+
+	am->m_pm.reset (new PassManager ());
+	if (am->m_module->getDataLayout ())
+	  am->m_pm->add (new DataLayoutPass ());
+	am->m_dsa = new DsaAnalysis ();
+	am->m_pm->add (am->m_dsa);
+	am->m_info = new DsaInfoPass ();
+	am->m_pm->add (am->m_info);
+	am->m_pm->run (*am->m_module);
+
+	m_modules [file] = std::move (am);
+	return "";
+      }
+
+      // Return the analyzed module of file, analyzing it again if the
+      // file changed since the last time
+      AnalyzedModule *getModule (const std::string &file, std::string &msg) {
+	auto it = m_modules.find (file);
+	if (it != m_modules.end ()) {
+	  sys::TimeValue t;
+	  if (getModificationTime (file, t) && t == it->second->m_mtime)
+	    return &*(it->second);
+	  m_modules.erase (it);
+	  errs () << "Reanalyzing " << file << "\n";
+	}
+	msg = load (file);
+	if (!msg.empty ()) return nullptr;
+	return &*(m_modules [file]);
+      }
+
+      const Value *getValue (AnalyzedModule &am, const Function &fn,
+			     const std::string &name) {
+	if (!name.empty () && name [0] == '@')
+	  return am.m_module->getNamedValue (name.substr (1));
+	std::string local = (!name.empty () && name [0] == '%') ? name.substr (1) : name;
+	return fn.getValueSymbolTable ().lookup (local);
+      }
+
+      // Find the cell of a value. Return an error message if it failed.
+      std::string getCell (AnalyzedModule &am, const std::string &fnName,
+			   const std::string &valueName, Cell &c,
+			   const Value **value = nullptr) {
+	const Function *fn = am.m_module->getFunction (fnName);
+	if (!fn) return "unknown function " + fnName;
+	GlobalAnalysis &ga = am.m_dsa->getDsaAnalysis ();
+	if (!ga.hasGraph (*fn)) return "no graph for " + fnName;
+	const Value *v = getValue (am, *fn, valueName);
+	if (!v) return "unknown value " + valueName;
+	const Graph &g = ga.getGraph (*fn);
+	c = g.getCell (*v);
+	if (c.isNull ()) return "no cell for " + valueName;
+	if (value) *value = v;
+	return "";
+      }
+
+      // Number of bytes accessed through v by default: the store size
+      // of the pointed type. Return 0 if unknown.
+      unsigned accessSize (AnalyzedModule &am, const Value &v) {
+	PointerType *ty = dyn_cast<PointerType> (v.getType ());
+	if (!ty || !ty->getElementType ()->isSized ()) return 0;
+	return am.m_dsa->getDataLayout ().getTypeStoreSize (ty->getElementType ());
+      }
+
+      // Can accesses of size1 and size2 bytes (0 if unknown) through
+      // c1 and c2 overlap? Same reasoning as DsaAliasAnalysis.
+      bool mayAlias (const Cell &c1, unsigned size1, const Cell &c2, unsigned size2) {
+	const Node *n1 = c1.getNode ();
+	const Node *n2 = c2.getNode ();
+	if (n1->isIntToPtr () || n1->isExternal () ||
+	    n2->isIntToPtr () || n2->isExternal ())
+	  return true;
+	if (n1 != n2) return false;
+	if (n1->isCollapsed () || n1->isArray () || size1 == 0 || size2 == 0)
+	  return true;
+	unsigned off1 = c1.getOffset ();
+	unsigned off2 = c2.getOffset ();
+	return !(off1 + size1 <= off2 || off2 + size2 <= off1);
+      }
+
+      std::string allocSites (DsaInfo &info, const Node &n, bool withValues) {
+	std::string res = "[";
+	bool first = true;
+	for (const Value *v : n.getAllocSites ()) {
+	  if (!first) res += ",";
+	  first = false;
+	  unsigned id = info.getAllocSiteId (v);
+	  if (withValues)
+	    res += "{\"id\":" + std::to_string (id) +
+	      ",\"value\":\"" + escapeJSON (valueName (*v)) + "\"}";
+	  else
+	    res += std::to_string (id);
+	}
+	return res + "]";
+      }
+
+    public:
+
+      // Answer one request
+      std::string handle (const std::vector<std::string> &args) {
+	const std::string &cmd = args [0];
+	std::string msg;
+
+	if (cmd == "load" && args.size () == 2) {
+	  AnalyzedModule *am = getModule (args [1], msg);
+	  if (!am) return error (msg);
+	  return "{\"ok\":true,\"module\":\"" + escapeJSON (args [1]) + "\"}";
+	}
+
+	if (args.size () < 2) return error ("bad request " + cmd);
+	AnalyzedModule *am = getModule (args [1], msg);
+	if (!am) return error (msg);
+	DsaInfo &info = am->m_info->getDsaInfo ();
+
+	if ((cmd == "node" || cmd == "alloc-sites") && args.size () == 4) {
+	  Cell c;
+	  msg = getCell (*am, args [2], args [3], c);
+	  if (!msg.empty ()) return error (msg);
+	  const Node &n = *c.getNode ();
+	  if (cmd == "alloc-sites")
+	    return "{\"ok\":true,\"alloc_sites\":" + allocSites (info, n, true) + "}";
+	  return "{\"ok\":true,\"node\":" + std::to_string (info.getDsaNodeId (n)) +
+	    ",\"offset\":" + std::to_string (c.getOffset ()) +
+	    ",\"collapsed\":" + (n.isCollapsed () ? "true" : "false") +
+	    ",\"alloc_sites\":" + allocSites (info, n, false) + "}";
+	}
+
+	if (cmd == "alias" && (args.size () == 5 || args.size () == 7)) {
+	  Cell c1, c2;
+	  const Value *v1 = nullptr, *v2 = nullptr;
+	  msg = getCell (*am, args [2], args [3], c1, &v1);
+	  if (msg.empty ()) msg = getCell (*am, args [2], args [4], c2, &v2);
+	  if (!msg.empty ()) return error (msg);
+	  unsigned size1 = accessSize (*am, *v1);
+	  unsigned size2 = accessSize (*am, *v2);
+	  if (args.size () == 7) {
+	    size1 = std::strtoul (args [5].c_str (), nullptr, 10);
+	    size2 = std::strtoul (args [6].c_str (), nullptr, 10);
+	  }
+	  bool alias = mayAlias (c1, size1, c2, size2);
+	  return std::string ("{\"ok\":true,\"alias\":") + (alias ? "true" : "false") + "}";
+	}
+
+	if (cmd == "alloc-value" && args.size () == 3) {
+	  unsigned id = std::strtoul (args [2].c_str (), nullptr, 10);
+	  const Value *v = info.getAllocValue (id);
+	  if (!v) return error ("unknown allocation site " + args [2]);
+	  return "{\"ok\":true,\"value\":\"" + escapeJSON (valueName (*v)) + "\"}";
+	}
+
+	return error ("bad request " + cmd);
+      }
+    };
+
+    bool writeAll (int fd, const std::string &s) {
+      size_t done = 0;
+      while (done < s.size ()) {
+	ssize_t n = send (fd, s.data () + done, s.size () - done, MSG_NOSIGNAL);
+	if (n <= 0) return false;
+	done += n;
+      }
+      return true;
+    }
+  }
+
+  int runDsaServer (const std::string &socketPath, const std::string &input) {
+    DsaServer server;
+    if (!input.empty ()) {
+      std::vector<std::string> args {"load", input};
+      errs () << server.handle (args) << "\n";
+    }
+
+    sockaddr_un addr;
+    if (socketPath.size () >= sizeof (addr.sun_path)) {
+      errs () << "error: socket path too long: " << socketPath << "\n";
+      return 3;
+    }
+    int sock = socket (AF_UNIX, SOCK_STREAM, 0);
+    if (sock < 0) {
+      errs () << "error: cannot create socket\n";
+      return 3;
+    }
+    memset (&addr, 0, sizeof (addr));
+    addr.sun_family = AF_UNIX;
+    strncpy (addr.sun_path, socketPath.c_str (), sizeof (addr.sun_path) - 1);
+    unlink (socketPath.c_str ());
+    if (bind (sock, (sockaddr*) &addr, sizeof (addr)) < 0 || listen (sock, 4) < 0) {
+      errs () << "error: cannot listen on " << socketPath << "\n";
+      close (sock);
+      return 3;
+    }
+    errs () << "Listening on " << socketPath << "\n";
+
+    bool shutdown = false;
+    while (!shutdown) {
+      int conn = accept (sock, nullptr, nullptr);
+      if (conn < 0) {
+	if (errno == EINTR) continue;
+	errs () << "error: accept failed: " << strerror (errno) << "\n";
+	break;
+      }
+
+      // -- answer requests until the client closes the connection
+      std::string buffer;
+      char data [4096];
+      bool quit = false;
+      while (!quit) {
+	ssize_t n = read (conn, data, sizeof (data));
+	if (n <= 0) break;
+	buffer.append (data, n);
+
+	size_t eol;
+	while (!quit && (eol = buffer.find ('\n')) != std::string::npos) {
+	  std::istringstream line (buffer.substr (0, eol));
+	  buffer.erase (0, eol + 1);
+
+	  std::vector<std::string> args;
+	  std::string arg;
+	  while (line >> arg) args.push_back (arg);
+	  if (args.empty ()) continue;
+
+	  if (args [0] == "quit" || args [0] == "shutdown") {
+	    shutdown = args [0] == "shutdown";
+	    quit = true;
+	    break;
+	  }
+	  if (!writeAll (conn, server.handle (args) + "\n"))
+	    quit = true;
+	}
+      }
+      close (conn);
+    }
+
+    close (sock);
+    unlink (socketPath.c_str ());
+    return 0;
+  }
+}
@@ -0,0 +1,33 @@
+#ifndef __DSA_SERVER_HH_
+#define __DSA_SERVER_HH_
+
+#include <string>
+
+namespace sea_dsa {
+
+  // Answer queries about the memory graphs of some modules over a
+  // Unix-domain socket until a shutdown request is received.
+  //
+  // The client sends one request per line and the server answers
+  // each request with one line containing a JSON object. Each module
+  // is analyzed once and reanalyzed if its bitcode file changes.
+  //
+  //   load FILE                    analyze FILE
+  //   node FILE FN VALUE           node, offset and allocation sites of VALUE
+  //   alias FILE FN VALUE VALUE [SIZE SIZE]
+  //                                may accesses through both values overlap?
+  //   alloc-sites FILE FN VALUE    allocation sites that reach VALUE
+  //   alloc-value FILE ID          allocation site with id ID
+  //   quit                         close the connection
+  //   shutdown                     close the connection and stop the server
+  //
+  // VALUE is @name for a global or %name (or name) for an argument
+  // or instruction of function FN. Unnamed values get the names
+  // assigned by DsaInfo. The sizes of alias are in bytes (0 if
+  // unknown) and default to the store size of the pointed types.
+  //
+  // Return the exit code of the tool.
+  int runDsaServer (const std::string &socketPath, const std::string &input);
+}
+
+#endif
@@ -19,12 +19,26 @@
 #include "llvm/Transforms/IPO.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/IR/Verifier.h"
+#include "llvm/Support/Path.h"
 
 #include "sea_dsa/DsaAnalysis.hh"
+#include "sea_dsa/Materialize.hh"
+#include "sea_dsa/DemandDriven.hh"
+#include "sea_dsa/AllocSiteMap.hh"
+#include "sea_dsa/support/Debug.h"
+
+#include "DsaServer.hh"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 static llvm::cl::opt<std::string>
 InputFilename(llvm::cl::Positional, llvm::cl::desc("<input LLVM bitcode file>"),
-              llvm::cl::Required, llvm::cl::value_desc("filename"));
+              llvm::cl::Optional, llvm::cl::value_desc("filename"));
 
 static llvm::cl::opt<std::string>
 AsmOutputFilename("oll", llvm::cl::desc("Output analyzed bitcode"),
@@ -50,6 +64,290 @@ MemViewer("sea-dsa-viewer",
 	  llvm::cl::desc("View memory graph of each function to dot format"),
 	  llvm::cl::init(false));
 
+static llvm::cl::opt<bool>
+Annotate("sea-dsa-annotate",
+	 llvm::cl::desc("Attach Dsa node and allocation site ids as metadata to the output bitcode"),
+	 llvm::cl::init(false));
+
+static llvm::cl::opt<bool>
+AAEval("sea-dsa-aa-eval",
+       llvm::cl::desc("Evaluate the Dsa alias analysis on all pairs of pointers of each function (as opt -aa-eval)"),
+       llvm::cl::init(false));
+
+static llvm::cl::opt<std::string>
+BatchManifest("sea-dsa-batch",
+	      llvm::cl::desc("Analyze all bitcode files listed (one per line) in a manifest"),
+	      llvm::cl::init(""), llvm::cl::value_desc("filename"));
+
+static llvm::cl::opt<unsigned>
+BatchJobs("sea-dsa-jobs",
+	  llvm::cl::desc("Number of inputs analyzed in parallel in batch mode (0 = number of cores)"),
+	  llvm::cl::init(0));
+
+static llvm::cl::opt<std::string>
+BatchOutputDir("sea-dsa-batch-outdir",
+	       llvm::cl::desc("Directory with one subdirectory of outputs per input in batch mode"),
+	       llvm::cl::init("sea-dsa-batch"), llvm::cl::value_desc("DIR"));
+
+static llvm::cl::opt<bool>
+BatchInfo("sea-dsa-batch-info",
+	  llvm::cl::desc("Write the allocation sites of each input in batch mode"),
+	  llvm::cl::init(false));
+
+static llvm::cl::opt<bool>
+LazyLoading("sea-dsa-lazy",
+	    llvm::cl::desc("Only parse the functions reachable from main (or from externally visible functions)"),
+	    llvm::cl::init(false));
+
+static llvm::cl::opt<std::string>
+ServerSocket("sea-dsa-server",
+	     llvm::cl::desc("Answer queries over a Unix-domain socket (the input file is optional)"),
+	     llvm::cl::init(""), llvm::cl::value_desc("path"));
+
+static llvm::cl::opt<std::string>
+AllocSiteMapFile("sea-dsa-dump-alloc-site-map",
+		 llvm::cl::desc("Print the allocation site map written by -sea-dsa-info-to-binary-file (no input file is needed)"),
+		 llvm::cl::init(""), llvm::cl::value_desc("filename"));
+
+static llvm::cl::list<std::string>
+DemandQueries("sea-dsa-demand",
+	      llvm::cl::desc("Print the cell of a value computed by the demand-driven analysis"),
+	      llvm::cl::CommaSeparated, llvm::cl::value_desc("FN:VALUE"));
+
+static llvm::cl::opt<bool>
+DemandCompare("sea-dsa-demand-compare",
+	      llvm::cl::desc("Also print the cell computed by the whole-program analysis"),
+	      llvm::cl::init(false));
+
+namespace {
+  
+  std::unique_ptr<llvm::Module> loadModule (const std::string &filename,
+					    llvm::SMDiagnostic &err,
+					    llvm::LLVMContext &context) {
+    if (LazyLoading)
+      return llvm::getLazyIRFileModule (filename, err, context);
+    return llvm::parseIRFile (filename, err, context);
+  }
+  
+  // Result of the analysis of one input in batch mode
+  struct BatchResult {
+    std::string m_input;
+    std::string m_outdir;
+    bool m_ok;
+    double m_parse_time;
+    double m_analysis_time;
+    
+    BatchResult (): m_ok (false), m_parse_time (0), m_analysis_time (0) {}
+  };
+  
+  // serialize messages of the workers
+  std::mutex errsMutex;
+  
+  void batchError (const std::string &input, const std::string &msg) {
+    sea_dsa::diags () << "error: " << input << ": " << msg << "\n";
+  }
+  
+  // Print the pairs of an allocation site map in the format of
+  // -sea-dsa-info-to-file
+  int dumpAllocSiteMap (const std::string &filename) {
+    sea_dsa::AllocSiteMap map;
+    if (!map.open (filename)) {
+      llvm::errs () << "error: " << filename << " is not a valid allocation site map\n";
+      return 3;
+    }
+    llvm::outs () << "alloc_site,ds_node\n";
+    for (uint32_t site : map.sites ())
+      for (uint32_t node : map.getNodes (site))
+	llvm::outs () << site << "," << node << "\n";
+    return 0;
+  }
+  
+  // Quote a field of timings.csv
+  std::string csvField (const std::string &s) {
+    if (s.find_first_of (",\"\n\r") == std::string::npos) return s;
+    std::string res = "\"";
+    for (char c : s) {
+      if (c == '"') res += '"';
+      res += c;
+    }
+    return res + "\"";
+  }
+  
+  // Options of the library that write to one fixed file. All the
+  // workers of a batch would write to the same file.
+  bool checkBatchOptions () {
+    static const char *fileOptions [] = {
+      "sea-dsa-info-to-file", "sea-dsa-info-to-binary-file",
+      "sea-dsa-modref-to-file", "sea-dsa-collapse-profile-to-file",
+      "sea-dsa-fixpoint-trace", "sea-dsa-shape-stats-to-file",
+      "sea-dsa-write-graphs", "sea-dsa-incremental"
+    };
+    
+    llvm::StringMap<llvm::cl::Option*> opts;
+    llvm::cl::getRegisteredOptions (opts);
+    bool ok = true;
+    for (const char *name : fileOptions) {
+      auto it = opts.find (name);
+      if (it != opts.end () && it->second->getNumOccurrences () > 0) {
+	llvm::errs () << "error: -" << name << " is not supported in batch mode\n";
+	ok = false;
+      }
+    }
+    return ok;
+  }
+  
+  double elapsed (std::chrono::steady_clock::time_point start) {
+    std::chrono::duration<double> d = std::chrono::steady_clock::now () - start;
+    return d.count ();
+  }
+  
+  // Analyze one input in its own context. The outputs are written
+  // into res.m_outdir.
+  void analyzeInput (BatchResult &res) {
+    auto start = std::chrono::steady_clock::now ();
+    
+    llvm::LLVMContext context;
+    llvm::SMDiagnostic err;
+    std::unique_ptr<llvm::Module> module =
+      loadModule (res.m_input, err, context);
+    if (!module) {
+      batchError (res.m_input, "bitcode was not properly read; " + err.getMessage ().str ());
+      return;
+    }
+    
+    if (!module->getDataLayout () && !DefaultDataLayout.empty ())
+      module->setDataLayout (DefaultDataLayout);
+    
+    std::string verifierMsg;
+    llvm::raw_string_ostream verifierOut (verifierMsg);
+    if (!LazyLoading && llvm::verifyModule (*module, &verifierOut)) {
+      batchError (res.m_input, "broken module; " + verifierOut.str ());
+      return;
+    }
+    
+    res.m_parse_time = elapsed (start);
+    start = std::chrono::steady_clock::now ();
+    
+    if (llvm::sys::fs::create_directories (res.m_outdir)) {
+      batchError (res.m_input, "could not create " + res.m_outdir);
+      return;
+    }
+    
+    std::error_code ec;
+    std::unique_ptr<llvm::raw_fd_ostream> stats;
+    if (PrintDsaStats) {
+      stats.reset (new llvm::raw_fd_ostream (res.m_outdir + "/stats.txt", ec,
+					     llvm::sys::fs::F_Text));
+      if (ec) {
+	batchError (res.m_input, "could not open stats file; " + ec.message ());
+	return;
+      }
+    }
+    
+    llvm::PassManager pass_manager;
+    if (module->getDataLayout ())
+      pass_manager.add (new llvm::DataLayoutPass ());
+    
+    if (LazyLoading)
+      pass_manager.add (new sea_dsa::MaterializeReachable ());
+    
+    pass_manager.add (new sea_dsa::DsaAnalysis ());
+    
+    if (BatchInfo || PrintDsaStats)
+      pass_manager.add (sea_dsa::createDsaInfoPass
+			(BatchInfo ? res.m_outdir + "/info.csv" : ""));
+    
+    if (MemDot)
+      pass_manager.add (sea_dsa::createDsaPrinterPass (res.m_outdir));
+    
+    if (PrintDsaStats)
+      pass_manager.add (sea_dsa::createDsaPrintStatsPass (*stats));
+    
+    pass_manager.run (*module);
+    
+    res.m_analysis_time = elapsed (start);
+    res.m_ok = true;
+  }
+  
+  int runBatch () {
+    std::ifstream manifest (BatchManifest.c_str ());
+    if (!manifest) {
+      llvm::errs () << "error: could not open " << BatchManifest << "\n";
+      return 3;
+    }
+    
+    std::vector<BatchResult> results;
+    std::string line;
+    while (std::getline (manifest, line)) {
+      line.erase (0, line.find_first_not_of (" \t\r"));
+      line.erase (line.find_last_not_of (" \t\r") + 1);
+      if (line.empty () || line [0] == '#') continue;
+      
+      BatchResult res;
+      res.m_input = line;
+      // -- the position makes the directory unique even if two
+      //    inputs have the same name
+      res.m_outdir = BatchOutputDir + "/" + std::to_string (results.size ()) + "-" +
+	llvm::sys::path::stem (line).str ();
+      results.push_back (res);
+    }
+    
+    unsigned jobs = BatchJobs;
+    if (jobs == 0) jobs = std::max (1u, std::thread::hardware_concurrency ());
+    jobs = std::min<unsigned> (jobs, std::max<size_t> (1, results.size ()));
+    
+    auto start = std::chrono::steady_clock::now ();
+    std::atomic<unsigned> next (0);
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < jobs; ++i)
+      workers.push_back (std::thread ([&] () {
+	    for (unsigned j = next++; j < results.size (); j = next++) {
+	      // -- the messages of one input are written at once so
+	      //    that those of different inputs are not interleaved
+	      std::string msgs;
+	      {
+		llvm::raw_string_ostream os (msgs);
+		sea_dsa::DiagsRedirect redirect (os);
+		analyzeInput (results [j]);
+	      }
+	      if (!msgs.empty ()) {
+		std::lock_guard<std::mutex> lock (errsMutex);
+		llvm::errs () << msgs;
+	      }
+	    }
+	  }));
+    for (auto &w : workers) w.join ();
+    double total = elapsed (start);
+    
+    // -- aggregated timings
+    unsigned failed = 0;
+    double parse = 0, analysis = 0;
+    std::error_code ec;
+    llvm::sys::fs::create_directories (BatchOutputDir);
+    llvm::raw_fd_ostream timings (BatchOutputDir + "/timings.csv", ec,
+				  llvm::sys::fs::F_Text);
+    if (ec)
+      llvm::errs () << "error: could not open timings file; " << ec.message () << "\n";
+    else
+      timings << "input,outdir,status,parse_time,analysis_time\n";
+    for (const BatchResult &res : results) {
+      if (!res.m_ok) failed++;
+      parse += res.m_parse_time;
+      analysis += res.m_analysis_time;
+      if (!ec)
+	timings << csvField (res.m_input) << "," << csvField (res.m_outdir) << ","
+		<< (res.m_ok ? "ok" : "error") << ","
+		<< res.m_parse_time << "," << res.m_analysis_time << "\n";
+    }
+    
+    llvm::errs () << "Analyzed " << results.size () - failed << "/"
+		  << results.size () << " inputs with " << jobs << " workers in "
+		  << total << "s (parse " << parse << "s, analysis "
+		  << analysis << "s)\n";
+    return failed > 0 ? 1 : 0;
+  }
+}
+
 int main(int argc, char **argv) {
 
   llvm::llvm_shutdown_obj shutdown;  // calls llvm_shutdown() on exit
@@ -60,13 +358,45 @@ int main(int argc, char **argv) {
   llvm::PrettyStackTraceProgram PSTP(argc, argv);
   llvm::EnableDebugBuffering = true;
 
+  if (!ServerSocket.empty ()) {
+    llvm::PassRegistry &Registry = *llvm::PassRegistry::getPassRegistry();
+    llvm::initializeAnalysis(Registry);
+    llvm::initializeIPA (Registry);
+    return sea_dsa::runDsaServer (ServerSocket, InputFilename);
+  }
+
+  if (!AllocSiteMapFile.empty ())
+    return dumpAllocSiteMap (AllocSiteMapFile);
+
+  if (BatchManifest.empty () == InputFilename.empty ()) {
+    llvm::errs () << "error: expected either an input file or -sea-dsa-batch\n";
+    return 3;
+  }
+
+  if (!BatchManifest.empty ()) {
+    if (!AsmOutputFilename.empty () || MemViewer || Annotate)
+      llvm::errs () << "WARNING: -oll, -sea-dsa-viewer and -sea-dsa-annotate are ignored in batch mode\n";
+    if (!checkBatchOptions ())
+      return 3;
+    llvm::PassRegistry &Registry = *llvm::PassRegistry::getPassRegistry();
+    llvm::initializeAnalysis(Registry);
+    llvm::initializeIPA (Registry);
+    return runBatch ();
+  }
+
+  // -- the functions that are not materialized would be lost
+  if (LazyLoading && (!AsmOutputFilename.empty () || Annotate)) {
+    llvm::errs () << "error: -oll and -sea-dsa-annotate cannot be used with -sea-dsa-lazy\n";
+    return 3;
+  }
+
   std::error_code error_code;
   llvm::SMDiagnostic err;
   llvm::LLVMContext &context = llvm::getGlobalContext();
   std::unique_ptr<llvm::Module> module;
   std::unique_ptr<llvm::tool_output_file> asmOutput;
 
-  module = llvm::parseIRFile(InputFilename, err, context);
+  module = loadModule(InputFilename, err, context);
   if (module.get() == 0)
   {
     if (llvm::errs().has_colors()) llvm::errs().changeColor(llvm::raw_ostream::RED);
@@ -110,7 +440,11 @@ int main(int argc, char **argv) {
   if (dl)
     pass_manager.add (new llvm::DataLayoutPass ());
 
-  pass_manager.add (llvm::createVerifierPass());
+  // -- the verifier would need the bodies of all functions
+  if (LazyLoading)
+    pass_manager.add (new sea_dsa::MaterializeReachable ());
+  else
+    pass_manager.add (llvm::createVerifierPass());
   
   if (MemDot)
     pass_manager.add (sea_dsa::createDsaPrinterPass ());
@@ -121,6 +455,21 @@ int main(int argc, char **argv) {
   if (PrintDsaStats)
     pass_manager.add (sea_dsa::createDsaPrintStatsPass ());    
     
+  if (Annotate)
+    pass_manager.add (sea_dsa::createDsaAnnotatePass ());
+
+  if (AAEval) {
+    pass_manager.add (llvm::createBasicAliasAnalysisPass ());
+    pass_manager.add (sea_dsa::createDsaAliasAnalysisPass ());
+    pass_manager.add (llvm::createAAEvalPass ());
+  }
+
+  if (!DemandQueries.empty ())
+    pass_manager.add (sea_dsa::createDsaDemandQueryPass
+		      (std::vector<std::string> (DemandQueries.begin (),
+						 DemandQueries.end ()),
+		       DemandCompare));
+    
   if (!AsmOutputFilename.empty ())
     pass_manager.add (createPrintModulePass (asmOutput->os ()));
   